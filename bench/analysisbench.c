@@ -0,0 +1,224 @@
+/**
+ * @file analysisbench.c
+ * @brief Thread scaling of the parallel static analysis
+ *
+ * Builds a synthetic program with many independent functions directly from
+ * AST constructors (so that the timing does not include the lexer and
+ * parser), then times @ref analyze_parallel on the same tree with an
+ * increasing number of threads. Every run must report the same errors in the
+ * same order as the single-threaded run.
+ *
+ * Shape parameters:
+ *
+ * - functions: number of function declarations besides @c main
+ * - statements: number of assignment statements in each function body
+ *
+ * Each function body also contains a loop, a conditional, and calls to the
+ * previous function, and every eighth function has a type error, so both the
+ * clean and the error-reporting paths are exercised.
+ */
+
+#include "p3-analysis.h"
+
+#include <time.h>
+
+/*
+ * PROGRAM CONSTRUCTION
+ */
+
+/**
+ * @brief Build an integer expression over the locals and parameters
+ */
+ASTNode* bench_expression (int k, int line)
+{
+    ASTNode* sum = BinaryOpNode_new(ADDOP,
+            LocationNode_new("a", NULL, line),
+            BinaryOpNode_new(MULOP, LocationNode_new("x", NULL, line), LiteralNode_new_int(k, line), line),
+            line);
+    return BinaryOpNode_new(SUBOP, sum,
+            BinaryOpNode_new(MODOP, LocationNode_new("b", NULL, line), LiteralNode_new_int(k + 1, line), line),
+            line);
+}
+
+/**
+ * @brief Build one function declaration
+ *
+ * @param index Function number (calls function @c index - 1 if positive)
+ * @param statements Number of assignment statements in the body
+ * @param line Source line counter (advanced past the function)
+ */
+ASTNode* bench_function (int index, int statements, int* line)
+{
+    char name[MAX_ID_LEN], callee[MAX_ID_LEN];
+    snprintf(name, MAX_ID_LEN, "f%d", index);
+    snprintf(callee, MAX_ID_LEN, "f%d", index - 1);
+    int start = (*line)++;
+
+    ParameterList* params = ParameterList_new();
+    ParameterList_add_new(params, "a", INT);
+    ParameterList_add_new(params, "b", INT);
+
+    NodeList* vars = NodeList_new();
+    NodeList_add(vars, VarDeclNode_new("x", INT, false, 1, (*line)++));
+    NodeList_add(vars, VarDeclNode_new("c", BOOL, false, 1, (*line)++));
+
+    NodeList* stmts = NodeList_new();
+    NodeList_add(stmts, AssignmentNode_new(LocationNode_new("x", NULL, *line), LiteralNode_new_int(0, *line), *line));
+    (*line)++;
+    for (int s = 0; s < statements; s++, (*line)++) {
+        NodeList_add(stmts, AssignmentNode_new(LocationNode_new("x", NULL, *line), bench_expression(s, *line), *line));
+    }
+
+    /* while (x < b) { x = x + 1; if (x == a) { break; } } */
+    NodeList* loop_stmts = NodeList_new();
+    NodeList_add(loop_stmts, AssignmentNode_new(LocationNode_new("x", NULL, *line),
+            BinaryOpNode_new(ADDOP, LocationNode_new("x", NULL, *line), LiteralNode_new_int(1, *line), *line), *line));
+    NodeList* then_stmts = NodeList_new();
+    NodeList_add(then_stmts, BreakNode_new(*line));
+    NodeList_add(loop_stmts, ConditionalNode_new(
+            BinaryOpNode_new(EQOP, LocationNode_new("x", NULL, *line), LocationNode_new("a", NULL, *line), *line),
+            BlockNode_new(NodeList_new(), then_stmts, *line), NULL, *line));
+    NodeList_add(stmts, WhileLoopNode_new(
+            BinaryOpNode_new(LTOP, LocationNode_new("x", NULL, *line), LocationNode_new("b", NULL, *line), *line),
+            BlockNode_new(NodeList_new(), loop_stmts, *line), *line));
+    (*line)++;
+
+    /* every eighth function assigns an int to a bool */
+    ASTNode* flag = (index % 8 == 7 ? LocationNode_new("x", NULL, *line) : LiteralNode_new_bool(true, *line));
+    NodeList_add(stmts, AssignmentNode_new(LocationNode_new("c", NULL, *line), flag, *line));
+    (*line)++;
+
+    /* return f<index-1>(x, b); */
+    ASTNode* result = LocationNode_new("x", NULL, *line);
+    if (index > 0) {
+        NodeList* args = NodeList_new();
+        NodeList_add(args, result);
+        NodeList_add(args, LocationNode_new("b", NULL, *line));
+        result = FuncCallNode_new(callee, args, *line);
+    }
+    NodeList_add(stmts, ReturnNode_new(result, *line));
+    (*line)++;
+
+    return FuncDeclNode_new(name, INT, params, BlockNode_new(vars, stmts, start), start);
+}
+
+/**
+ * @brief Build a program and run the passes that precede the analysis
+ */
+ASTNode* bench_program (int functions, int statements)
+{
+    int line = 1;
+    NodeList* funcs = NodeList_new();
+    for (int f = 0; f < functions; f++) {
+        NodeList_add(funcs, bench_function(f, statements, &line));
+    }
+    NodeList* main_stmts = NodeList_new();
+    NodeList_add(main_stmts, ReturnNode_new(LiteralNode_new_int(0, line), line));
+    NodeList_add(funcs, FuncDeclNode_new("main", INT, ParameterList_new(),
+            BlockNode_new(NodeList_new(), main_stmts, line), line));
+
+    ASTNode* tree = ProgramNode_new(NodeList_new(), funcs);
+    NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
+    NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
+    NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
+    return tree;
+}
+
+/*
+ * MEASUREMENT
+ */
+
+double now_ns ()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Check that two error lists have the same messages in the same order
+ */
+bool same_errors (ErrorList* expected, ErrorList* actual)
+{
+    if (ErrorList_size(expected) != ErrorList_size(actual)) {
+        return false;
+    }
+    char message_a[MAX_ERROR_LEN], message_b[MAX_ERROR_LEN];
+    AnalysisError* b = actual->head;
+    FOR_EACH(AnalysisError*, a, expected) {
+        if (strcmp(AnalysisError_format(a, message_a, MAX_ERROR_LEN),
+                   AnalysisError_format(b, message_b, MAX_ERROR_LEN)) != 0) {
+            return false;
+        }
+        b = b->next;
+    }
+    return true;
+}
+
+/**
+ * @brief Time the analysis with a given number of threads
+ *
+ * @returns Fastest of @p repeats runs in milliseconds
+ */
+double measure (ASTNode* tree, int threads, int repeats, ErrorList* expected)
+{
+    double best = 0.0;
+    for (int r = 0; r < repeats; r++) {
+        double start = now_ns();
+        ErrorList* errors = analyze_parallel(tree, threads);
+        double elapsed = (now_ns() - start) / 1e6;
+        if (!same_errors(expected, errors)) {
+            fprintf(stderr, "%d threads: errors differ from the sequential analysis\n", threads);
+            exit(EXIT_FAILURE);
+        }
+        ErrorList_free(errors);
+        if (r == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+void print_usage (const char* program)
+{
+    fprintf(stderr, "Usage: %s [-f functions] [-s statements] [-t max-threads] [-r repeats]\n", program);
+}
+
+int main (int argc, char** argv)
+{
+    int functions = 2000, statements = 50, max_threads = 8, repeats = 5;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-f") == 0) {
+            functions = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            statements = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+            max_threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            repeats = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (functions < 0 || statements < 0 || max_threads < 1 || repeats < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ASTNode* tree = bench_program(functions, statements);
+    ErrorList* expected = analyze(tree);
+    printf("%d functions, %d statements each, %d errors\n", functions, statements, ErrorList_size(expected));
+    printf("%8s %12s %8s\n", "threads", "ms", "speedup");
+    double base = 0.0;
+    for (int t = 1; t <= max_threads; t *= 2) {
+        double ms = measure(tree, t, repeats, expected);
+        if (t == 1) {
+            base = ms;
+        }
+        printf("%8d %12.2f %8.2f\n", t, ms, base / ms);
+    }
+    ErrorList_free(expected);
+    ASTNode_free(tree);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,302 @@
+/**
+ * @file symbench.c
+ * @brief Name-lookup microbenchmarks
+ *
+ * Builds a synthetic chain of nested scopes (through @ref SymbolTable_new_child
+ * and @ref SymbolTable_insert) and measures hit and miss latency for each of
+ * several lookup implementations on the same scopes. Each implementation is a
+ * @ref LookupImpl; to compare a new table design, add an entry to @c IMPLS.
+ *
+ * Shape parameters:
+ *
+ * - depth: number of nested scopes below the global scope
+ * - width: number of symbols declared in each scope
+ * - shadow: fraction of each nested scope's symbols that reuse (and so
+ *   shadow) a global name
+ *
+ * Hits query names drawn uniformly from everything visible in the innermost
+ * scope; misses query names that are declared nowhere.
+ */
+
+#include "symbol.h"
+#include "resolver.h"
+
+#include <time.h>
+
+/**
+ * @brief Number of distinct names queried in each measurement
+ */
+#define QUERY_NAMES 1024
+
+/**
+ * @brief Synthetic scope chain shared by all implementations
+ */
+typedef struct BenchScopes
+{
+    int depth;                      /**< @brief Number of nested scopes below the global scope */
+    SymbolTable** tables;           /**< @brief Tables from global (index 0) to innermost */
+    ASTNode** blocks;               /**< @brief Block node for each table (with "symbolTable" and "parent") */
+    ASTNode* leaf;                  /**< @brief Node inside the innermost block (scope pointer set) */
+    ASTNode* bare_leaf;             /**< @brief Node inside the innermost block (no scope pointer) */
+    char hits[QUERY_NAMES][MAX_ID_LEN];     /**< @brief Names that are visible in the innermost scope */
+    char misses[QUERY_NAMES][MAX_ID_LEN];   /**< @brief Names that are declared nowhere */
+} BenchScopes;
+
+/**
+ * @brief A name lookup implementation under test
+ */
+typedef struct LookupImpl
+{
+    const char* name;                                   /**< @brief Label in the report */
+    void* (*prepare)(BenchScopes* scopes);              /**< @brief Build any extra state (may be NULL) */
+    Symbol* (*lookup)(BenchScopes* scopes, void* state, const char* name);
+    void (*release)(void* state);                       /**< @brief Free the extra state (may be NULL) */
+} LookupImpl;
+
+/*
+ * IMPLEMENTATIONS
+ */
+
+Symbol* lookup_linear (BenchScopes* scopes, void* state, const char* name)
+{
+    /* list scan up the parent chain (the original SymbolTable_lookup) */
+    for (SymbolTable* t = scopes->tables[scopes->depth]; t != NULL; t = t->parent) {
+        FOR_EACH(Symbol*, sym, t->local_symbols) {
+            if (strncmp(name, sym->name, MAX_ID_LEN) == 0) {
+                return sym;
+            }
+        }
+    }
+    return NULL;
+}
+
+Symbol* lookup_table_chain (BenchScopes* scopes, void* state, const char* name)
+{
+    return SymbolTable_lookup(scopes->tables[scopes->depth], name);
+}
+
+Symbol* lookup_node_scope (BenchScopes* scopes, void* state, const char* name)
+{
+    return lookup_symbol(scopes->leaf, name);
+}
+
+Symbol* lookup_node_walk (BenchScopes* scopes, void* state, const char* name)
+{
+    return lookup_symbol(scopes->bare_leaf, name);
+}
+
+void* prepare_resolver (BenchScopes* scopes)
+{
+    Resolver* resolver = Resolver_new();
+    for (int d = 0; d <= scopes->depth; d++) {
+        Resolver_enter_scope(resolver);
+        for (int i = 0; i < scopes->tables[d]->size; i++) {
+            Resolver_declare(resolver, scopes->tables[d]->symbols[i]);
+        }
+    }
+    return resolver;
+}
+
+Symbol* lookup_resolver (BenchScopes* scopes, void* state, const char* name)
+{
+    return Resolver_lookup((Resolver*)state, name);
+}
+
+void release_resolver (void* state)
+{
+    Resolver_free((Resolver*)state);
+}
+
+LookupImpl IMPLS[] = {
+    { "list scan",              NULL,               lookup_linear,      NULL },
+    { "SymbolTable_lookup",     NULL,               lookup_table_chain, NULL },
+    { "lookup_symbol (scope)",  NULL,               lookup_node_scope,  NULL },
+    { "lookup_symbol (walk)",   NULL,               lookup_node_walk,   NULL },
+    { "Resolver_lookup",        prepare_resolver,   lookup_resolver,    release_resolver },
+};
+
+#define NUM_IMPLS ((int)(sizeof(IMPLS) / sizeof(IMPLS[0])))
+
+/*
+ * SCOPE CONSTRUCTION
+ */
+
+/**
+ * @brief Deterministic pseudo-random numbers (so runs are comparable)
+ */
+unsigned int bench_rand (unsigned int* state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) & 0x7fff;
+}
+
+BenchScopes* BenchScopes_new (int depth, int width, double shadow)
+{
+    BenchScopes* scopes = (BenchScopes*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(BenchScopes));
+    CHECK_MALLOC_PTR(scopes)
+    scopes->depth = depth;
+    scopes->tables = (SymbolTable**)Memory_calloc(MEM_ANALYSIS, depth + 1, sizeof(SymbolTable*));
+    CHECK_MALLOC_PTR(scopes->tables)
+    scopes->blocks = (ASTNode**)Memory_calloc(MEM_ANALYSIS, depth + 1, sizeof(ASTNode*));
+    CHECK_MALLOC_PTR(scopes->blocks)
+
+    unsigned int seed = 42;
+    char name[MAX_ID_LEN];
+    int shadowed = (int)(shadow * width + 0.5);
+    for (int d = 0; d <= depth; d++) {
+        SymbolTable* table = (d == 0 ? SymbolTable_new() : SymbolTable_new_child(scopes->tables[d-1]));
+        for (int i = 0; i < width; i++) {
+            if (d > 0 && i < shadowed) {
+                snprintf(name, MAX_ID_LEN, "g%d", (int)(bench_rand(&seed) % (unsigned)width));
+            } else if (d == 0) {
+                snprintf(name, MAX_ID_LEN, "g%d", i);
+            } else {
+                snprintf(name, MAX_ID_LEN, "s%d_%d", d, i);
+            }
+            SymbolTable_insert(table, Symbol_new(table->arena, name, INT));
+        }
+        SymbolTable_freeze(table);
+        scopes->tables[d] = table;
+
+        ASTNode* block = BlockNode_new(NodeList_new(), NodeList_new(), d);
+        ASTNode_set_attribute(block, "symbolTable", table, NULL);
+        block->scope = table;
+        if (d > 0) {
+            ASTNode_set_attribute(block, "parent", scopes->blocks[d-1], NULL);
+        }
+        scopes->blocks[d] = block;
+    }
+    scopes->leaf = BreakNode_new(depth + 1);
+    scopes->leaf->scope = scopes->tables[depth];
+    scopes->bare_leaf = BreakNode_new(depth + 1);
+    ASTNode_set_attribute(scopes->bare_leaf, "parent", scopes->blocks[depth], NULL);
+
+    /* query names: hits come from a random scope on the chain */
+    for (int q = 0; q < QUERY_NAMES; q++) {
+        int d = (int)(bench_rand(&seed) % (unsigned)(depth + 1));
+        int i = (int)(bench_rand(&seed) % (unsigned)(width > 0 ? width : 1));
+        if (width == 0) {
+            snprintf(scopes->hits[q], MAX_ID_LEN, "missing%d", q);
+        } else {
+            snprintf(scopes->hits[q], MAX_ID_LEN, "%s", scopes->tables[d]->symbols[i]->name);
+        }
+        snprintf(scopes->misses[q], MAX_ID_LEN, "missing%d", q);
+    }
+    return scopes;
+}
+
+void BenchScopes_free (BenchScopes* scopes)
+{
+    ASTNode_free(scopes->leaf);
+    ASTNode_free(scopes->bare_leaf);
+    for (int d = scopes->depth; d >= 0; d--) {
+        ASTNode_free(scopes->blocks[d]);
+        SymbolTable_free(scopes->tables[d]);
+    }
+    Memory_free(scopes->blocks);
+    Memory_free(scopes->tables);
+    Memory_free(scopes);
+}
+
+/*
+ * MEASUREMENT
+ */
+
+double now_ns ()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Time budget (in nanoseconds) for a single measurement
+ *
+ * Slow implementations on large shapes stop early (after at least one pass
+ * over the query names) so that a full sweep finishes in reasonable time.
+ */
+#define MEASURE_BUDGET_NS 50e6
+
+/**
+ * @brief Time lookups of a set of names
+ *
+ * @returns Average latency in nanoseconds
+ */
+double measure (LookupImpl* impl, BenchScopes* scopes, void* state,
+                char names[QUERY_NAMES][MAX_ID_LEN], long iterations, bool expect_hit)
+{
+    long found = 0, n = 0;
+    double start = now_ns(), elapsed = 0.0;
+    while (n < iterations && elapsed < MEASURE_BUDGET_NS) {
+        for (int q = 0; q < QUERY_NAMES; q++, n++) {
+            found += (impl->lookup(scopes, state, names[q]) != NULL);
+        }
+        elapsed = now_ns() - start;
+    }
+    if (expect_hit ? found != n : found != 0) {
+        fprintf(stderr, "%s: %s lookups returned the wrong result\n", impl->name, expect_hit ? "hit" : "miss");
+        exit(EXIT_FAILURE);
+    }
+    return elapsed / n;
+}
+
+void run_config (int depth, int width, double shadow, long iterations)
+{
+    BenchScopes* scopes = BenchScopes_new(depth, width, shadow);
+    for (int k = 0; k < NUM_IMPLS; k++) {
+        LookupImpl* impl = &IMPLS[k];
+        void* state = (impl->prepare != NULL ? impl->prepare(scopes) : NULL);
+        double hit  = measure(impl, scopes, state, scopes->hits, iterations, width > 0);
+        double miss = measure(impl, scopes, state, scopes->misses, iterations, false);
+        printf("%6d %6d %6.2f  %-24s %10.1f %10.1f\n", depth, width, shadow, impl->name, hit, miss);
+        if (impl->release != NULL) {
+            impl->release(state);
+        }
+    }
+    BenchScopes_free(scopes);
+}
+
+void print_usage (const char* program)
+{
+    fprintf(stderr, "Usage: %s [-d depth] [-w width] [-s shadow] [-n iterations]\n", program);
+    fprintf(stderr, "  (with no shape options, sweeps depth and width)\n");
+}
+
+int main (int argc, char** argv)
+{
+    int depth = -1, width = -1;
+    double shadow = 0.25;
+    long iterations = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            depth = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+            width = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            shadow = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+            iterations = atol(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (depth < -1 || width < -1 || shadow < 0.0 || shadow > 1.0 || iterations <= 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%6s %6s %6s  %-24s %10s %10s\n", "depth", "width", "shadow", "implementation", "hit ns", "miss ns");
+    if (depth >= 0 || width >= 0) {
+        run_config(depth >= 0 ? depth : 4, width >= 0 ? width : 16, shadow, iterations);
+    } else {
+        int depths[] = { 1, 4, 16, 64 };
+        int widths[] = { 4, 64, 1024 };
+        for (int w = 0; w < 3; w++) {
+            for (int d = 0; d < 4; d++) {
+                run_config(depths[d], widths[w], shadow, iterations);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
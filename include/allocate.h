@@ -0,0 +1,46 @@
+/**
+ * @file allocate.h
+ * @brief Storage layout for variables and parameters
+ *
+ * This module provides a pass that fills in the @c location and @c offset
+ * fields of every non-function @ref Symbol and records the amount of storage
+ * each program and function needs:
+ *
+ * - Global variables (including arrays) are @c STATIC_VAR symbols with
+ *   offsets from the start of the static data region, and the program node
+ *   gets a @c staticSize attribute with the total size in bytes.
+ * - Parameters are @c STACK_PARAM symbols with positive offsets from the
+ *   frame base pointer (past the saved base pointer and return address).
+ * - Local variables are @c STACK_LOCAL symbols with negative offsets from the
+ *   frame base pointer. Sibling blocks have disjoint lifetimes, so they reuse
+ *   the same slots; each function node gets a @c localSize attribute with the
+ *   size of its deepest nesting of locals (i.e., its frame size).
+ *
+ * The pass assumes a tree that has passed static analysis.
+ */
+#ifndef __ALLOCATE_H
+#define __ALLOCATE_H
+
+#include "symbol.h"
+
+/**
+ * @brief Size (in bytes) of a single scalar variable or array element
+ */
+#define WORD_SIZE 8
+
+/**
+ * @brief Offset (in bytes) of the first parameter from the frame base pointer
+ *
+ * The saved base pointer and the return address sit between the base pointer
+ * and the parameters.
+ */
+#define FIRST_PARAM_OFFSET (2 * WORD_SIZE)
+
+/**
+ * @brief Create a new visitor that assigns storage to all variables
+ *
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* AllocateSymbolsVisitor_new ();
+
+#endif
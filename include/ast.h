@@ -49,6 +49,13 @@ void dummy_print(void*, FILE*);
 void int_attr_print(void*, FILE*);
 
 
+/*
+ * Symbols and symbol tables are declared in symbol.h (which depends on this
+ * file); nodes only need to hold references to them.
+ */
+struct Symbol;
+struct SymbolTable;
+
 /**
  * @brief AST node type tag
  */
@@ -347,6 +354,7 @@ struct ASTNode* UnaryOpNode_new (UnaryOpType operator, struct ASTNode* child, in
 typedef struct LocationNode {
     char name[MAX_ID_LEN];      /**< @brief Location/variable name */
     struct ASTNode* index;      /**< @brief Index expression (can be @c NULL for non-array locations) */
+    struct Symbol* symbol;      /**< @brief Resolved symbol (set by name resolution; @c NULL if undefined) */
 } LocationNode;
 
 /**
@@ -365,6 +373,7 @@ struct ASTNode* LocationNode_new (const char* name, struct ASTNode* index, int s
 typedef struct FuncCallNode {
     char name[MAX_ID_LEN];      /**< @brief Function name */
     struct NodeList* arguments; /**< @brief List of actual parameters/arguments */
+    struct Symbol* symbol;      /**< @brief Resolved symbol (set by name resolution; @c NULL if undefined) */
 } FuncCallNode;
 
 /**
@@ -490,6 +499,10 @@ typedef struct ASTNode
         struct FuncCallNode funccall;
         struct LiteralNode literal;
     };
+
+    struct SymbolTable* scope;  /**< @brief Innermost enclosing symbol table (set by @ref
+                                            BuildSymbolTablesVisitor_new; for program, function,
+                                            and block nodes this is their own table) */
 } ASTNode;
 
 /*
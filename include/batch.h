@@ -0,0 +1,61 @@
+/**
+ * @file batch.h
+ * @brief Analysis of many source files in one run (@c decaf @c -j @c N ...)
+ *
+ * Each file is compiled as a separate job on a @ref ThreadPool, with its own
+ * @ref DecafContext, and writes its output (everything a single-file run
+ * prints, statistics included, since both run @ref compile_source) to a
+ * private buffer. A buffer is
+ * written out as soon as every file before it has been, so outputs appear in
+ * the order the files were given, each after a header line:
+ *
+ *     ==> path/to/file.decaf <==
+ *
+ * so the output does not depend on the number of workers or on scheduling.
+ * With a @ref ResultCache, files whose output is already cached are not
+ * compiled at all; their stored output is replayed instead.
+ */
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include "cache.h"
+#include "compile.h"
+
+/**
+ * @brief Settings shared by every file in a batch
+ */
+typedef struct BatchOptions
+{
+    CompileOptions compile;         /**< @brief How to compile each file */
+    int jobs;                       /**< @brief Number of worker threads */
+    bool headers;                   /**< @brief Print a header line before each file's output */
+    ResultCache* cache;             /**< @brief Where to look up and store outputs (@c NULL for none) */
+} BatchOptions;
+
+/**
+ * @brief Add the file names listed in a file (one per line) to a list
+ *
+ * Blank lines are skipped, and surrounding whitespace is removed.
+ *
+ * @param listfile Name of the file to read
+ * @param files Growable array of names (each name is newly allocated)
+ * @param num_files Number of names in @p files
+ * @param capacity Allocated length of @p files
+ * @returns True if and only if the list could be read
+ */
+bool batch_read_list (const char* listfile, char*** files, int* num_files, int* capacity);
+
+/**
+ * @brief Compile a batch of files and print their outputs in order
+ *
+ * @param files Names of the files to compile
+ * @param num_files Number of names in @p files
+ * @param options Settings for every file
+ * @param output Stream for the grouped outputs
+ * @returns Number of files that could not be read, did not parse, or had
+ * static analysis errors (a file that cannot be compiled for lack of a
+ * temporary stream counts as failed; the rest of the batch still runs)
+ */
+int decaf_batch (char** files, int num_files, const BatchOptions* options, FILE* output);
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file cache.h
+ * @brief On-disk cache of analysis results (@c decaf @c --cache=DIR)
+ *
+ * A @ref ResultCache remembers the exact output of analyzing a source file
+ * (its diagnostics, or its symbol tables) in a local directory, keyed by a
+ * hash of the source bytes, the compiler's build ID, and every option that
+ * affects the output. A later run with the same key replays the stored output
+ * instead of lexing, parsing, and analyzing the file again.
+ *
+ * The directory must already exist. Besides one @c <key>.out file per entry
+ * it holds an @c index file with every entry's size and last use, plus the
+ * hit/miss statistics. When the entries' total size exceeds the limit, the
+ * least recently used entries are evicted.
+ *
+ * Several processes may share one directory (and threads within a process
+ * may share one @ref ResultCache). Each process keeps the index in memory
+ * and merges its changes into the file every few stores and when it closes
+ * the cache: it takes the @c index.lock file, re-reads the index, applies
+ * its own stores, uses, and removals, evicts down to the limit, and replaces
+ * the index by renaming a new copy over it. No process's entries are lost,
+ * and every output file stays accounted for in the size limit.
+ */
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include "common.h"
+
+#include <threads.h>
+
+/**
+ * @brief Default limit on the total size of the cached outputs (in bytes)
+ */
+#define RESULT_CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+/**
+ * @brief One cached result
+ */
+typedef struct ResultCacheEntry
+{
+    uint64_t key;                   /**< @brief Hash of the source, build ID, and options */
+    size_t size;                    /**< @brief Size of the stored output (in bytes) */
+    uint64_t last_use;              /**< @brief Value of the cache's clock when last stored or replayed */
+    bool failed;                    /**< @brief Whether the compilation failed */
+    bool changed;                   /**< @brief Stored or replayed since the index file was last merged */
+    int older;                      /**< @brief Next less recently used entry (-1 for none) */
+    int newer;                      /**< @brief Next more recently used entry (-1 for none) */
+} ResultCacheEntry;
+
+/**
+ * @brief Hit/miss counters
+ */
+typedef struct ResultCacheStats
+{
+    long hits;                      /**< @brief Lookups that replayed a stored result */
+    long misses;                    /**< @brief Lookups that found nothing */
+    long stores;                    /**< @brief Results added to the cache */
+    long evictions;                 /**< @brief Entries removed to stay under the size limit */
+} ResultCacheStats;
+
+/**
+ * @brief Open cache directory
+ */
+typedef struct ResultCache
+{
+    char directory[MAX_LINE_LEN - 32];  /**< @brief Directory holding the entries and the index */
+    size_t max_size;                /**< @brief Limit on the total size of the entries */
+    size_t total_size;              /**< @brief Total size of the entries */
+    ResultCacheEntry* entries;      /**< @brief Entries (in no particular order) */
+    int size;                       /**< @brief Number of entries */
+    int capacity;                   /**< @brief Allocated length of @c entries */
+    int* slots;                     /**< @brief Hash table of indices into @c entries, by key (-1 if empty) */
+    int num_slots;                  /**< @brief Length of @c slots (a power of two) */
+    int oldest;                     /**< @brief Least recently used entry (-1 if empty) */
+    int newest;                     /**< @brief Most recently used entry (-1 if empty) */
+    uint64_t* removed;              /**< @brief Keys removed since the index file was last merged */
+    int num_removed;                /**< @brief Number of keys in @c removed */
+    int removed_capacity;           /**< @brief Allocated length of @c removed */
+    int changes;                    /**< @brief Stores and removals since the index file was last merged */
+    uint64_t clock;                 /**< @brief Incremented on every use (for LRU order) */
+    ResultCacheStats run;           /**< @brief Counters for this process */
+    ResultCacheStats merged;        /**< @brief Value of @c run when the index file was last merged */
+    ResultCacheStats total;         /**< @brief Counters for the directory's lifetime (including @c run) */
+    mtx_t lock;                     /**< @brief Protects everything above */
+} ResultCache;
+
+/**
+ * @brief Open a cache directory and read its index
+ *
+ * @param directory Existing directory (created entries go here)
+ * @param max_size Limit on the total size of the cached outputs (in bytes)
+ * @returns Newly allocated cache, or @c NULL if the directory is not usable
+ */
+ResultCache* ResultCache_open (const char* directory, size_t max_size);
+
+/**
+ * @brief Compute the key for a source file compiled with some options
+ *
+ * @param text Source bytes
+ * @param length Number of bytes in @p text
+ * @param options Description of every option that affects the output
+ * @returns Key (which also covers the compiler's build ID)
+ */
+uint64_t ResultCache_key (const char* text, size_t length, const char* options);
+
+/**
+ * @brief Replay a stored result if there is one
+ *
+ * @param cache Cache to search
+ * @param key Key of the result
+ * @param output Stream to copy the stored output to
+ * @param failed Set to whether the cached compilation failed (on a hit)
+ * @returns True on a hit
+ */
+bool ResultCache_replay (ResultCache* cache, uint64_t key, FILE* output, bool* failed);
+
+/**
+ * @brief Store a result, evicting least recently used entries as needed
+ *
+ * @param cache Cache to store in
+ * @param key Key of the result
+ * @param output Stream holding the output (read from the beginning to the end)
+ * @param failed Whether the compilation failed
+ */
+void ResultCache_store (ResultCache* cache, uint64_t key, FILE* output, bool failed);
+
+/**
+ * @brief Print this run's and the directory's hit/miss statistics
+ *
+ * @param cache Cache to report on
+ * @param output File stream to print to
+ */
+void ResultCache_print_stats (ResultCache* cache, FILE* output);
+
+/**
+ * @brief Merge this process's changes into the index file and deallocate a cache
+ */
+void ResultCache_close (ResultCache* cache);
+
+#endif
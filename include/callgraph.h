@@ -0,0 +1,123 @@
+/**
+ * @file callgraph.h
+ * @brief Call graph, strongly connected components, and bottom-up order
+ *
+ * A @ref CallGraph has one node per function declared in a program and one
+ * edge per call site whose target is one of those functions (calls to the
+ * built-in @c print_* functions have no declaration to point to, so they are
+ * not edges). It is built from the symbols that name resolution stores on
+ * each call, after static analysis.
+ *
+ * Mutually recursive functions are grouped into strongly connected
+ * components (SCCs) with Tarjan's algorithm. Tarjan's algorithm finishes an
+ * SCC only after every SCC it calls, so @ref CallGraph.sccs is already in
+ * bottom-up order: a pass that summarizes callees before their callers can
+ * simply walk it front to back.
+ *
+ * Each SCC also gets a level: 0 if it calls no other SCC, and otherwise one
+ * more than the highest level it calls. SCCs on the same level never call
+ * each other, so each level is a batch of SCCs that can be processed in
+ * parallel once every lower level is done.
+ *
+ * All nodes, edges, and SCCs live in a few flat arrays owned by the graph,
+ * and construction is linear in the size of the program.
+ */
+#ifndef __CALLGRAPH_H
+#define __CALLGRAPH_H
+
+#include "symbol.h"
+
+/**
+ * @brief Call site whose target is a declared function
+ */
+typedef struct CallGraphEdge
+{
+    int callee;                     /**< @brief Node of the called function */
+    ASTNode* site;                  /**< @brief Call (@c FUNCCALL node) */
+} CallGraphEdge;
+
+/**
+ * @brief Declared function
+ */
+typedef struct CallGraphNode
+{
+    ASTNode* function;              /**< @brief Function declaration (@c FUNCDECL node) */
+    const Symbol* symbol;           /**< @brief Function symbol (from the global scope) */
+    int first_edge;                 /**< @brief Index of the function's first call in @c edges */
+    int num_edges;                  /**< @brief Number of calls the function makes */
+    int scc;                        /**< @brief Index of the function's SCC in @c sccs */
+} CallGraphNode;
+
+/**
+ * @brief Strongly connected component (a function or a set of mutually
+ * recursive functions)
+ */
+typedef struct CallGraphSCC
+{
+    int first_member;               /**< @brief Index of the first function in @c members */
+    int num_members;                /**< @brief Number of functions */
+    int level;                      /**< @brief Height above the SCCs that call nothing */
+    bool recursive;                 /**< @brief True if a function can call itself, directly or not */
+} CallGraphSCC;
+
+/**
+ * @brief Call graph of a whole program
+ */
+typedef struct CallGraph
+{
+    CallGraphNode* nodes;           /**< @brief Functions, in declaration order */
+    int num_nodes;                  /**< @brief Number of functions */
+    CallGraphEdge* edges;           /**< @brief Call sites, grouped by caller and in source order within a group */
+    int num_edges;                  /**< @brief Number of call sites */
+    CallGraphSCC* sccs;             /**< @brief SCCs in bottom-up order (callees before callers) */
+    int num_sccs;                   /**< @brief Number of SCCs */
+    int* members;                   /**< @brief Functions of all SCCs (node indices), SCC by SCC */
+    int* levels;                    /**< @brief SCCs (indices) grouped by level, in bottom-up order within a level */
+    int* level_starts;              /**< @brief Index in @c levels of each level's first SCC (plus an end marker) */
+    int num_levels;                 /**< @brief Number of levels */
+    PointerMap functions;           /**< @brief Map from function symbol to node index */
+} CallGraph;
+
+/**
+ * @brief Iterate over the calls a function makes
+ *
+ * @param VAR Name of the @c CallGraphEdge* variable that points to each call
+ * @param GRAPH Graph
+ * @param NODE Index of the calling function
+ */
+#define FOR_EACH_CALL(VAR, GRAPH, NODE) \
+    for (CallGraphEdge* VAR = (GRAPH)->edges + (GRAPH)->nodes[NODE].first_edge; \
+         VAR < (GRAPH)->edges + (GRAPH)->nodes[NODE].first_edge + (GRAPH)->nodes[NODE].num_edges; VAR++)
+
+/**
+ * @brief Build the call graph of a program and order its SCCs
+ *
+ * Calls whose names did not resolve to a declared function are skipped, so
+ * this also works on programs with static analysis errors.
+ *
+ * @param tree AST of an analyzed program
+ * @returns Newly allocated graph
+ */
+CallGraph* CallGraph_build (ASTNode* tree);
+
+/**
+ * @brief Look up the node of a function
+ *
+ * @returns Index of the function's node, or -1 if it is not a declared function
+ */
+int CallGraph_find (CallGraph* graph, const Symbol* symbol);
+
+/**
+ * @brief Print the calls, SCCs, and levels of a graph
+ *
+ * @param graph Graph to print
+ * @param output File stream to print to
+ */
+void CallGraph_print (CallGraph* graph, FILE* output);
+
+/**
+ * @brief Deallocate a graph (the AST is not affected)
+ */
+void CallGraph_free (CallGraph* graph);
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * @file cfg.h
+ * @brief Control-flow graphs of function bodies
+ *
+ * A @ref ControlFlowGraph lowers the body of one function into basic blocks.
+ * Each block holds a contiguous range of @ref ControlFlowGraph.items, which
+ * are the statements it executes in order:
+ *
+ * - local variable declarations (@c VARDECL nodes, at the point where their
+ *   block is entered),
+ * - assignments and function calls,
+ * - @c return, @c break, and @c continue statements (always last in their
+ *   basic block).
+ *
+ * A block that ends in an @c if or @c while test records the condition in
+ * @c branch and has two successors: the block taken when the condition is
+ * true, then the one taken when it is false. If the condition is a literal
+ * @c true or @c false, only the successor it always takes is linked, so
+ * analyses do not see paths that can never run (e.g., out of a
+ * @c while @c (true) loop other than through a @c break). Every other block
+ * has at most one successor. Block 0 is the entry, and the last block is an empty exit
+ * block that every @c return (and the end of the body) leads to. Statements
+ * that cannot be reached (e.g., after a @c return) still get blocks, but
+ * those blocks have no predecessors and are not numbered in reverse
+ * postorder.
+ *
+ * All blocks, items, and edges live in a few flat arrays owned by the graph,
+ * and construction is linear in the size of the function.
+ */
+#ifndef __CFG_H
+#define __CFG_H
+
+#include "ast.h"
+
+/**
+ * @brief Basic block
+ */
+typedef struct CFGBlock
+{
+    int first_item;                 /**< @brief Index of the first statement in @c items */
+    int num_items;                  /**< @brief Number of statements */
+    ASTNode* branch;                /**< @brief Condition tested at the end (@c NULL if none) */
+    int first_succ;                 /**< @brief Index of the first successor in @c successors */
+    int num_succ;                   /**< @brief Number of successors */
+    int first_pred;                 /**< @brief Index of the first predecessor in @c predecessors */
+    int num_pred;                   /**< @brief Number of predecessors */
+    int rpo;                        /**< @brief Position in reverse postorder (-1 if unreachable) */
+} CFGBlock;
+
+/**
+ * @brief Control-flow edge
+ */
+typedef struct CFGEdge
+{
+    int from;                       /**< @brief Source block */
+    int to;                         /**< @brief Target block */
+} CFGEdge;
+
+/**
+ * @brief Control-flow graph of one function
+ */
+typedef struct ControlFlowGraph
+{
+    ASTNode* function;              /**< @brief Function declaration the graph was built from */
+    CFGBlock* blocks;               /**< @brief Basic blocks (entry first, exit last) */
+    int num_blocks;                 /**< @brief Number of blocks */
+    ASTNode** items;                /**< @brief Statements of all blocks, block by block */
+    int num_items;                  /**< @brief Number of statements */
+    CFGEdge* edges;                 /**< @brief Edges, in the order they were added */
+    int num_edges;                  /**< @brief Number of edges */
+    int* successors;                /**< @brief Successor lists of all blocks (block indices) */
+    int* predecessors;              /**< @brief Predecessor lists of all blocks (block indices) */
+    int* rpo;                       /**< @brief Reachable blocks in reverse postorder */
+    int num_reachable;              /**< @brief Number of reachable blocks (length of @c rpo) */
+    int capacity_blocks;            /**< @brief Allocated length of @c blocks */
+    int capacity_items;             /**< @brief Allocated length of @c items */
+    int capacity_edges;             /**< @brief Allocated length of @c edges */
+} ControlFlowGraph;
+
+/**
+ * @brief Index of the exit block of a graph
+ */
+#define CFG_EXIT(cfg) ((cfg)->num_blocks - 1)
+
+/**
+ * @brief Iterate over the successors of a block
+ *
+ * @param VAR Name of the @c int variable that holds each successor's index
+ * @param CFG Graph
+ * @param BLOCK Index of the block
+ */
+#define FOR_EACH_SUCC(VAR, CFG, BLOCK) \
+    for (int VAR##_i = 0, VAR; VAR##_i < (CFG)->blocks[BLOCK].num_succ && \
+            ((VAR = (CFG)->successors[(CFG)->blocks[BLOCK].first_succ + VAR##_i]), true); VAR##_i++)
+
+/**
+ * @brief Iterate over the predecessors of a block
+ *
+ * @param VAR Name of the @c int variable that holds each predecessor's index
+ * @param CFG Graph
+ * @param BLOCK Index of the block
+ */
+#define FOR_EACH_PRED(VAR, CFG, BLOCK) \
+    for (int VAR##_i = 0, VAR; VAR##_i < (CFG)->blocks[BLOCK].num_pred && \
+            ((VAR = (CFG)->predecessors[(CFG)->blocks[BLOCK].first_pred + VAR##_i]), true); VAR##_i++)
+
+/**
+ * @brief Build the control-flow graph of a function
+ *
+ * @param function Function declaration (@c FUNCDECL node) of a tree that
+ * passed static analysis
+ * @returns Newly allocated graph
+ */
+ControlFlowGraph* ControlFlowGraph_build (ASTNode* function);
+
+/**
+ * @brief Print the blocks and edges of a graph
+ *
+ * @param cfg Graph to print
+ * @param output File stream to print to
+ */
+void ControlFlowGraph_print (ControlFlowGraph* cfg, FILE* output);
+
+/**
+ * @brief Build, print, and deallocate the graph of every function in a program
+ *
+ * @param tree AST of a program that passed static analysis
+ * @param output File stream to print to
+ */
+void ControlFlowGraph_print_program (ASTNode* tree, FILE* output);
+
+/**
+ * @brief Deallocate a graph (the AST is not affected)
+ */
+void ControlFlowGraph_free (ControlFlowGraph* cfg);
+
+#endif
@@ -26,6 +26,7 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -83,22 +84,179 @@ const char* DecafType_to_string(DecafType type);
  */
 void print_escaped_string(const char* string, FILE* output);
 
+/**
+ * @brief Hash a string using 64-bit FNV-1a
+ *
+ * @param string String to hash
+ * @returns 64-bit hash value
+ */
+uint64_t hash_string(const char* string);
+
+/**
+ * @brief Hash a block of bytes using 64-bit FNV-1a
+ *
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @returns 64-bit hash value
+ */
+uint64_t hash_bytes(const void* data, size_t size);
+
+/**
+ * @brief Mix a value into a running 64-bit hash
+ *
+ * @param hash Current hash value
+ * @param value Value to mix in
+ * @returns Combined hash value
+ */
+uint64_t hash_combine(uint64_t hash, uint64_t value);
+
+/**
+ * @brief Outcome of @ref read_file
+ */
+typedef enum ReadStatus {
+    READ_OK,            /**< @brief The whole file was read */
+    READ_FAILED,        /**< @brief The file could not be opened or read */
+    READ_TOO_LARGE      /**< @brief The file is longer than #MAX_FILE_SIZE bytes */
+} ReadStatus;
+
+/**
+ * @brief Read all text data from a file
+ *
+ * The text is always NUL-terminated, so a file of up to #MAX_FILE_SIZE bytes
+ * needs a buffer of #MAX_FILE_SIZE + 1 characters. A longer file is rejected
+ * rather than truncated; @p text then holds its first #MAX_FILE_SIZE bytes,
+ * which must not be compiled.
+ *
+ * @param filename Name of file to read
+ * @param text String buffer destination (must be #MAX_FILE_SIZE + 1 characters long)
+ * @returns @c READ_OK if and only if the whole file was read
+ */
+ReadStatus read_file (const char* filename, char* text);
+
 /**
  * @brief Throw an exception with an error message using @c printf syntax
  *
  * This function uses the @c longjmp functionality in the standard C library to
  * implement exception handling for the lexing and parsing phases. The code
- * that might throw an exception must be wrapped in a @c setjmp block.
- *
- * Because this function must have access to the @c jmp_buf used to connect the
- * @c setjmp callsite with the @c longjmp, this function must be implemented in
- * the compiler or test driver (where the @c setjmp call will be) in other to
- * avoid having an @c extern static variable. Thus, there is no implementation
- * in @c common.c, and it is only declared here so that it can be called in the
- * various front end phases of compilation.
+ * that might throw an exception must be wrapped in a @c setjmp block on the
+ * calling thread's current @ref DecafContext (see context.h, where this
+ * function is implemented); the message is stored in that context.
  */
 void Error_throw_printf (const char* format, ...);
 
+/**
+ * @brief Memory accounting categories
+ *
+ * Every heap allocation made through @ref Memory_calloc is tagged with one of
+ * these so that @ref Memory_print_report can break memory use down by
+ * compiler subsystem.
+ */
+typedef enum MemoryCategory {
+    MEM_TOKEN,          /**< @brief Tokens, token queues, and lexer regexes */
+    MEM_AST,            /**< @brief AST nodes and node lists */
+    MEM_ATTRIBUTE,      /**< @brief AST attribute records */
+    MEM_SYMBOL,         /**< @brief Symbols, symbol lists, and symbol tables */
+    MEM_PARAMETER,      /**< @brief Parameters and parameter lists */
+    MEM_ERROR,          /**< @brief Static analysis errors and error lists */
+    MEM_ANALYSIS,       /**< @brief Visitors and other analysis state */
+    MEM_NUM_CATEGORIES  /**< @brief Number of categories (not a real category) */
+} MemoryCategory;
+
+/**
+ * @brief Set of memory usage counters
+ *
+ * Each thread charges its allocations to one account (a process-wide account
+ * unless @ref Memory_set_account says otherwise), so separate compilations
+ * can be measured separately. Every block remembers the account it was
+ * charged to, so it can be freed on any thread.
+ */
+typedef struct MemoryAccount MemoryAccount;
+
+/**
+ * @brief Allocate a new account with all counters at zero
+ */
+MemoryAccount* MemoryAccount_new ();
+
+/**
+ * @brief Release an account
+ *
+ * Blocks still charged to the account stay valid; the account itself is
+ * deallocated when the last of them is freed.
+ */
+void MemoryAccount_free (MemoryAccount* account);
+
+/**
+ * @brief Charge the calling thread's future allocations to an account
+ *
+ * @param account Account to use (@c NULL for the process-wide account)
+ * @returns Account that was in use before the call (@c NULL if process-wide)
+ */
+MemoryAccount* Memory_set_account (MemoryAccount* account);
+
+/**
+ * @brief Allocate zero-initialized memory and account for it
+ *
+ * Drop-in replacement for @c calloc; the result must be checked with @ref
+ * CHECK_MALLOC_PTR and released with @ref Memory_free (never @c free). The
+ * block is charged to the calling thread's current account.
+ *
+ * @param category Accounting category for the allocation
+ * @param count Number of elements
+ * @param size Size (in bytes) of each element
+ * @returns Pointer to the allocated memory (or @c NULL if out of memory)
+ */
+void* Memory_calloc (MemoryCategory category, size_t count, size_t size);
+
+/**
+ * @brief Resize memory allocated by @ref Memory_calloc
+ *
+ * The block keeps its accounting category and account; any bytes beyond the
+ * old size are zero-initialized. The old pointer is invalid afterwards (unless
+ * the allocation fails, in which case it is untouched and @c NULL is
+ * returned).
+ *
+ * @param ptr Pointer to resize (must not be @c NULL)
+ * @param count New number of elements
+ * @param size Size (in bytes) of each element
+ * @returns Pointer to the resized memory (or @c NULL if out of memory)
+ */
+void* Memory_realloc (void* ptr, size_t count, size_t size);
+
+/**
+ * @brief Release memory allocated by @ref Memory_calloc
+ *
+ * Has the same signature as @c free, so it can be used as a @c Destructor.
+ *
+ * @param ptr Pointer to release (may be @c NULL)
+ */
+void Memory_free (void* ptr);
+
+/**
+ * @brief Start recording the calling thread's allocations
+ *
+ * Used to reclaim everything allocated by code that may be abandoned halfway
+ * (e.g., a front end phase that throws with @ref Error_throw_printf). Blocks
+ * recorded by a capture must be freed on the same thread until it ends.
+ */
+void Memory_begin_capture ();
+
+/**
+ * @brief Stop recording the calling thread's allocations
+ *
+ * @param release If true, free every recorded block that is still live
+ */
+void Memory_end_capture (bool release);
+
+/**
+ * @brief Print live bytes/objects and peaks for each memory category
+ *
+ * Reports on the calling thread's current account.
+ *
+ * @param phase Name of the compiler phase that just finished
+ * @param output File stream to print the report to
+ */
+void Memory_print_report (const char* phase, FILE* output);
+
 /**
  * @brief Check a pointer for NULL and terminate with an out-of-memory error
  * 
@@ -110,6 +268,54 @@ void Error_throw_printf (const char* format, ...);
         exit(EXIT_FAILURE); \
     }
 
+/**
+ * @brief Map from pointers to non-negative integers
+ *
+ * Used by analyses to number the symbols (or other objects) they track, e.g.,
+ * the functions of a call graph or the variables of a data-flow problem. Keys
+ * live in an open-addressing array (linear probing) that doubles whenever it
+ * would become more than half full, so lookups take expected constant time.
+ * Entries cannot be removed.
+ */
+typedef struct PointerMap {
+    const void** keys;          /**< @brief Key in each slot (@c NULL if the slot is empty) */
+    int* values;                /**< @brief Value in each slot */
+    int capacity;               /**< @brief Number of slots (a power of two) */
+    int size;                   /**< @brief Number of entries */
+    MemoryCategory category;    /**< @brief Accounting category of the slot arrays */
+} PointerMap;
+
+/**
+ * @brief Initialize an empty map
+ *
+ * @param map Map to initialize
+ * @param expected Number of entries to make room for up front (may be 0)
+ * @param category Accounting category for the map's memory
+ */
+void PointerMap_init (PointerMap* map, int expected, MemoryCategory category);
+
+/**
+ * @brief Look up the value of a key
+ *
+ * @returns The key's value, or -1 if the key is not in the map
+ */
+int PointerMap_find (const PointerMap* map, const void* key);
+
+/**
+ * @brief Add a key unless it is already in the map
+ *
+ * @param map Map to insert into
+ * @param key Key to insert (must not be @c NULL)
+ * @param value Value for the key if it is new
+ * @returns The key's value (the earlier one if the key was already there)
+ */
+int PointerMap_insert (PointerMap* map, const void* key, int value);
+
+/**
+ * @brief Release a map's memory (the map itself is not freed)
+ */
+void PointerMap_free (PointerMap* map);
+
 /**
  * @brief Declare a singly-linked list structure of the given type
  * 
@@ -154,11 +360,12 @@ void Error_throw_printf (const char* format, ...);
  * @param NAME Prefix for the list struct name (actual name will be @c NAMEList)
  * @param ELEMTYPE Type of the elements to be stored (must be a struct pointer)
  * @param FREEFUNC Name of the function to call to deallocate each element
+ * @param CATEGORY @ref MemoryCategory to charge the list structure to
  */
-#define DEF_LIST_IMPL(NAME, ELEMTYPE, FREEFUNC) \
+#define DEF_LIST_IMPL(NAME, ELEMTYPE, FREEFUNC, CATEGORY) \
     NAME ## List* NAME ## List_new () \
     { \
-        NAME ## List* list = (NAME ## List*)calloc(1, sizeof(NAME ## List)); \
+        NAME ## List* list = (NAME ## List*)Memory_calloc(CATEGORY, 1, sizeof(NAME ## List)); \
         CHECK_MALLOC_PTR(list); \
         list->head = NULL; \
         list->tail = NULL; \
@@ -192,7 +399,7 @@ void Error_throw_printf (const char* format, ...);
             next = cur->next; \
             FREEFUNC(cur); \
         } \
-        free(list); \
+        Memory_free(list); \
     }
 
 /**
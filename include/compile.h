@@ -0,0 +1,54 @@
+/**
+ * @file compile.h
+ * @brief The compiler pipeline shared by every way of running it
+ *
+ * @ref compile_source runs one source text through the front and middle end
+ * and then through whichever optional passes and dumps are enabled:
+ *
+ *     analysis -> fold -> dce -> check-init -> errors -> allocate ->
+ *     symbol tables -> xref -> call graph -> CFGs -> AST graph
+ *
+ * A single-file run writes the results to @c stdout and the statistics to
+ * @c stderr; each file in a batch passes its private output stream for both.
+ */
+#ifndef __COMPILE_H
+#define __COMPILE_H
+
+#include "decaf.h"
+
+/**
+ * @brief Settings of one compilation
+ */
+typedef struct CompileOptions
+{
+    bool hash_cons;                 /**< @brief Hash-cons expressions before analysis */
+    bool mem_report;                /**< @brief Report memory use after each phase */
+    bool fold;                      /**< @brief Fold constants */
+    bool dce;                       /**< @brief Remove dead code */
+    bool check_init;                /**< @brief Report reads of possibly unassigned locals */
+    bool allocate;                  /**< @brief Lay out storage */
+    bool xref;                      /**< @brief Print the cross-reference index */
+    bool callgraph;                 /**< @brief Print the call graph */
+    bool cfg;                       /**< @brief Print the control-flow graphs */
+    int threads;                    /**< @brief Number of analysis threads */
+    int max_errors;                 /**< @brief Error limit (0 for none) */
+} CompileOptions;
+
+/**
+ * @brief Compile one source text
+ *
+ * The compilation runs in a new @ref DecafContext, which is current only for
+ * the duration of the call, so compilations on different threads share
+ * nothing.
+ *
+ * @param text Source code (NUL-terminated)
+ * @param options Settings
+ * @param output Stream for diagnostics and dumps
+ * @param diagnostics Stream for fatal errors and statistics
+ * @param graph Stream for the DOT rendering of the AST (@c NULL for none)
+ * @returns @ref DECAF_OK if there were no errors, or the kind of failure
+ */
+DecafStatus compile_source (char* text, const CompileOptions* options,
+                            FILE* output, FILE* diagnostics, FILE* graph);
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file context.h
+ * @brief Per-compilation state
+ *
+ * A @ref DecafContext holds the state that a compilation used to keep in
+ * process-wide variables: the jump target and message buffer used by @ref
+ * Error_throw_printf, the memory account charged by @ref Memory_calloc, and
+ * counters such as the next AST graph node id. Compilations that use separate
+ * contexts do not interfere, whether they run one after another on the same
+ * thread or at the same time on different threads.
+ *
+ * The front end phases have fixed signatures, so a context is not passed as a
+ * parameter; instead, each thread has a current context (a private default
+ * one until @ref DecafContext_set_current is called) that they find through
+ * @ref DecafContext_current. A @ref ThreadPool makes the caller's context
+ * current on its workers while they run the caller's jobs.
+ *
+ * Typical use:
+ *
+ *     DecafContext* context = DecafContext_new();
+ *     DecafContext* previous = DecafContext_set_current(context);
+ *     DecafContext_arm(context);
+ *     if (setjmp(context->error_jump) == 0) {
+ *         tree = parse(lex(text));
+ *     } else {
+ *         fprintf(stderr, "%s", context->error_msg);
+ *     }
+ *     DecafContext_disarm(context);
+ *     ...
+ *     DecafContext_set_current(previous);
+ *     DecafContext_free(context);
+ */
+#ifndef __CONTEXT_H
+#define __CONTEXT_H
+
+#include "common.h"
+
+#include <threads.h>
+
+/**
+ * @brief State owned by a single compilation
+ */
+typedef struct DecafContext
+{
+    jmp_buf error_jump;             /**< @brief Target for @ref Error_throw_printf (valid while armed) */
+    bool armed;                     /**< @brief True if @c error_jump is valid */
+    thrd_t armed_thread;            /**< @brief Thread that called @c setjmp on @c error_jump */
+    char error_msg[MAX_ERROR_LEN];  /**< @brief Message of the last thrown error */
+    MemoryAccount* memory;          /**< @brief Account charged for the compilation's allocations */
+    int next_dot_id;                /**< @brief Next node id for @ref GenerateASTGraph_new */
+    int max_errors;                 /**< @brief Stop analyzing after this many errors (0 for no limit) */
+} DecafContext;
+
+/**
+ * @brief Allocate a new context with its own memory account
+ */
+DecafContext* DecafContext_new ();
+
+/**
+ * @brief Deallocate a context
+ *
+ * Memory allocated while the context was current stays valid (see @ref
+ * MemoryAccount_free).
+ */
+void DecafContext_free (DecafContext* context);
+
+/**
+ * @brief Make a context current on the calling thread
+ *
+ * Also charges the thread's allocations to the context's memory account. The
+ * same context may be current on several threads at once.
+ *
+ * @param context Context to use (@c NULL for the thread's default context)
+ * @returns Context that was current before the call (@c NULL if the default)
+ */
+DecafContext* DecafContext_set_current (DecafContext* context);
+
+/**
+ * @brief Look up the calling thread's current context
+ *
+ * @returns Current context (never @c NULL)
+ */
+DecafContext* DecafContext_current ();
+
+/**
+ * @brief Mark @c error_jump as valid on the calling thread
+ *
+ * Call immediately before @c setjmp(context->error_jump). Errors thrown on any
+ * other thread (or while the context is not armed) are fatal: the message is
+ * printed to @c stderr and the process exits.
+ */
+void DecafContext_arm (DecafContext* context);
+
+/**
+ * @brief Mark @c error_jump as invalid (e.g., before the @c setjmp caller returns)
+ */
+void DecafContext_disarm (DecafContext* context);
+
+#endif
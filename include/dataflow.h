@@ -0,0 +1,241 @@
+/**
+ * @file dataflow.h
+ * @brief Bit-vector dataflow analysis over control-flow graphs
+ *
+ * A @ref DataflowAnalysis solves a forward or backward "gen/kill" problem on
+ * a @ref ControlFlowGraph: every block has a transfer function
+ *
+ *     result = gen | (input & ~kill)
+ *
+ * and the input of a block is the union (may analyses) or intersection (must
+ * analyses) of its neighbors' results. Sets are dense bit vectors stored in
+ * 64-bit words, so applying a transfer function or a meet handles 64 facts
+ * per operation. The solver keeps a worklist ordered by reverse postorder (or
+ * postorder, for backward problems), so acyclic code converges in one pass
+ * and loops in a few.
+ *
+ * Three clients are provided, all over the scalar parameters and locals of
+ * one function (see @ref VariableIndex):
+ *
+ * - @ref Liveness_solve: variables that may be read before being assigned
+ *   again (backward, union).
+ * - @ref ReachingDefinitions_solve: assignments that may reach each block
+ *   (forward, union).
+ * - @ref DefiniteAssignment_check: reports reads of locals that are not
+ *   assigned on every path from their declaration (forward, intersection).
+ *
+ * Globals are not tracked, since any call may read or write them.
+ */
+#ifndef __DATAFLOW_H
+#define __DATAFLOW_H
+
+#include "cfg.h"
+#include "symbol.h"
+
+/**
+ * @brief Number of bits in a bit-vector word
+ */
+#define BITSET_WORD_BITS 64
+
+/**
+ * @brief Number of words needed for a set of @p bits bits
+ */
+#define BITSET_WORDS(bits) (((bits) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+
+/**
+ * @brief Check whether a bit is set
+ */
+bool BitSet_test (const uint64_t* set, int bit);
+
+/**
+ * @brief Set a bit
+ */
+void BitSet_set (uint64_t* set, int bit);
+
+/**
+ * @brief Clear a bit
+ */
+void BitSet_clear (uint64_t* set, int bit);
+
+/**
+ * @brief Add every element of @p other to @p set (in place)
+ */
+void BitSet_union (uint64_t* set, const uint64_t* other, int words);
+
+/**
+ * @brief Remove every element not in @p other from @p set (in place)
+ */
+void BitSet_intersect (uint64_t* set, const uint64_t* other, int words);
+
+/**
+ * @brief Remove every element of @p other from @p set (in place)
+ */
+void BitSet_difference (uint64_t* set, const uint64_t* other, int words);
+
+/**
+ * @brief Direction in which facts flow
+ */
+typedef enum DataflowDirection {
+    DATAFLOW_FORWARD,               /**< @brief From the entry toward the exit */
+    DATAFLOW_BACKWARD               /**< @brief From the exit toward the entry */
+} DataflowDirection;
+
+/**
+ * @brief How the facts of several neighbors are combined
+ */
+typedef enum DataflowMeet {
+    DATAFLOW_UNION,                 /**< @brief A fact holds if it holds on some path */
+    DATAFLOW_INTERSECTION           /**< @brief A fact holds if it holds on every path */
+} DataflowMeet;
+
+/**
+ * @brief Gen/kill dataflow problem and its solution
+ *
+ * Every per-block array holds @c words words per block, block by block. The
+ * client fills in @c gen, @c kill, and @c boundary, then calls @ref
+ * DataflowAnalysis_solve. Unreachable blocks are ignored.
+ */
+typedef struct DataflowAnalysis
+{
+    ControlFlowGraph* cfg;          /**< @brief Graph the problem is posed on */
+    DataflowDirection direction;    /**< @brief Direction of the problem */
+    DataflowMeet meet;              /**< @brief Meet operator */
+    int num_bits;                   /**< @brief Number of facts */
+    int words;                      /**< @brief Words per set */
+    uint64_t* gen;                  /**< @brief Facts each block generates */
+    uint64_t* kill;                 /**< @brief Facts each block kills */
+    uint64_t* in;                   /**< @brief Facts at the start of each block (solution) */
+    uint64_t* out;                  /**< @brief Facts at the end of each block (solution) */
+    uint64_t* boundary;             /**< @brief Facts at the entry (forward) or the exit (backward) */
+    int visits;                     /**< @brief Transfer functions applied while solving */
+} DataflowAnalysis;
+
+/**
+ * @brief Allocate a problem with every set empty
+ *
+ * @param cfg Graph to analyze
+ * @param num_bits Number of facts
+ * @param direction Direction of the problem
+ * @param meet Meet operator
+ * @returns Newly allocated problem
+ */
+DataflowAnalysis* DataflowAnalysis_new (ControlFlowGraph* cfg, int num_bits,
+                                        DataflowDirection direction, DataflowMeet meet);
+
+/**
+ * @brief Get one block's set from a per-block array
+ */
+uint64_t* DataflowAnalysis_set (DataflowAnalysis* analysis, uint64_t* sets, int block);
+
+/**
+ * @brief Compute the maximal fixed point of a problem
+ */
+void DataflowAnalysis_solve (DataflowAnalysis* analysis);
+
+/**
+ * @brief Deallocate a problem (the graph is not affected)
+ */
+void DataflowAnalysis_free (DataflowAnalysis* analysis);
+
+/**
+ * @brief Dense numbering of the scalar variables of one function
+ *
+ * Parameters come first (in declaration order), then locals in the order
+ * their declarations appear in the graph.
+ */
+typedef struct VariableIndex
+{
+    const Symbol** symbols;         /**< @brief Variable of each index */
+    int size;                       /**< @brief Number of variables */
+    int num_parameters;             /**< @brief Number of parameters (indices below this) */
+    PointerMap positions;           /**< @brief Map from symbol to index */
+} VariableIndex;
+
+/**
+ * @brief Number the parameters and locals of a graph's function
+ */
+VariableIndex* VariableIndex_build (ControlFlowGraph* cfg);
+
+/**
+ * @brief Look up a variable's index
+ *
+ * @returns Index of the variable, or -1 if it is not tracked (e.g., a global)
+ */
+int VariableIndex_find (VariableIndex* vars, const Symbol* symbol);
+
+/**
+ * @brief Deallocate a variable numbering
+ */
+void VariableIndex_free (VariableIndex* vars);
+
+/**
+ * @brief Called for each read of a tracked variable
+ *
+ * @param data Client state
+ * @param variable Index of the variable
+ * @param location Location node that reads it
+ */
+typedef void (*DataflowUseFn) (void* data, int variable, ASTNode* location);
+
+/**
+ * @brief Report every read of a tracked variable in an expression, in evaluation order
+ */
+void dataflow_expression_uses (VariableIndex* vars, ASTNode* node, DataflowUseFn use, void* data);
+
+/**
+ * @brief Report every read of a tracked variable in a block statement
+ *
+ * The variable an assignment writes is not a read, but its array index is.
+ */
+void dataflow_item_uses (VariableIndex* vars, ASTNode* item, DataflowUseFn use, void* data);
+
+/**
+ * @brief Compute live variables
+ *
+ * Bit @c v of a block's @c in (@c out) set means variable @c v may be read
+ * after the start (end) of the block before it is assigned again.
+ */
+DataflowAnalysis* Liveness_solve (ControlFlowGraph* cfg, VariableIndex* vars);
+
+/**
+ * @brief Reaching definitions and the assignments they stand for
+ */
+typedef struct ReachingDefinitions
+{
+    DataflowAnalysis* analysis;     /**< @brief Solution (bit @c d is definition @c d) */
+    ASTNode** sites;                /**< @brief Assignment of each definition */
+    int* variables;                 /**< @brief Variable assigned by each definition */
+    int num_sites;                  /**< @brief Number of definitions */
+} ReachingDefinitions;
+
+/**
+ * @brief Compute the assignments to tracked variables that may reach each block
+ */
+ReachingDefinitions* ReachingDefinitions_solve (ControlFlowGraph* cfg, VariableIndex* vars);
+
+/**
+ * @brief Deallocate reaching definitions
+ */
+void ReachingDefinitions_free (ReachingDefinitions* defs);
+
+/**
+ * @brief Report reads of locals that may not have been assigned
+ *
+ * @param cfg Graph of the function to check
+ * @param vars Variables of the function
+ * @param errors List that receives an error for each such read (up to the
+ * current context's error limit)
+ * @returns Number of errors reported
+ */
+int DefiniteAssignment_check (ControlFlowGraph* cfg, VariableIndex* vars, ErrorList* errors);
+
+/**
+ * @brief Report reads of possibly unassigned locals in every function
+ *
+ * @param tree AST of a program that passed static analysis
+ * @param errors List that receives the errors
+ * @returns Number of errors reported
+ */
+int DefiniteAssignment_check_program (ASTNode* tree, ErrorList* errors);
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file dce.h
+ * @brief Dead and unreachable code elimination
+ *
+ * This module provides an AST rewriting pass that removes code which cannot
+ * affect a program's behavior, so later passes see (and walk) fewer nodes:
+ *
+ * - Statements that follow a @c return, @c break, or @c continue (or any
+ *   other statement that never completes normally, such as an @c if whose
+ *   branches both return or a @c while @c (true) loop without a @c break)
+ *   are removed.
+ * - An @c if with a literal condition is replaced by the block it always
+ *   takes (or removed, if that block is a missing @c else), and a @c while
+ *   @c (false) loop is removed.
+ * - Functions that cannot be reached through calls from @c main are removed.
+ * - Scalar locals that are never read are removed along with the assignments
+ *   to them. An assignment whose value is a function call is turned into the
+ *   call; a local assigned any other expression with a call in it is kept.
+ *
+ * Conditions are only recognized as constant if they are literals, so the
+ * pass finds the most after @ref fold_constants. The symbols of removed
+ * locals and functions are removed from their tables as well, so printing
+ * and allocation only see what is left, and nodes that are moved (a block
+ * that replaces its @c if) get their @c parent and @c depth attributes
+ * updated.
+ *
+ * The pass assumes a tree that has passed static analysis.
+ */
+#ifndef __DCE_H
+#define __DCE_H
+
+#include "symbol.h"
+
+/**
+ * @brief What a dead code elimination pass removed
+ */
+typedef struct DeadCodeStats
+{
+    int nodes_before;               /**< @brief AST nodes before elimination */
+    int nodes_after;                /**< @brief AST nodes after elimination */
+    int statements;                 /**< @brief Unreachable statements removed */
+    int branches;                   /**< @brief Conditionals and loops with literal conditions simplified */
+    int locals;                     /**< @brief Unused local declarations removed */
+    int assignments;                /**< @brief Assignments to unused locals removed or turned into calls */
+    int functions;                  /**< @brief Uncalled functions removed */
+} DeadCodeStats;
+
+/**
+ * @brief Remove dead and unreachable code throughout a program
+ *
+ * @param tree AST of a program that passed static analysis
+ * @returns Statistics about the rewrite
+ */
+DeadCodeStats eliminate_dead_code (ASTNode* tree);
+
+/**
+ * @brief Print dead code elimination statistics
+ *
+ * @param stats Statistics from @ref eliminate_dead_code
+ * @param output File stream to print to
+ */
+void DeadCodeStats_print (const DeadCodeStats* stats, FILE* output);
+
+#endif
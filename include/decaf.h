@@ -0,0 +1,90 @@
+/**
+ * @file decaf.h
+ * @brief Embeddable compiler interface (libdecaf)
+ *
+ * This is the entry point for programs that link against @c libdecaf.a
+ * instead of running the @c decaf executable. @ref decaf_analyze_buffer runs
+ * the whole front and middle end (lexing, parsing, symbol tables, and static
+ * analysis) on source text that is already in memory. It performs no file
+ * I/O, prints nothing, and never exits the process; fatal front end errors
+ * are returned like any other error.
+ *
+ * Each call runs in a caller-provided @ref DecafContext, so a long-running
+ * service can analyze many sources one after another with one context, or
+ * several at once on different threads with one context per thread:
+ *
+ *     DecafContext* context = DecafContext_new();
+ *     DecafResult result;
+ *     if (decaf_analyze_buffer(context, text, length, &result) != DECAF_OK) {
+ *         ErrorList_print(result.errors, stderr);
+ *     }
+ *     decaf_result_free(&result);
+ *     DecafContext_free(context);
+ */
+#ifndef __DECAF_H
+#define __DECAF_H
+
+#include "p3-analysis.h"
+#include "context.h"
+
+/**
+ * @brief Outcome of @ref decaf_analyze_buffer
+ */
+typedef enum DecafStatus {
+    DECAF_OK,               /**< @brief The program passed static analysis */
+    DECAF_ANALYSIS_ERRORS,  /**< @brief The program parsed but has static analysis errors */
+    DECAF_SYNTAX_ERROR,     /**< @brief Lexing or parsing failed (no tree) */
+    DECAF_INVALID_INPUT     /**< @brief A required argument was @c NULL or the text is too long */
+} DecafStatus;
+
+/**
+ * @brief Everything produced by one call to @ref decaf_analyze_buffer
+ *
+ * All of the memory is charged to the context used for the call, and all of
+ * it is released by @ref decaf_result_free (which may be called after the
+ * context itself is freed).
+ */
+typedef struct DecafResult {
+    ASTNode* tree;          /**< @brief AST with all attributes (@c NULL unless it parsed) */
+    SymbolTable* globals;   /**< @brief Global scope (owned by @c tree; @c NULL unless it parsed) */
+    ErrorList* errors;      /**< @brief Errors in report order (never @c NULL) */
+} DecafResult;
+
+/**
+ * @brief Lex, parse, and analyze a program held in memory
+ *
+ * @param context Context to run in (made current for the duration of the call)
+ * @param text Program source; need not be NUL-terminated
+ * @param length Number of characters of @p text to use (at most #MAX_FILE_SIZE)
+ * @param result Filled in on return, even on failure; release it with @ref
+ * decaf_result_free
+ * @returns @ref DECAF_OK if there are no errors, or the kind of failure
+ */
+DecafStatus decaf_analyze_buffer (DecafContext* context, const char* text, size_t length,
+                                  DecafResult* result);
+
+/**
+ * @brief Lex and parse a program held in memory and build its symbol tables
+ *
+ * This is the first half of @ref decaf_analyze_buffer, for callers that run
+ * the static analysis themselves (e.g., incrementally). Names are not yet
+ * resolved.
+ *
+ * @param context Context to run in (made current for the duration of the call)
+ * @param text Program source; need not be NUL-terminated
+ * @param length Number of characters of @p text to use (at most #MAX_FILE_SIZE)
+ * @param result Filled in on return, even on failure (with an empty error list
+ * if the program parsed); release it with @ref decaf_result_free
+ * @returns @ref DECAF_OK if the program parsed, or the kind of failure
+ */
+DecafStatus decaf_parse_buffer (DecafContext* context, const char* text, size_t length,
+                                DecafResult* result);
+
+/**
+ * @brief Release the tree, symbol tables, and errors in a result
+ *
+ * @param result Result to clear (its fields are set to @c NULL)
+ */
+void decaf_result_free (DecafResult* result);
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file fold.h
+ * @brief Constant folding and propagation
+ *
+ * This module provides an AST rewriting pass that replaces constant
+ * expressions by literals, so later passes see (and walk) fewer nodes:
+ *
+ * - Binary and unary operations whose operands are literals are evaluated
+ *   with Decaf's semantics: @c int arithmetic wraps around at 32 bits, and
+ *   division truncates toward zero.
+ * - Short-circuit operators with a deciding literal on the left (@c false
+ *   @c && @c x, @c true @c || @c x) become that literal, and algebraic
+ *   identities with a variable operand (@c x @c * @c 1, @c x @c + @c 0, @c x
+ *   @c && @c true, @c x @c * @c 0, ...) become the variable or the constant.
+ * - Within straight-line code, a scalar variable that was just assigned a
+ *   literal is replaced by that literal wherever it is read, until it is
+ *   reassigned, control flow joins (at an @c if or @c while), or a function
+ *   call may change it (for globals).
+ *
+ * Division or modulo by a constant zero is never folded; it is reported as a
+ * static analysis error instead. Operation nodes are rewritten in place, so
+ * references to them (e.g., from their parents or from the error list) stay
+ * valid.
+ *
+ * The pass assumes a tree that has passed static analysis.
+ */
+#ifndef __FOLD_H
+#define __FOLD_H
+
+#include "symbol.h"
+
+/**
+ * @brief What a folding pass changed
+ */
+typedef struct FoldStats
+{
+    int nodes_before;               /**< @brief AST nodes before folding */
+    int nodes_after;                /**< @brief AST nodes after folding */
+    int folded;                     /**< @brief Operations replaced by literals */
+    int simplified;                 /**< @brief Operations replaced by one of their operands */
+    int propagated;                 /**< @brief Variable reads replaced by known constants */
+} FoldStats;
+
+/**
+ * @brief Fold and propagate constants throughout a program
+ *
+ * @param tree AST of a program that passed static analysis
+ * @param errors List that receives division and modulo by zero errors (up to
+ * the current context's error limit)
+ * @returns Statistics about the rewrite
+ */
+FoldStats fold_constants (ASTNode* tree, ErrorList* errors);
+
+/**
+ * @brief Count the nodes in a tree
+ */
+int fold_count_nodes (ASTNode* tree);
+
+/**
+ * @brief Print folding statistics
+ *
+ * @param stats Statistics from @ref fold_constants
+ * @param output File stream to print to
+ */
+void FoldStats_print (const FoldStats* stats, FILE* output);
+
+#endif
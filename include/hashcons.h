@@ -0,0 +1,85 @@
+/**
+ * @file hashcons.h
+ * @brief Structural hashing and hash-consing of expression subtrees
+ *
+ * This module provides an optional pass that computes a 64-bit structural
+ * hash for every expression subtree and maps structurally identical subtrees
+ * in the same scope to a single shared @ref HashConsEntry. The static analysis
+ * uses these entries to memoize inferred types, so a repeated expression is
+ * only type-checked once per scope.
+ *
+ * Subtrees are shared logically rather than physically: every AST node keeps
+ * its own children (so @ref ASTNode_free and the @c parent links remain
+ * valid), and duplicates point to the entry of their canonical representative
+ * through the @c hashcons attribute.
+ */
+#ifndef __HASHCONS_H
+#define __HASHCONS_H
+
+#include "ast.h"
+#include "visitor.h"
+#include "symbol.h"
+
+/**
+ * @brief Unique expression shape within a single scope
+ */
+typedef struct HashConsEntry
+{
+    uint64_t hash;                  /**< @brief Structural hash of the subtree */
+    struct SymbolTable* scope;      /**< @brief Innermost scope of the subtree */
+    ASTNode* canonical;             /**< @brief First occurrence (in postorder) of this shape */
+    int occurrences;                /**< @brief Number of subtrees with this shape */
+    int size;                       /**< @brief Number of nodes in the subtree */
+    bool checked;                   /**< @brief True once the canonical subtree has been analyzed */
+    bool clean;                     /**< @brief True if the canonical subtree analyzed without errors */
+    DecafType type;                 /**< @brief Memoized inferred type (valid if @c checked) */
+    int errors_before;              /**< @brief Error count when analysis of the canonical subtree began */
+    int reuses;                     /**< @brief Number of duplicates that reused the memoized type */
+    struct HashConsEntry* next;     /**< @brief Next entry in the same hash bucket */
+} HashConsEntry;
+
+/**
+ * @brief Hash table of unique expression shapes, plus statistics
+ */
+typedef struct HashConsTable
+{
+    HashConsEntry** buckets;        /**< @brief Bucket array (separate chaining) */
+    int capacity;                   /**< @brief Number of buckets */
+    int size;                       /**< @brief Number of unique shapes (i.e., shared DAG nodes) */
+    int expression_nodes;           /**< @brief Total expression nodes hashed */
+} HashConsTable;
+
+/**
+ * @brief Allocate a new, empty hash-consing table
+ */
+HashConsTable* HashConsTable_new ();
+
+/**
+ * @brief Print node-count and memoization statistics
+ *
+ * @param table Table to report on
+ * @param output File stream for the report
+ */
+void HashConsTable_print_stats (HashConsTable* table, FILE* output);
+
+/**
+ * @brief Deallocate a hash-consing table and all of its entries
+ *
+ * The @c hashcons attributes set by @ref HashConsVisitor_new point into the
+ * table, so this should only be called once the analysis is done with them.
+ */
+void HashConsTable_free (HashConsTable* table);
+
+/**
+ * @brief Create a new visitor that hash-conses expression subtrees
+ *
+ * Sets a @c hashcons attribute (a @ref HashConsEntry reference) on every
+ * expression node. Requires the node scopes recorded by @ref
+ * BuildSymbolTablesVisitor_new.
+ *
+ * @param table Table to record unique shapes in
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* HashConsVisitor_new (HashConsTable* table);
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file incremental.h
+ * @brief Incremental re-analysis of a program that is being edited
+ *
+ * A @ref DecafSession keeps the tree, symbol tables, and per-function errors
+ * of the last version of a program it was given. When a new version arrives,
+ * lexing, parsing, symbol tables, name resolution, and the program-level
+ * checks still run on the whole program (they are single linear passes), but
+ * only the "dirty" functions are type-checked:
+ *
+ * - functions that are new, or whose declaration or body changed, and
+ * - functions that use a global name (variable or function) whose declaration
+ *   changed, appeared, or disappeared (e.g., the callers of a function whose
+ *   signature changed).
+ *
+ * Every other function reports its errors from the previous version. Functions
+ * are compared by a structural fingerprint in which source lines are relative
+ * to the function's first line, so a function that merely moved (because
+ * lines were inserted or removed above it) is still reused, and its errors
+ * report its new line numbers.
+ *
+ * Functions that were reused have no inferred @c type attributes in the new
+ * tree; everything else (symbol tables and name bindings) is complete.
+ */
+#ifndef __INCREMENTAL_H
+#define __INCREMENTAL_H
+
+#include "decaf.h"
+
+/**
+ * @brief What a session remembers about one function between versions
+ */
+typedef struct FunctionSummary
+{
+    ASTNode* declaration;           /**< @brief Function declaration node (owned by the session's tree) */
+    uint64_t fingerprint;           /**< @brief Structural hash of the declaration */
+    uint64_t* references;           /**< @brief Hashes of the names used in the body */
+    int num_references;             /**< @brief Number of entries in @c references */
+    ErrorList* errors;              /**< @brief Errors found in the function (@c NULL if unknown) */
+} FunctionSummary;
+
+/**
+ * @brief Analysis state for successive versions of one program
+ */
+typedef struct DecafSession
+{
+    DecafContext* context;          /**< @brief Context that every update runs in */
+    int num_threads;                /**< @brief Worker threads for checking dirty functions */
+    ASTNode* tree;                  /**< @brief Last version that parsed (@c NULL before the first) */
+    FunctionSummary* functions;     /**< @brief One summary per function of @c tree, in source order */
+    int num_functions;              /**< @brief Number of entries in @c functions */
+    DecafResult result;             /**< @brief Outcome of the last update (its tree is owned by the session) */
+    int checked_functions;          /**< @brief Functions type-checked by the last update */
+    int reused_functions;           /**< @brief Functions whose errors were reused by the last update */
+} DecafSession;
+
+/**
+ * @brief Start a session with no previous version
+ *
+ * @param context Context for every update (must outlive the session)
+ * @param num_threads Maximum number of threads for checking functions
+ * @returns Newly allocated session
+ */
+DecafSession* DecafSession_new (DecafContext* context, int num_threads);
+
+/**
+ * @brief Analyze a new version of the program
+ *
+ * On success, @c session->result holds the new tree and all of its errors, in
+ * the same order as @ref decaf_analyze_buffer would report them. If the new
+ * version does not parse, the result holds only the syntax error, and the
+ * last version that parsed is kept as the base for the next update.
+ *
+ * @param session Session to update
+ * @param text Program source; need not be NUL-terminated
+ * @param length Number of characters of @p text to use
+ * @returns Same as @ref decaf_analyze_buffer
+ */
+DecafStatus DecafSession_update (DecafSession* session, const char* text, size_t length);
+
+/**
+ * @brief Deallocate a session, including its tree and results
+ */
+void DecafSession_free (DecafSession* session);
+
+#endif
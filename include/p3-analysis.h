@@ -11,6 +11,9 @@
 #include "ast.h"
 #include "visitor.h"
 #include "symbol.h"
+#include "hashcons.h"
+#include "resolver.h"
+#include "threadpool.h"
 
 /**
  * @brief Perform static analysis on an AST and return a list of errors
@@ -21,4 +24,36 @@
  */
 ErrorList* analyze (ASTNode* tree);
 
+/**
+ * @brief Perform static analysis, checking function bodies in parallel
+ *
+ * Name resolution and the program-level checks run on the calling thread;
+ * each function declaration is then checked as a separate job on a @ref
+ * ThreadPool. Errors are merged in source order, so the result is identical
+ * to @ref analyze for any number of threads.
+ *
+ * @param tree Root of AST
+ * @param num_threads Maximum number of worker threads (1 runs everything on
+ * the calling thread)
+ * @returns List of static analysis errors found
+ */
+ErrorList* analyze_parallel (ASTNode* tree, int num_threads);
+
+/**
+ * @brief Perform static analysis, reusing the errors of unchanged functions
+ *
+ * Like @ref analyze_parallel, except that functions with an entry in @p cache
+ * are not checked; their cached errors (which must refer to this tree) are
+ * reported in their place. Every function that is checked to completion gets
+ * a new cache entry with its errors. Name resolution and the program-level
+ * checks always run.
+ *
+ * @param tree Root of AST
+ * @param num_threads Maximum number of worker threads
+ * @param cache One entry per function declaration, in source order (@c NULL
+ * entries are checked); the caller owns the entries, including new ones
+ * @returns List of static analysis errors found
+ */
+ErrorList* analyze_incremental (ASTNode* tree, int num_threads, ErrorList** cache);
+
 #endif
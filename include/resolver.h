@@ -0,0 +1,117 @@
+/**
+ * @file resolver.h
+ * @brief Single-map scoped name resolver
+ *
+ * A @ref Resolver is an alternative to walking a chain of @ref SymbolTable
+ * structures: it keeps one hash map from interned names to a stack of
+ * shadowing bindings, plus an undo log of the bindings made in each open
+ * scope. Entering a scope is O(1), leaving it is O(declarations in that
+ * scope), and every lookup is a single probe regardless of nesting depth.
+ *
+ * The resolver does not own any symbols; they still live in the per-scope
+ * symbol tables (which are kept for printing and later phases).
+ */
+#ifndef __RESOLVER_H
+#define __RESOLVER_H
+
+#include "symbol.h"
+#include "context.h"
+
+/**
+ * @brief Interned name and the index of its innermost visible binding
+ */
+typedef struct ResolverName
+{
+    const char* name;               /**< @brief Interned name of the first symbol bound to it */
+    uint64_t hash;                  /**< @brief Cached hash of @c name */
+    int binding;                    /**< @brief Index of innermost binding in the undo log (-1 if none) */
+} ResolverName;
+
+/**
+ * @brief Single entry in the undo log
+ */
+typedef struct ResolverBinding
+{
+    ResolverName* name;             /**< @brief Name being bound */
+    Symbol* symbol;                 /**< @brief Symbol the name is bound to */
+    int shadowed;                   /**< @brief Index of the binding this one shadows (-1 if none) */
+} ResolverBinding;
+
+/**
+ * @brief Name map, undo log, and scope marks
+ */
+typedef struct Resolver
+{
+    ResolverName** names;           /**< @brief Open-addressing name map (linear probing) */
+    int names_capacity;             /**< @brief Number of slots in @c names (a power of two) */
+    int names_size;                 /**< @brief Number of interned names */
+
+    ResolverBinding* bindings;      /**< @brief Undo log (bindings in declaration order) */
+    int bindings_size;              /**< @brief Number of live bindings */
+    int bindings_capacity;          /**< @brief Allocated length of @c bindings */
+
+    int* scopes;                    /**< @brief Undo log length when each open scope was entered */
+    int scopes_size;                /**< @brief Number of open scopes */
+    int scopes_capacity;            /**< @brief Allocated length of @c scopes */
+} Resolver;
+
+/**
+ * @brief Allocate a new resolver with no open scopes
+ */
+Resolver* Resolver_new ();
+
+/**
+ * @brief Open a new (innermost) scope
+ */
+void Resolver_enter_scope (Resolver* resolver);
+
+/**
+ * @brief Close the innermost scope and unbind everything declared in it
+ */
+void Resolver_exit_scope (Resolver* resolver);
+
+/**
+ * @brief Bind a symbol's name in the innermost scope
+ *
+ * If the innermost scope already binds the name, the earlier binding is kept
+ * (matching @ref SymbolTable_insert) and the new symbol is not bound.
+ *
+ * @param resolver Resolver with at least one open scope
+ * @param symbol Symbol to bind (not owned by the resolver)
+ * @returns The earlier symbol with the same name in the innermost scope, or
+ * @c NULL if there was none
+ */
+Symbol* Resolver_declare (Resolver* resolver, Symbol* symbol);
+
+/**
+ * @brief Look up the innermost visible binding of a name
+ *
+ * @param resolver Resolver to search
+ * @param name Name to look up
+ * @returns The bound symbol, or @c NULL if the name is not visible
+ */
+Symbol* Resolver_lookup (Resolver* resolver, const char* name);
+
+/**
+ * @brief Deallocate a resolver (but not the symbols it binds)
+ */
+void Resolver_free (Resolver* resolver);
+
+/**
+ * @brief Create a new visitor that binds every name use to its symbol
+ *
+ * Resolves each @ref LocationNode and @ref FuncCallNode exactly once and
+ * stores the result in the node's @c symbol field, so later passes can
+ * dereference the binding instead of repeating the lookup. Undefined names
+ * are reported once each.
+ *
+ * Scopes are tracked with a @ref Resolver: entering a program, function, or
+ * block node binds the symbols of its (frozen) table, as built by @ref
+ * BuildSymbolTablesVisitor_new, and leaving it unbinds them.
+ *
+ * @param errors List to add "undefined symbol" errors to
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* ResolveSymbolsVisitor_new (ErrorList* errors);
+
+#endif
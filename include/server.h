@@ -0,0 +1,43 @@
+/**
+ * @file server.h
+ * @brief Persistent compile server (@c decaf @c --server)
+ *
+ * The server analyzes one program per request, keeping its warm state (the
+ * compilation context and the lexer's compiled regexes) from one request to
+ * the next, so a build system can check thousands of small files without
+ * paying process startup for each of them.
+ *
+ * Requests are read from the input one per line:
+ *
+ *     file [--symbols] <path>       analyze a file
+ *     source [--symbols] <text>     analyze inline source (with \n, \t, and \\ escapes)
+ *     quit                          stop serving (as does the end of the input)
+ *
+ * Blank lines are ignored. Every request gets one response on the output,
+ * which is flushed immediately:
+ *
+ *     result <status> <count>
+ *     <one line per diagnostic>
+ *     <symbol tables, if requested and there were no diagnostics>
+ *     end
+ *
+ * where @c status is @c ok, @c errors, @c syntax-error, or @c invalid (for
+ * unreadable files and malformed requests), and @c count is the number of
+ * diagnostic lines that follow.
+ */
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include "decaf.h"
+
+/**
+ * @brief Serve requests until @c quit or the end of the input
+ *
+ * @param context Context for every request (its error limit applies)
+ * @param input Stream to read requests from
+ * @param output Stream to write responses to
+ * @returns Number of requests served
+ */
+int decaf_serve (DecafContext* context, FILE* input, FILE* output);
+
+#endif
@@ -22,6 +22,86 @@ void type_attr_print(void* value, FILE* output);
  */
 void symtable_attr_print(void* value, FILE* output);
 
+/**
+ * @brief Chunk of arena memory
+ */
+typedef struct SymbolArenaChunk
+{
+    struct SymbolArenaChunk* next;  /**< @brief Previously filled chunk */
+    size_t used;                    /**< @brief Bytes handed out from @c data */
+    size_t capacity;                /**< @brief Bytes available in @c data */
+    max_align_t data[];             /**< @brief Storage (aligned for any type) */
+} SymbolArenaChunk;
+
+/**
+ * @brief Per-compilation storage for symbols, interned names, and signatures
+ *
+ * Symbols are bump-allocated and never freed individually; the whole arena is
+ * released when the last symbol table sharing it is freed. Names and function
+ * signatures are interned, so equal ones are stored (and can be compared by
+ * pointer) only once per arena.
+ */
+typedef struct SymbolArena
+{
+    SymbolArenaChunk* chunks;       /**< @brief Current chunk (older chunks follow @c next) */
+    const void** interned;          /**< @brief Open-addressing set of interned blocks */
+    size_t* interned_sizes;         /**< @brief Size (in bytes) of each interned block */
+    int interned_capacity;          /**< @brief Number of slots in @c interned (a power of two) */
+    int interned_size;              /**< @brief Number of interned blocks */
+    int references;                 /**< @brief Number of symbol tables sharing this arena */
+} SymbolArena;
+
+/**
+ * @brief Allocate a new, empty arena with one reference
+ */
+SymbolArena* SymbolArena_new ();
+
+/**
+ * @brief Allocate zero-initialized, suitably aligned memory from an arena
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes
+ * @returns Pointer to memory owned by the arena
+ */
+void* SymbolArena_alloc (SymbolArena* arena, size_t size);
+
+/**
+ * @brief Return the canonical arena copy of a block of bytes
+ *
+ * @param arena Arena to intern into
+ * @param data Bytes to intern
+ * @param size Number of bytes
+ * @returns Pointer to an immutable copy that is shared by all equal blocks
+ */
+const void* SymbolArena_intern (SymbolArena* arena, const void* data, size_t size);
+
+/**
+ * @brief Return the canonical arena copy of a name
+ */
+const char* SymbolArena_intern_name (SymbolArena* arena, const char* name);
+
+/**
+ * @brief Add a reference to an arena
+ */
+void SymbolArena_retain (SymbolArena* arena);
+
+/**
+ * @brief Drop a reference to an arena, deallocating it with the last one
+ */
+void SymbolArena_release (SymbolArena* arena);
+
+/**
+ * @brief Immutable function signature (formal parameter types)
+ *
+ * Signatures are interned in a @ref SymbolArena, so functions with the same
+ * parameter types share a single array.
+ */
+typedef struct ParameterArray
+{
+    int size;                       /**< @brief Number of parameters */
+    DecafType types[];              /**< @brief Parameter types in declaration order */
+} ParameterArray;
+
 /**
  * @brief Single Decaf symbol.
  * 
@@ -39,9 +119,9 @@ typedef struct Symbol
     } symbol_type;
 
     /**
-     * @brief Name of symbol in code
+     * @brief Name of symbol in code (interned in the symbol's arena)
      */
-    char name[MAX_ID_LEN];
+    const char* name;
     
     /**
      * @brief Variable or function return type
@@ -54,9 +134,10 @@ typedef struct Symbol
     int length;
 
     /**
-     * @brief List of parameters (for function symbols only)
+     * @brief Shared parameter types (for function symbols only; @c NULL
+     * otherwise)
      */
-    ParameterList* parameters;
+    const ParameterArray* parameters;
 
     /**
      * @brief Memory access location (initialized during code generation)
@@ -73,6 +154,17 @@ typedef struct Symbol
      */
     int offset;
 
+    /**
+     * @brief Source code line of the declaration (zero for built-in functions)
+     */
+    int source_line;
+
+    /**
+     * @brief Earlier symbol with the same name in the same scope (set by
+     * @ref SymbolTable_insert if this symbol is a duplicate declaration)
+     */
+    struct Symbol* duplicate_of;
+
     /**
      * @brief Next symbol (if stored in a list)
      */
@@ -83,39 +175,39 @@ typedef struct Symbol
 /**
  * @brief Create a new scalar symbol
  * 
+ * @param arena Arena that will own the symbol
  * @param name Name in source code
  * @param type Data type
  */
-Symbol* Symbol_new (const char* name, DecafType type);
+Symbol* Symbol_new (SymbolArena* arena, const char* name, DecafType type);
 
 /**
  * @brief Create a new array symbol
  * 
+ * @param arena Arena that will own the symbol
  * @param name Name in source code
  * @param type Data type
  * @param length Array length
  */
-Symbol* Symbol_new_array (const char* name, DecafType type, int length);
+Symbol* Symbol_new_array (SymbolArena* arena, const char* name, DecafType type, int length);
 
 /**
  * @brief Create a new function symbol
  * 
+ * @param arena Arena that will own the symbol
  * @param name Name in source code
  * @param return_type Function return type
- * @param parameters List of formal parameter names and data types
+ * @param parameters List of formal parameter names and data types (only the
+ * types are kept, in a shared @ref ParameterArray)
  */
-Symbol* Symbol_new_function (const char* name, DecafType return_type, ParameterList* parameters);
+Symbol* Symbol_new_function (SymbolArena* arena, const char* name, DecafType return_type,
+                             ParameterList* parameters);
 
 /**
  * @brief Print simplified string representation
  */
 void Symbol_print (Symbol* symbol, FILE* output);
 
-/**
- * @brief Deallocate a symbol
- */
-void Symbol_free (Symbol* symbol);
-
 DECL_LIST_TYPE(Symbol, struct Symbol*)
 
 /**
@@ -124,6 +216,17 @@ DECL_LIST_TYPE(Symbol, struct Symbol*)
  * Symbol tables are generated using a simple AST traversal algorithm, and are
  * used during code generation to look up type and location information for
  * individual symbols.
+ *
+ * Symbols are kept in declaration order in @c local_symbols (for printing)
+ * and also in an open-addressing hash index (for constant-time lookup). The
+ * index is allocated lazily, so empty scopes do not pay for it.
+ *
+ * The symbols themselves are owned by an arena that is shared by a root table
+ * and all of its descendants.
+ *
+ * Once a table is complete it can be frozen (see @ref SymbolTable_freeze),
+ * after which its structure never changes, so any number of threads may read
+ * it concurrently without locking.
  */
 typedef struct SymbolTable
 {
@@ -132,6 +235,38 @@ typedef struct SymbolTable
      */
     SymbolList* local_symbols;
 
+    /**
+     * @brief Hash index over @c local_symbols (linear probing; @c NULL marks
+     * an empty slot, and the whole array is @c NULL until the first insert)
+     */
+    struct Symbol** index;
+
+    /**
+     * @brief Number of slots in @c index (zero or a power of two)
+     */
+    int index_capacity;
+
+    /**
+     * @brief Contiguous copy of @c local_symbols in declaration order (@c NULL
+     * until the table is frozen)
+     */
+    struct Symbol* const* symbols;
+
+    /**
+     * @brief Number of symbols in the table
+     */
+    int size;
+
+    /**
+     * @brief True once @ref SymbolTable_freeze has been called
+     */
+    bool frozen;
+
+    /**
+     * @brief Arena for this table's symbols (shared with the parent table)
+     */
+    SymbolArena* arena;
+
     /**
      * @brief Link to parent table
      */
@@ -140,12 +275,14 @@ typedef struct SymbolTable
 } SymbolTable;
 
 /**
- * @brief Create a new symbol table with no parent link
+ * @brief Create a new symbol table with no parent link (and a new arena)
  */
 SymbolTable* SymbolTable_new ();
 
 /**
  * @brief Create a new symbol table with a parent link
+ *
+ * The new table shares (and holds a reference to) its parent's arena.
  * 
  * @param parent Pointer to parent table
  */
@@ -153,36 +290,83 @@ SymbolTable* SymbolTable_new_child (SymbolTable* parent);
 
 /**
  * @brief Add a symbol to a table
+ *
+ * If the table already contains a symbol with the same name, the new symbol
+ * is still added (so it is printed with the table), but it is
+ * marked as a duplicate through its @c duplicate_of field and lookups keep
+ * returning the earlier one. This check uses the table's hash index, so it
+ * takes constant expected time.
  * 
  * @param table Symbol table to insert the symbol into
  * @param symbol Symbol to insert
+ * @returns The earlier symbol with the same name, or @c NULL if there was none
+ */
+Symbol* SymbolTable_insert (SymbolTable* table, Symbol* symbol);
+
+/**
+ * @brief Make a complete table read-only
+ *
+ * Copies the symbols into the contiguous @c symbols array; afterwards, @ref
+ * SymbolTable_insert must not be called on the table. Reading a frozen table
+ * (including @ref SymbolTable_lookup and iteration over @c symbols or @c
+ * local_symbols) never writes to it, so frozen tables can be shared between
+ * threads. Symbols' storage fields may still be filled in later by a
+ * single-threaded pass such as allocation.
+ *
+ * @param table Symbol table to freeze
+ */
+void SymbolTable_freeze (SymbolTable* table);
+
+/**
+ * @brief Remove a set of symbols from a table in one step
+ *
+ * For passes that delete declarations from an analyzed program; collect
+ * every symbol to remove from a table first and then call this once. The
+ * symbols themselves stay valid (they are owned by the arena), but they are
+ * no longer listed, printed, allocated, or found by lookups in this table.
+ *
+ * A frozen table is thawed, compacted, re-indexed once, and frozen again
+ * with a new @c symbols array (the old one is not modified). This breaks the
+ * read-only guarantee of @ref SymbolTable_freeze, so it may only run after
+ * analysis has finished, on a tree that no other thread is reading.
+ *
+ * @param table Symbol table that holds the symbols
+ * @param removed Symbols to remove (symbols not in @p table are ignored)
+ * @param count Number of symbols in @p removed
  */
-void SymbolTable_insert (SymbolTable* table, Symbol* symbol);
+void SymbolTable_remove_all (SymbolTable* table, Symbol** removed, int count);
 
 /**
  * @brief Retrieve a symbol from a table
  * 
  * Looks through parent tables if the symbol is not found in the local table.
+ * Each table is searched in expected constant time, and the search does not
+ * modify any table.
  * 
  * @param table Symbol table to search
  * @param name Name of symbol to find
  * @returns The @ref Symbol if found, otherwise @c NULL
  */
-Symbol* SymbolTable_lookup (SymbolTable* table, const char* name);
+Symbol* SymbolTable_lookup (const SymbolTable* table, const char* name);
 
 /**
- * @brief Deallocate a symbol table
+ * @brief Deallocate a symbol table and drop its reference to the arena
+ *
+ * The table's symbols remain valid until every table sharing the arena has
+ * been freed.
  */
 void SymbolTable_free (SymbolTable* table);
 
 /**
  * @brief Look up a symbol in an AST
  *
- * The search has two phases: 1) searching AST nodes for a symbol table as a
- * "symbolTable" attribute and following "parent" attributes as necessary
- * (requires the links as set up by a SetParentVisitor), and 2) searching
- * symbol tables for the given symbol name and following parent pointers as
- * necessary.
+ * The search has two phases: 1) finding the innermost enclosing symbol table,
+ * which is a single load of the node's @c scope pointer (as set up by a
+ * BuildSymbolTablesVisitor); for nodes without one, this falls back to
+ * searching AST nodes for a "symbolTable" attribute and following "parent"
+ * attributes as necessary (requires the links as set up by a
+ * SetParentVisitor), and 2) searching symbol tables for the given symbol name
+ * and following parent pointers as necessary.
  *
  * @param node AST node to begin the search at
  * @param name Name of symbol to find
@@ -192,6 +376,10 @@ Symbol* lookup_symbol(ASTNode* node, const char* name);
 
 /**
  * @brief Create a new visitor that builds symbol tables
+ *
+ * Also records the innermost enclosing table in the @c scope field of every
+ * node it visits. Each table is frozen as soon as its scope has been
+ * traversed, so all tables are read-only once the traversal is done.
  * 
  * @returns Pointer to visitor structure
  */
@@ -205,20 +393,125 @@ NodeVisitor* BuildSymbolTablesVisitor_new ();
  */
 NodeVisitor* PrintSymbolsVisitor_new (FILE* output);
 
+/**
+ * @brief Kinds of static analysis errors
+ *
+ * Each code documents which fields of @ref AnalysisError it uses; the message
+ * text is only produced by @ref AnalysisError_format.
+ */
+typedef enum ErrorCode {
+    ERR_MESSAGE,                /**< @brief Preformatted message (@c text) */
+    ERR_NULL_TREE,              /**< @brief No tree to analyze */
+    ERR_NO_MAIN,                /**< @brief No 'main' function (@c node is the program) */
+    ERR_MAIN_PARAMETERS,        /**< @brief 'main' has parameters (@c node is the program) */
+    ERR_MAIN_RETURN_TYPE,       /**< @brief 'main' does not return int (@c node is the program) */
+    ERR_DUPLICATE,              /**< @brief Redeclaration (@c symbol is the later declaration) */
+    ERR_DUPLICATE_BUILTIN,      /**< @brief Redeclaration of a built-in (@c symbol as above) */
+    ERR_UNDEFINED,              /**< @brief Undefined name (@c node is a location or call) */
+    ERR_VOID_VARIABLE,          /**< @brief Void variable (@c node is the declaration) */
+    ERR_LOCAL_ARRAY,            /**< @brief Local array (@c node is the declaration) */
+    ERR_ARRAY_LENGTH,           /**< @brief Non-positive array length (@c node is the declaration) */
+    ERR_ASSIGNMENT_TYPE,        /**< @brief Assignment mismatch (@c types: location, value) */
+    ERR_CONDITION_TYPE,         /**< @brief Non-bool condition (@c types[0]: condition) */
+    ERR_RETURN_TYPE,            /**< @brief Return mismatch (@c types: declared, returned) */
+    ERR_BREAK_OUTSIDE_LOOP,     /**< @brief Break outside of a loop */
+    ERR_CONTINUE_OUTSIDE_LOOP,  /**< @brief Continue outside of a loop */
+    ERR_BINARY_OPERANDS,        /**< @brief Bad operand types (@c types: left, right) */
+    ERR_UNARY_OPERAND,          /**< @brief Bad operand type (@c types: expected, actual) */
+    ERR_MISSING_INDEX,          /**< @brief Array used without an index (@c node is the location) */
+    ERR_INDEX_TYPE,             /**< @brief Non-int array index (@c node is the location) */
+    ERR_ARGUMENT_COUNT,         /**< @brief Wrong number of arguments (@c node is the call, @c symbol the callee) */
+    ERR_ARGUMENT_TYPE,          /**< @brief Argument mismatch (@c types: parameter, argument) */
+    ERR_DIVISION_BY_ZERO,       /**< @brief Constant zero divisor (@c node is the division or modulo) */
+    ERR_UNINITIALIZED,          /**< @brief Read of a possibly unassigned local (@c node is the location) */
+} ErrorCode;
+
 /**
  * @brief Static analysis error structure
+ *
+ * Errors are compact records rather than strings, so reporting one is cheap
+ * even when only the number of errors matters. The records refer to nodes and
+ * symbols in the analyzed tree, so they can only be formatted while the tree
+ * is alive.
  */
 typedef struct AnalysisError
 {
-    char message[MAX_ERROR_LEN];    /**< @brief Error message */
-    struct AnalysisError* next;     /**< @brief Next message (if stored in a list) */
+    ErrorCode code;                 /**< @brief Kind of error */
+    DecafType types[2];             /**< @brief Types involved (meaning depends on @c code) */
+    struct ASTNode* node;           /**< @brief Offending node (if any) */
+    const struct Symbol* symbol;    /**< @brief Symbol involved (if any) */
+    char* text;                     /**< @brief Message (only for @c ERR_MESSAGE) */
+    struct AnalysisError* next;     /**< @brief Next error (if stored in a list) */
 } AnalysisError;
 
+/**
+ * @brief Format an error message
+ *
+ * @param error Error to format
+ * @param buffer Destination for the message
+ * @param size Size of @p buffer (messages are truncated to fit)
+ * @returns @p buffer
+ */
+char* AnalysisError_format (const AnalysisError* error, char* buffer, size_t size);
+
+/**
+ * @brief Deallocate an error record
+ */
+void AnalysisError_free (AnalysisError* error);
+
 DECL_LIST_TYPE(Error, AnalysisError*)
 
 /**
  * @brief Add an error message to a list of errors using @c printf syntax
+ *
+ * The message is formatted immediately (as an @c ERR_MESSAGE record); the
+ * analysis itself uses @ref ErrorList_report instead.
  */
 void ErrorList_printf (ErrorList* list, const char* format, ...);
 
+/**
+ * @brief Add a structured error to a list
+ *
+ * @param list List to add to
+ * @param code Kind of error
+ * @param node Offending node (or @c NULL)
+ * @param symbol Symbol involved (or @c NULL)
+ * @param type0 First type involved (or @c UNKNOWN)
+ * @param type1 Second type involved (or @c UNKNOWN)
+ */
+void ErrorList_report (ErrorList* list, ErrorCode code, struct ASTNode* node, const struct Symbol* symbol,
+                       DecafType type0, DecafType type1);
+
+/**
+ * @brief Print every error in a list, one per line
+ *
+ * @param list Errors to print
+ * @param output File stream to print to
+ */
+void ErrorList_print (ErrorList* list, FILE* output);
+
+/**
+ * @brief Drop (and deallocate) all but the first errors in a list
+ *
+ * @param list List to shorten
+ * @param size Number of errors to keep
+ */
+void ErrorList_truncate (ErrorList* list, int size);
+
+/**
+ * @brief Move all errors from one list to the end of another
+ *
+ * @param list Destination list
+ * @param other Source list (deallocated; its errors now belong to @p list)
+ */
+void ErrorList_append_all (ErrorList* list, ErrorList* other);
+
+/**
+ * @brief Copy all errors from one list to the end of another
+ *
+ * @param list Destination list
+ * @param other Source list (unchanged)
+ */
+void ErrorList_append_copies (ErrorList* list, ErrorList* other);
+
 #endif
@@ -0,0 +1,78 @@
+/**
+ * @file threadpool.h
+ * @brief Fixed-size pool of worker threads for fork-join batches of jobs
+ *
+ * A @ref ThreadPool runs batches of independent jobs. Each job is identified
+ * by its index in the batch; workers claim the next unclaimed index until the
+ * batch is exhausted, so uneven jobs balance themselves. @ref ThreadPool_run
+ * returns once every job in the batch has finished, and the same workers are
+ * reused for the next batch.
+ *
+ * Jobs also receive the index of the worker running them, so callers can keep
+ * per-worker state (e.g., one visitor per worker) in a plain array without
+ * any locking. While a job runs, the @ref DecafContext that was current on
+ * the thread calling @ref ThreadPool_run is current on the worker as well. A
+ * pool with a single worker runs every job on the calling thread and never
+ * starts a thread at all.
+ */
+#ifndef __THREADPOOL_H
+#define __THREADPOOL_H
+
+#include "context.h"
+
+#include <threads.h>
+
+/**
+ * @brief A single job in a batch
+ *
+ * @param context Caller state shared by all jobs in the batch
+ * @param job Index of the job in the batch (0 to num_jobs - 1)
+ * @param worker Index of the worker running the job (0 to num_workers - 1)
+ */
+typedef void (*ThreadPoolJob)(void* context, int job, int worker);
+
+/**
+ * @brief Worker threads and the batch they are currently running
+ */
+typedef struct ThreadPool
+{
+    int num_workers;                /**< @brief Number of workers (including the calling thread if only one) */
+    thrd_t* threads;                /**< @brief Worker threads (@c NULL if @c num_workers is 1) */
+    mtx_t lock;                     /**< @brief Protects all of the fields below */
+    cnd_t work_ready;               /**< @brief Signaled when a batch starts or the pool shuts down */
+    cnd_t work_done;                /**< @brief Signaled when the last job of a batch finishes */
+    ThreadPoolJob job;              /**< @brief Job function for the current batch */
+    void* context;                  /**< @brief Job context for the current batch */
+    DecafContext* caller;           /**< @brief Compilation context of the thread running the batch */
+    int num_jobs;                   /**< @brief Number of jobs in the current batch */
+    int next_job;                   /**< @brief Index of the next unclaimed job */
+    int finished_jobs;              /**< @brief Number of jobs that have finished */
+    bool shutdown;                  /**< @brief True once the workers should exit */
+} ThreadPool;
+
+/**
+ * @brief Start a pool of worker threads
+ *
+ * @param num_workers Number of workers (values below 1 are treated as 1)
+ * @returns Newly allocated pool
+ */
+ThreadPool* ThreadPool_new (int num_workers);
+
+/**
+ * @brief Run a batch of jobs and wait for all of them to finish
+ *
+ * Jobs are started in index order but may finish in any order.
+ *
+ * @param pool Pool to run the batch on
+ * @param num_jobs Number of jobs in the batch
+ * @param job Function to call once per job index
+ * @param context Passed to every call of @p job
+ */
+void ThreadPool_run (ThreadPool* pool, int num_jobs, ThreadPoolJob job, void* context);
+
+/**
+ * @brief Stop the workers and deallocate a pool
+ */
+void ThreadPool_free (ThreadPool* pool);
+
+#endif
@@ -52,6 +52,27 @@ bool Regex_match (Regex *regex, const char *text, char *match);
  */
 void Regex_free (Regex* regex);
 
+/**
+ * @brief Turn the compiled-regex cache on or off for the whole process
+ *
+ * The lexer compiles all of its patterns on every call. With the cache on,
+ * @ref Regex_new compiles each distinct pattern once per thread and returns
+ * the cached copy afterwards, and @ref Regex_free leaves cached copies alone.
+ * This pays off in long-running processes that lex many programs (e.g., the
+ * compile server). Set it before starting any threads that lex; caches of
+ * threads started with @c thrd_create are freed when those threads exit.
+ *
+ * @param enable True to use the cache
+ */
+void Regex_enable_cache (bool enable);
+
+/**
+ * @brief Deallocate the calling thread's cached regexes
+ *
+ * None of them may still be in use.
+ */
+void Regex_clear_cache ();
+
 /**
  * @brief Valid token types
  *
@@ -36,6 +36,18 @@ typedef struct NodeVisitor
      */
     Destructor dtor;
 
+    /**
+     * @brief Set by a previsit routine to skip the children and postvisit of
+     * the current node (reset automatically by the traversal)
+     */
+    bool skip_subtree;
+
+    /**
+     * @brief Set by any routine to abandon the rest of the traversal (no
+     * further visits of any kind happen until it is cleared)
+     */
+    bool stop_traversal;
+
     /*
      * Traversal routines; each of these is called at the appropriate time as
      * the visitor traverses the AST.
@@ -0,0 +1,81 @@
+/**
+ * @file xref.h
+ * @brief Def-use cross-reference index
+ *
+ * An @ref XrefIndex maps every declared @ref Symbol to a contiguous array of
+ * the AST nodes that use it (locations for variables, function calls for
+ * functions). Together with the bindings stored on each use by name
+ * resolution (see @ref Xref_definition), this answers "where is this
+ * variable used" and "who calls this function" with array reads instead of
+ * tree walks.
+ */
+#ifndef __XREF_H
+#define __XREF_H
+
+#include "symbol.h"
+
+/**
+ * @brief Declared symbol and the range of its uses in @ref XrefIndex.uses
+ */
+typedef struct XrefEntry
+{
+    Symbol* symbol;                 /**< @brief Declared symbol */
+    int first;                      /**< @brief Index of the first use in @c uses */
+    int count;                      /**< @brief Number of uses */
+} XrefEntry;
+
+/**
+ * @brief Cross-reference index for a whole program
+ */
+typedef struct XrefIndex
+{
+    XrefEntry* entries;             /**< @brief One entry per symbol, in declaration order */
+    int size;                       /**< @brief Number of entries */
+    ASTNode** uses;                 /**< @brief All uses, grouped by symbol and in source order within a group */
+    int use_count;                  /**< @brief Number of uses */
+    PointerMap entry_map;           /**< @brief Map from symbol to entry index */
+} XrefIndex;
+
+/**
+ * @brief Build the cross-reference index for a program in one traversal
+ *
+ * Requires symbol tables and resolved names (i.e., run after @ref analyze).
+ * Uses of undefined names are not indexed.
+ *
+ * @param tree Root of AST
+ * @returns Newly allocated index
+ */
+XrefIndex* XrefIndex_build (ASTNode* tree);
+
+/**
+ * @brief Find the uses of a symbol
+ *
+ * @param index Index to query
+ * @param symbol Declared symbol
+ * @param count Set to the number of uses (zero for unknown symbols)
+ * @returns Pointer to the first of @p count uses (owned by the index)
+ */
+ASTNode* const* XrefIndex_uses (XrefIndex* index, const Symbol* symbol, int* count);
+
+/**
+ * @brief Find the declaration that a use refers to
+ *
+ * @param use Location or function call node
+ * @returns The bound symbol, or @c NULL for undefined names and other nodes
+ */
+Symbol* Xref_definition (ASTNode* use);
+
+/**
+ * @brief Print every symbol with the source lines of its uses
+ *
+ * @param index Index to print
+ * @param output File stream to print to
+ */
+void XrefIndex_print (XrefIndex* index, FILE* output);
+
+/**
+ * @brief Deallocate an index (but not the symbols or nodes it refers to)
+ */
+void XrefIndex_free (XrefIndex* index);
+
+#endif
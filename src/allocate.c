@@ -0,0 +1,83 @@
+#include "allocate.h"
+
+/**
+ * @brief State for the storage allocation visitor
+ */
+typedef struct AllocateData
+{
+    int local_size;             /**< @brief Bytes of locals live at the current point */
+    int frame_size;             /**< @brief Largest @c local_size in the current function */
+} AllocateData;
+
+#define DATA ((AllocateData*)visitor->data)
+
+void AllocateSymbolsVisitor_previsit_program (NodeVisitor* visitor, ASTNode* node)
+{
+    /* globals are laid out in declaration order; functions need no storage */
+    int static_size = 0;
+    FOR_EACH(Symbol*, sym, node->scope->local_symbols) {
+        if (sym->symbol_type != FUNCTION_SYMBOL) {
+            sym->location = STATIC_VAR;
+            sym->offset = static_size;
+            static_size += sym->length * WORD_SIZE;
+        }
+    }
+    ASTNode_set_int_attribute(node, "staticSize", static_size);
+}
+
+void AllocateSymbolsVisitor_previsit_funcdecl (NodeVisitor* visitor, ASTNode* node)
+{
+    /* the function's table contains only its parameters */
+    int offset = FIRST_PARAM_OFFSET;
+    FOR_EACH(Symbol*, sym, node->scope->local_symbols) {
+        sym->location = STACK_PARAM;
+        sym->offset = offset;
+        offset += WORD_SIZE;
+    }
+    DATA->local_size = 0;
+    DATA->frame_size = 0;
+}
+
+void AllocateSymbolsVisitor_postvisit_funcdecl (NodeVisitor* visitor, ASTNode* node)
+{
+    ASTNode_set_int_attribute(node, "localSize", DATA->frame_size);
+}
+
+void AllocateSymbolsVisitor_previsit_block (NodeVisitor* visitor, ASTNode* node)
+{
+    /* stack the block's locals below those of the enclosing blocks */
+    FOR_EACH(Symbol*, sym, node->scope->local_symbols) {
+        DATA->local_size += sym->length * WORD_SIZE;
+        sym->location = STACK_LOCAL;
+        sym->offset = -DATA->local_size;
+    }
+    if (DATA->local_size > DATA->frame_size) {
+        DATA->frame_size = DATA->local_size;
+    }
+}
+
+void AllocateSymbolsVisitor_postvisit_block (NodeVisitor* visitor, ASTNode* node)
+{
+    /* release the block's slots so that the next sibling block can reuse them */
+    FOR_EACH(Symbol*, sym, node->scope->local_symbols) {
+        DATA->local_size -= sym->length * WORD_SIZE;
+    }
+}
+
+NodeVisitor* AllocateSymbolsVisitor_new ()
+{
+    AllocateData* data = (AllocateData*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(AllocateData));
+    CHECK_MALLOC_PTR(data)
+    data->local_size = 0;
+    data->frame_size = 0;
+
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = data;
+    v->dtor = Memory_free;
+    v->previsit_program   = AllocateSymbolsVisitor_previsit_program;
+    v->previsit_funcdecl  = AllocateSymbolsVisitor_previsit_funcdecl;
+    v->postvisit_funcdecl = AllocateSymbolsVisitor_postvisit_funcdecl;
+    v->previsit_block     = AllocateSymbolsVisitor_previsit_block;
+    v->postvisit_block    = AllocateSymbolsVisitor_postvisit_block;
+    return v;
+}
@@ -41,15 +41,15 @@ const char* NodeType_to_string(NodeType type)
 /*
  * use macros defined in common.h to implement lists for nodes and parameters
  */
-DEF_LIST_IMPL(Node, struct ASTNode*, ASTNode_free)
-DEF_LIST_IMPL(Parameter, struct Parameter*, free)
+DEF_LIST_IMPL(Node, struct ASTNode*, ASTNode_free, MEM_AST)
+DEF_LIST_IMPL(Parameter, struct Parameter*, Memory_free, MEM_PARAMETER)
 
 /*
  * this custom add-parameter method handles allocation as well
  */
 void ParameterList_add_new (ParameterList* list, const char* name, DecafType type)
 {
-    Parameter* param = (Parameter*)calloc(1, sizeof(Parameter));
+    Parameter* param = (Parameter*)Memory_calloc(MEM_PARAMETER, 1, sizeof(Parameter));
     CHECK_MALLOC_PTR(param)
     snprintf(param->name, MAX_ID_LEN, "%s", name);
     param->type = type;
@@ -58,12 +58,13 @@ void ParameterList_add_new (ParameterList* list, const char* name, DecafType typ
 
 ASTNode* ASTNode_new (NodeType type, int source_line)
 {
-    ASTNode* node = (ASTNode*)calloc(1, sizeof(ASTNode));
+    ASTNode* node = (ASTNode*)Memory_calloc(MEM_AST, 1, sizeof(ASTNode));
     CHECK_MALLOC_PTR(node)
     node->type = type;
     node->source_line = source_line;
     node->attributes = NULL;
     node->next = NULL;
+    node->scope = NULL;
     return node;
 }
 
@@ -85,7 +86,7 @@ void ASTNode_set_printable_attribute (ASTNode* node, const char* key, void* valu
     }
 
     /* allocate new attribute */
-    Attribute* attr = (Attribute*)calloc(1, sizeof(Attribute));
+    Attribute* attr = (Attribute*)Memory_calloc(MEM_ATTRIBUTE, 1, sizeof(Attribute));
     CHECK_MALLOC_PTR(attr)
     attr->key = key;
     attr->value = value;
@@ -106,7 +107,7 @@ void ASTNode_set_printable_attribute (ASTNode* node, const char* key, void* valu
                 a->dtor(a->value);
                 a->value = value;
                 a->dtor = dtor;
-                free(attr);
+                Memory_free(attr);
                 return;
             }
         }
@@ -159,7 +160,7 @@ void ASTNode_free (ASTNode* node)
         if (cur->dtor != NULL) {
             cur->dtor(cur->value);
         }
-        free(cur);
+        Memory_free(cur);
     }
 
     /* clean up node-specific data */
@@ -216,7 +217,7 @@ void ASTNode_free (ASTNode* node)
     }
 
     /* clean up node itself */
-    free(node);
+    Memory_free(node);
 }
 
 ASTNode* ProgramNode_new (NodeList* vars, NodeList* funcs)
@@ -348,6 +349,7 @@ ASTNode* LocationNode_new (const char* name, struct ASTNode* index, int source_l
     ASTNode* node = ASTNode_new(LOCATION, source_line);
     snprintf(node->location.name, MAX_ID_LEN, "%s", name);
     node->location.index = index;
+    node->location.symbol = NULL;
     return node;
 }
 
@@ -356,6 +358,7 @@ ASTNode* FuncCallNode_new (const char* name, NodeList* args, int source_line)
     ASTNode* node = ASTNode_new(FUNCCALL, source_line);
     snprintf(node->funccall.name, MAX_ID_LEN, "%s", name);
     node->funccall.arguments = args;
+    node->funccall.symbol = NULL;
     return node;
 }
 
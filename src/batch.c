@@ -0,0 +1,193 @@
+#include "batch.h"
+
+#include <ctype.h>
+
+bool batch_read_list (const char* listfile, char*** files, int* num_files, int* capacity)
+{
+    FILE* input = fopen(listfile, "r");
+    if (input == NULL) {
+        return false;
+    }
+    char line[MAX_LINE_LEN];
+    while (fgets(line, MAX_LINE_LEN, input) != NULL) {
+        char* start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        char* end = start + strlen(start);
+        while (end > start && isspace((unsigned char)end[-1])) {
+            end--;
+        }
+        if (end == start) {
+            continue;
+        }
+        *end = '\0';
+        if (*num_files == *capacity) {
+            *capacity *= 2;
+            *files = (char**)Memory_realloc(*files, *capacity, sizeof(char*));
+            CHECK_MALLOC_PTR(*files)
+        }
+        char* name = (char*)Memory_calloc(MEM_TOKEN, end - start + 1, sizeof(char));
+        CHECK_MALLOC_PTR(name)
+        memcpy(name, start, end - start);
+        (*files)[(*num_files)++] = name;
+    }
+    fclose(input);
+    return true;
+}
+
+/**
+ * @brief Finished output of one file, held until every earlier file is printed
+ */
+typedef struct BatchResult
+{
+    char* text;                     /**< @brief Output of the file (@c NULL until it finishes) */
+    size_t size;                    /**< @brief Length of @c text */
+    bool done;                      /**< @brief Whether the file has finished */
+    bool failed;                    /**< @brief Whether the file failed */
+} BatchResult;
+
+/**
+ * @brief Files in a batch and where their results go
+ */
+typedef struct BatchJobs
+{
+    char** files;                   /**< @brief Names of the files, in output order */
+    BatchResult* results;           /**< @brief Result of each file */
+    const BatchOptions* options;    /**< @brief Settings for every file */
+    FILE* output;                   /**< @brief Stream for the grouped outputs */
+    mtx_t lock;                     /**< @brief Protects the fields below and @c output */
+    int num_files;                  /**< @brief Number of files in the batch */
+    int next_print;                 /**< @brief Index of the first file not yet printed */
+    int failures;                   /**< @brief Number of failed files printed so far */
+} BatchJobs;
+
+/**
+ * @brief Describe the settings that change a file's output (for cache keys)
+ */
+void batch_cache_options (const BatchOptions* options, char* buffer, size_t size)
+{
+    const CompileOptions* compile = &options->compile;
+    snprintf(buffer, size, "max_errors=%d hash_cons=%d fold=%d dce=%d check_init=%d allocate=%d xref=%d callgraph=%d cfg=%d",
+            compile->max_errors, compile->hash_cons ? 1 : 0, compile->fold ? 1 : 0, compile->dce ? 1 : 0, compile->check_init ? 1 : 0,
+            compile->allocate ? 1 : 0, compile->xref ? 1 : 0,
+            compile->callgraph ? 1 : 0, compile->cfg ? 1 : 0);
+}
+
+/**
+ * @brief Print every finished file that has no unfinished file before it
+ *
+ * Called with @c jobs->lock held, so files are printed one at a time and in
+ * the order given; each output is freed once printed.
+ */
+void batch_print_ready (BatchJobs* jobs)
+{
+    while (jobs->next_print < jobs->num_files && jobs->results[jobs->next_print].done) {
+        BatchResult* result = &jobs->results[jobs->next_print];
+        if (jobs->options->headers) {
+            fprintf(jobs->output, "==> %s <==\n", jobs->files[jobs->next_print]);
+        }
+        fwrite(result->text, 1, result->size, jobs->output);
+        jobs->failures += (result->failed ? 1 : 0);
+        Memory_free(result->text);
+        result->text = NULL;
+        jobs->next_print++;
+    }
+}
+
+/**
+ * @brief Compile one file into a temporary stream
+ *
+ * @returns True if and only if the file was compiled (or replayed) without errors
+ */
+bool batch_compile_file (const char* filename, const BatchOptions* options, FILE* output)
+{
+    char* text = (char*)Memory_calloc(MEM_TOKEN, MAX_FILE_SIZE + 1, sizeof(char));
+    CHECK_MALLOC_PTR(text)
+    bool failed;
+    ReadStatus read = read_file(filename, text);
+    if (read == READ_TOO_LARGE) {
+        fprintf(output, "File too large (over %d bytes): %s\n", MAX_FILE_SIZE, filename);
+        failed = true;
+    } else if (read != READ_OK) {
+        fprintf(output, "Could not read file: %s\n", filename);
+        failed = true;
+    } else if (options->cache == NULL) {
+        failed = (compile_source(text, &options->compile, output, output, NULL) != DECAF_OK);
+    } else {
+        char settings[MAX_LINE_LEN];
+        batch_cache_options(options, settings, sizeof(settings));
+        uint64_t key = ResultCache_key(text, strlen(text), settings);
+        if (!ResultCache_replay(options->cache, key, output, &failed)) {
+            failed = (compile_source(text, &options->compile, output, output, NULL) != DECAF_OK);
+            ResultCache_store(options->cache, key, output, failed);
+        }
+    }
+    Memory_free(text);
+    return !failed;
+}
+
+/**
+ * @brief Compile one file and hand its output over for printing (a @ref ThreadPoolJob)
+ *
+ * The temporary stream is open only while the job runs, so a batch needs at
+ * most one per worker however many files it has.
+ */
+void batch_compile_job (void* context, int job, int worker)
+{
+    BatchJobs* jobs = (BatchJobs*)context;
+    BatchResult result = { NULL, 0, true, true };
+
+    FILE* output = tmpfile();
+    if (output != NULL) {
+        result.failed = !batch_compile_file(jobs->files[job], jobs->options, output);
+        fflush(output);
+        long size = ftell(output);
+        result.text = (char*)Memory_calloc(MEM_ANALYSIS, size > 0 ? size : 1, sizeof(char));
+        CHECK_MALLOC_PTR(result.text)
+        rewind(output);
+        result.size = (size > 0 ? fread(result.text, 1, size, output) : 0);
+        fclose(output);
+    } else {
+        char message[MAX_LINE_LEN];
+        int length = snprintf(message, sizeof(message), "Could not create temporary output for: %s\n", jobs->files[job]);
+        result.size = (length < (int)sizeof(message) ? (size_t)length : sizeof(message) - 1);
+        result.text = (char*)Memory_calloc(MEM_ANALYSIS, result.size + 1, sizeof(char));
+        CHECK_MALLOC_PTR(result.text)
+        memcpy(result.text, message, result.size);
+    }
+
+    mtx_lock(&jobs->lock);
+    jobs->results[job] = result;
+    batch_print_ready(jobs);
+    mtx_unlock(&jobs->lock);
+}
+
+int decaf_batch (char** files, int num_files, const BatchOptions* options, FILE* output)
+{
+    BatchJobs jobs;
+    jobs.files = files;
+    jobs.options = options;
+    jobs.output = output;
+    jobs.num_files = num_files;
+    jobs.next_print = 0;
+    jobs.failures = 0;
+    jobs.results = (BatchResult*)Memory_calloc(MEM_ANALYSIS, num_files + 1, sizeof(BatchResult));
+    CHECK_MALLOC_PTR(jobs.results)
+    if (mtx_init(&jobs.lock, mtx_plain) != thrd_success) {
+        fprintf(stderr, "ERROR: could not create batch lock\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* workers keep their compiled lexer patterns from one file to the next */
+    Regex_enable_cache(true);
+    ThreadPool* pool = ThreadPool_new(options->jobs < num_files ? options->jobs : num_files);
+    ThreadPool_run(pool, num_files, batch_compile_job, &jobs);
+    ThreadPool_free(pool);
+    Regex_clear_cache();
+    Regex_enable_cache(false);
+
+    mtx_destroy(&jobs.lock);
+    Memory_free(jobs.results);
+    return jobs.failures;
+}
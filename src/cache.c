@@ -0,0 +1,623 @@
+#include "cache.h"
+
+/**
+ * @brief Identifies the compiler that produced a cached result
+ *
+ * The Makefile defines it as a checksum of the compiler's sources, so a
+ * rebuilt compiler never replays the results of an older one.
+ */
+#ifndef DECAF_BUILD_ID
+#define DECAF_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+/**
+ * @brief Version of the index format (a mismatch starts an empty cache)
+ */
+#define RESULT_CACHE_VERSION 1
+
+/**
+ * @brief Number of stores and removals between merges into the index file
+ */
+#define RESULT_CACHE_MERGE_INTERVAL 16
+
+/**
+ * @brief Number of 1 ms waits for the index lock before it is considered stale
+ */
+#define RESULT_CACHE_LOCK_ATTEMPTS 2000
+
+/**
+ * @brief Build the name of a file in the cache directory
+ */
+void ResultCache_path (ResultCache* cache, const char* name, char* path)
+{
+    snprintf(path, MAX_LINE_LEN, "%s/%s", cache->directory, name);
+}
+
+/**
+ * @brief Build the name of the file holding an entry's output
+ */
+void ResultCache_entry_path (ResultCache* cache, uint64_t key, char* path)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".out", key);
+    ResultCache_path(cache, name, path);
+}
+
+/**
+ * @brief Find the hash table slot that holds a key, or the empty slot where it would go
+ */
+int ResultCache_slot (ResultCache* cache, uint64_t key)
+{
+    /* keys are already hashes, so their low bits are well mixed */
+    int mask = cache->num_slots - 1;
+    int slot = (int)(key & (uint64_t)mask);
+    while (cache->slots[slot] >= 0 && cache->entries[cache->slots[slot]].key != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Find an entry by key
+ *
+ * @returns Index of the entry, or -1 if there is none
+ */
+int ResultCache_find (ResultCache* cache, uint64_t key)
+{
+    return cache->slots[ResultCache_slot(cache, key)];
+}
+
+/**
+ * @brief Rebuild the hash table with a given number of slots
+ */
+void ResultCache_rehash (ResultCache* cache, int num_slots)
+{
+    if (cache->slots != NULL) {
+        Memory_free(cache->slots);
+    }
+    cache->num_slots = num_slots;
+    cache->slots = (int*)Memory_calloc(MEM_ANALYSIS, num_slots, sizeof(int));
+    CHECK_MALLOC_PTR(cache->slots)
+    for (int i = 0; i < num_slots; i++) {
+        cache->slots[i] = -1;
+    }
+    for (int i = 0; i < cache->size; i++) {
+        cache->slots[ResultCache_slot(cache, cache->entries[i].key)] = i;
+    }
+}
+
+/**
+ * @brief Take an entry out of the LRU list
+ */
+void ResultCache_unlink (ResultCache* cache, int index)
+{
+    ResultCacheEntry* entry = &cache->entries[index];
+    if (entry->older >= 0) {
+        cache->entries[entry->older].newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+    if (entry->newer >= 0) {
+        cache->entries[entry->newer].older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    entry->older = entry->newer = -1;
+}
+
+/**
+ * @brief Put an entry at the most recently used end of the LRU list
+ */
+void ResultCache_link_newest (ResultCache* cache, int index)
+{
+    ResultCacheEntry* entry = &cache->entries[index];
+    entry->older = cache->newest;
+    entry->newer = -1;
+    if (cache->newest >= 0) {
+        cache->entries[cache->newest].newer = index;
+    } else {
+        cache->oldest = index;
+    }
+    cache->newest = index;
+}
+
+/**
+ * @brief Add an entry to the in-memory index (as the most recently used one)
+ */
+void ResultCache_add (ResultCache* cache, uint64_t key, size_t size, uint64_t last_use, bool failed)
+{
+    if (cache->size == cache->capacity) {
+        cache->capacity *= 2;
+        cache->entries = (ResultCacheEntry*)Memory_realloc(cache->entries,
+                cache->capacity, sizeof(ResultCacheEntry));
+        CHECK_MALLOC_PTR(cache->entries)
+    }
+    if (2 * (cache->size + 1) > cache->num_slots) {
+        ResultCache_rehash(cache, 2 * cache->num_slots);
+    }
+    int index = cache->size++;
+    ResultCacheEntry* entry = &cache->entries[index];
+    entry->key = key;
+    entry->size = size;
+    entry->last_use = last_use;
+    entry->failed = failed;
+    entry->changed = false;
+    cache->slots[ResultCache_slot(cache, key)] = index;
+    ResultCache_link_newest(cache, index);
+    cache->total_size += size;
+}
+
+/**
+ * @brief Remove an entry from the in-memory index (its output file is left alone)
+ */
+void ResultCache_forget (ResultCache* cache, int index)
+{
+    ResultCache_unlink(cache, index);
+    cache->total_size -= cache->entries[index].size;
+
+    /* empty the entry's slot, shifting back any later key of the same run
+     * that could not be found past the hole otherwise */
+    int mask = cache->num_slots - 1;
+    int hole = ResultCache_slot(cache, cache->entries[index].key);
+    cache->slots[hole] = -1;
+    for (int slot = (hole + 1) & mask; cache->slots[slot] >= 0; slot = (slot + 1) & mask) {
+        int home = (int)(cache->entries[cache->slots[slot]].key & (uint64_t)mask);
+        bool reachable = (hole <= slot ? (hole < home && home <= slot) : (hole < home || home <= slot));
+        if (!reachable) {
+            cache->slots[hole] = cache->slots[slot];
+            cache->slots[slot] = -1;
+            hole = slot;
+        }
+    }
+
+    /* keep the entries dense by moving the last one into the gap */
+    int last = --cache->size;
+    if (index != last) {
+        ResultCacheEntry* entry = &cache->entries[index];
+        *entry = cache->entries[last];
+        cache->slots[ResultCache_slot(cache, entry->key)] = index;
+        if (entry->older >= 0) {
+            cache->entries[entry->older].newer = index;
+        } else {
+            cache->oldest = index;
+        }
+        if (entry->newer >= 0) {
+            cache->entries[entry->newer].older = index;
+        } else {
+            cache->newest = index;
+        }
+    }
+}
+
+/**
+ * @brief Remove an entry and its output file
+ */
+void ResultCache_remove (ResultCache* cache, int index)
+{
+    char path[MAX_LINE_LEN];
+    ResultCache_entry_path(cache, cache->entries[index].key, path);
+    remove(path);
+    if (cache->num_removed == cache->removed_capacity) {
+        cache->removed_capacity *= 2;
+        cache->removed = (uint64_t*)Memory_realloc(cache->removed, cache->removed_capacity, sizeof(uint64_t));
+        CHECK_MALLOC_PTR(cache->removed)
+    }
+    cache->removed[cache->num_removed++] = cache->entries[index].key;
+    cache->changes++;
+    ResultCache_forget(cache, index);
+}
+
+/**
+ * @brief Mark an entry as just used
+ */
+void ResultCache_touch (ResultCache* cache, int index)
+{
+    cache->entries[index].last_use = ++cache->clock;
+    cache->entries[index].changed = true;
+    ResultCache_unlink(cache, index);
+    ResultCache_link_newest(cache, index);
+}
+
+/**
+ * @brief Evict least recently used entries until the total fits the limit
+ */
+void ResultCache_evict (ResultCache* cache)
+{
+    while (cache->total_size > cache->max_size && cache->oldest >= 0) {
+        ResultCache_remove(cache, cache->oldest);
+        cache->run.evictions++;
+        cache->total.evictions++;
+    }
+}
+
+/**
+ * @brief Order two entries by last use (for qsort)
+ */
+int ResultCache_compare_use (const void* left, const void* right)
+{
+    uint64_t a = ((const ResultCacheEntry*)left)->last_use;
+    uint64_t b = ((const ResultCacheEntry*)right)->last_use;
+    return (a < b ? -1 : (a > b ? 1 : 0));
+}
+
+/**
+ * @brief Rebuild the hash table and the LRU list after entries were added out of order
+ */
+void ResultCache_reorder (ResultCache* cache)
+{
+    qsort(cache->entries, cache->size, sizeof(ResultCacheEntry), ResultCache_compare_use);
+    ResultCache_rehash(cache, cache->num_slots);
+    cache->oldest = cache->newest = -1;
+    for (int i = 0; i < cache->size; i++) {
+        ResultCache_link_newest(cache, i);
+    }
+}
+
+/**
+ * @brief Read the index file (a missing or unrecognized index is an empty cache)
+ */
+void ResultCache_read_index (ResultCache* cache)
+{
+    char path[MAX_LINE_LEN];
+    ResultCache_path(cache, "index", path);
+    FILE* input = fopen(path, "r");
+    if (input == NULL) {
+        return;
+    }
+    int version = 0;
+    if (fscanf(input, "decaf-cache %d %" SCNu64 " %ld %ld %ld %ld\n", &version, &cache->clock,
+                &cache->total.hits, &cache->total.misses,
+                &cache->total.stores, &cache->total.evictions) == 6
+            && version == RESULT_CACHE_VERSION) {
+        uint64_t key, last_use;
+        size_t size;
+        int failed;
+        while (fscanf(input, "%" SCNx64 " %zu %" SCNu64 " %d\n", &key, &size, &last_use, &failed) == 4) {
+            if (ResultCache_find(cache, key) < 0) {
+                ResultCache_add(cache, key, size, last_use, failed != 0);
+            }
+        }
+    } else {
+        cache->clock = 0;
+        cache->total = (ResultCacheStats){ 0 };
+    }
+    fclose(input);
+    ResultCache_reorder(cache);
+}
+
+/**
+ * @brief Write the index file under a temporary name and rename it into place
+ *
+ * @returns True if the new index replaced the old one
+ */
+bool ResultCache_write_index (ResultCache* cache)
+{
+    char path[MAX_LINE_LEN], partial[MAX_LINE_LEN];
+    ResultCache_path(cache, "index", path);
+    ResultCache_path(cache, "index.tmp", partial);
+    FILE* index = fopen(partial, "w");
+    if (index == NULL) {
+        return false;
+    }
+    fprintf(index, "decaf-cache %d %" PRIu64 " %ld %ld %ld %ld\n", RESULT_CACHE_VERSION, cache->clock,
+            cache->total.hits, cache->total.misses, cache->total.stores, cache->total.evictions);
+    for (int i = cache->oldest; i >= 0; i = cache->entries[i].newer) {
+        ResultCacheEntry* entry = &cache->entries[i];
+        fprintf(index, "%016" PRIx64 " %zu %" PRIu64 " %d\n",
+                entry->key, entry->size, entry->last_use, entry->failed ? 1 : 0);
+    }
+    if (fclose(index) != 0 || rename(partial, path) != 0) {
+        remove(partial);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check whether an entry's output file exists
+ */
+bool ResultCache_has_output (ResultCache* cache, uint64_t key)
+{
+    char path[MAX_LINE_LEN];
+    ResultCache_entry_path(cache, key, path);
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Take the lock file that serializes index updates between processes
+ *
+ * A lock that is still held after a couple of seconds belongs to a process
+ * that died while holding it (updates take milliseconds), so it is broken.
+ *
+ * @returns True if the lock was taken
+ */
+bool ResultCache_lock_index (ResultCache* cache)
+{
+    char path[MAX_LINE_LEN];
+    ResultCache_path(cache, "index.lock", path);
+    for (int attempt = 0; attempt <= RESULT_CACHE_LOCK_ATTEMPTS; attempt++) {
+        if (attempt == RESULT_CACHE_LOCK_ATTEMPTS) {
+            remove(path);
+        }
+        FILE* lock = fopen(path, "wx");
+        if (lock != NULL) {
+            fclose(lock);
+            return true;
+        }
+        thrd_sleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+    }
+    return false;
+}
+
+/**
+ * @brief Release the lock taken by @ref ResultCache_lock_index
+ */
+void ResultCache_unlock_index (ResultCache* cache)
+{
+    char path[MAX_LINE_LEN];
+    ResultCache_path(cache, "index.lock", path);
+    remove(path);
+}
+
+/**
+ * @brief Merge this process's changes into the index file (with @c cache->lock held)
+ *
+ * The in-memory index is rebuilt from the file, which may have been updated
+ * by other processes since it was read, and then this process's removals,
+ * stores, and uses are applied on top of it. Entries whose output file has
+ * disappeared in the meantime (evicted by another process) are dropped, and
+ * the result is evicted down to the limit before it is written back.
+ */
+void ResultCache_merge (ResultCache* cache)
+{
+    cache->changes = 0;
+    if (!ResultCache_lock_index(cache)) {
+        /* keep the changes for the next merge */
+        fprintf(stderr, "WARNING: could not lock cache index in %s\n", cache->directory);
+        return;
+    }
+
+    /* set aside what this process changed */
+    ResultCacheEntry* changed = (ResultCacheEntry*)Memory_calloc(MEM_ANALYSIS, cache->size + 1, sizeof(ResultCacheEntry));
+    CHECK_MALLOC_PTR(changed)
+    int num_changed = 0;
+    for (int i = 0; i < cache->size; i++) {
+        if (cache->entries[i].changed) {
+            changed[num_changed++] = cache->entries[i];
+        }
+    }
+    uint64_t clock = cache->clock;
+
+    /* start over from the file */
+    cache->size = 0;
+    cache->total_size = 0;
+    cache->oldest = cache->newest = -1;
+    ResultCache_rehash(cache, cache->num_slots);
+    cache->clock = 0;
+    cache->total = (ResultCacheStats){ 0 };
+    ResultCache_read_index(cache);
+    if (cache->clock < clock) {
+        cache->clock = clock;
+    }
+
+    /* apply this process's changes */
+    for (int i = 0; i < cache->num_removed; i++) {
+        int index = ResultCache_find(cache, cache->removed[i]);
+        if (index >= 0 && !ResultCache_has_output(cache, cache->removed[i])) {
+            ResultCache_forget(cache, index);
+        }
+    }
+    cache->num_removed = 0;
+    for (int i = 0; i < num_changed; i++) {
+        if (!ResultCache_has_output(cache, changed[i].key)) {
+            continue;
+        }
+        int index = ResultCache_find(cache, changed[i].key);
+        if (index < 0) {
+            ResultCache_add(cache, changed[i].key, changed[i].size, changed[i].last_use, changed[i].failed);
+            continue;
+        }
+        ResultCacheEntry* entry = &cache->entries[index];
+        cache->total_size += changed[i].size - entry->size;
+        entry->size = changed[i].size;
+        entry->failed = changed[i].failed;
+        if (entry->last_use < changed[i].last_use) {
+            entry->last_use = changed[i].last_use;
+        }
+    }
+    Memory_free(changed);
+    ResultCache_reorder(cache);
+
+    /* add this process's counters since the last merge */
+    cache->total.hits      += cache->run.hits      - cache->merged.hits;
+    cache->total.misses    += cache->run.misses    - cache->merged.misses;
+    cache->total.stores    += cache->run.stores    - cache->merged.stores;
+    cache->total.evictions += cache->run.evictions - cache->merged.evictions;
+    ResultCache_evict(cache);
+    cache->merged = cache->run;
+    cache->num_removed = 0;
+    cache->changes = 0;
+
+    if (!ResultCache_write_index(cache)) {
+        char path[MAX_LINE_LEN];
+        ResultCache_path(cache, "index", path);
+        fprintf(stderr, "WARNING: could not write cache index %s\n", path);
+    }
+    ResultCache_unlock_index(cache);
+}
+
+ResultCache* ResultCache_open (const char* directory, size_t max_size)
+{
+    /* leave room for the entries' file names */
+    if (strlen(directory) >= MAX_LINE_LEN - 32) {
+        return NULL;
+    }
+    ResultCache* cache = (ResultCache*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ResultCache));
+    CHECK_MALLOC_PTR(cache)
+    snprintf(cache->directory, sizeof(cache->directory), "%s", directory);
+    cache->max_size = max_size;
+    cache->capacity = 16;
+    cache->entries = (ResultCacheEntry*)Memory_calloc(MEM_ANALYSIS, cache->capacity, sizeof(ResultCacheEntry));
+    CHECK_MALLOC_PTR(cache->entries)
+    cache->removed_capacity = 16;
+    cache->removed = (uint64_t*)Memory_calloc(MEM_ANALYSIS, cache->removed_capacity, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(cache->removed)
+    cache->oldest = cache->newest = -1;
+    ResultCache_rehash(cache, 32);
+    if (mtx_init(&cache->lock, mtx_plain) != thrd_success) {
+        fprintf(stderr, "ERROR: could not create cache lock\n");
+        exit(EXIT_FAILURE);
+    }
+    ResultCache_read_index(cache);
+
+    /* make sure the directory is writable before relying on it */
+    char path[MAX_LINE_LEN];
+    ResultCache_path(cache, "index", path);
+    FILE* index = fopen(path, "a");
+    if (index == NULL) {
+        mtx_destroy(&cache->lock);
+        Memory_free(cache->removed);
+        Memory_free(cache->slots);
+        Memory_free(cache->entries);
+        Memory_free(cache);
+        return NULL;
+    }
+    fclose(index);
+
+    /* the limit may be lower than in the previous run */
+    if (cache->total_size > cache->max_size) {
+        ResultCache_merge(cache);
+    }
+    return cache;
+}
+
+uint64_t ResultCache_key (const char* text, size_t length, const char* options)
+{
+    uint64_t key = hash_bytes(text, length);
+    key = hash_combine(key, hash_string(DECAF_BUILD_ID));
+    key = hash_combine(key, hash_string(options));
+    return key;
+}
+
+bool ResultCache_replay (ResultCache* cache, uint64_t key, FILE* output, bool* failed)
+{
+    mtx_lock(&cache->lock);
+    int index = ResultCache_find(cache, key);
+    FILE* input = NULL;
+    if (index >= 0) {
+        char path[MAX_LINE_LEN];
+        ResultCache_entry_path(cache, key, path);
+        input = fopen(path, "rb");
+        if (input == NULL) {
+            /* removed behind our back; forget it */
+            ResultCache_remove(cache, index);
+        }
+    }
+    if (input == NULL) {
+        cache->run.misses++;
+        cache->total.misses++;
+        mtx_unlock(&cache->lock);
+        return false;
+    }
+    ResultCache_touch(cache, index);
+    *failed = cache->entries[index].failed;
+    cache->run.hits++;
+    cache->total.hits++;
+    mtx_unlock(&cache->lock);
+
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        fwrite(buffer, 1, count, output);
+    }
+    fclose(input);
+    return true;
+}
+
+void ResultCache_store (ResultCache* cache, uint64_t key, FILE* output, bool failed)
+{
+    char path[MAX_LINE_LEN], partial[MAX_LINE_LEN];
+    ResultCache_entry_path(cache, key, path);
+    snprintf(partial, MAX_LINE_LEN, "%s.%p.tmp", path, (void*)output);
+
+    /* write under a private name so a reader never sees a partial entry */
+    FILE* file = fopen(partial, "wb");
+    if (file == NULL) {
+        return;
+    }
+    size_t size = 0;
+    char buffer[4096];
+    size_t count;
+    rewind(output);
+    while ((count = fread(buffer, 1, sizeof(buffer), output)) > 0) {
+        size += fwrite(buffer, 1, count, file);
+    }
+    if (fclose(file) != 0 || size > cache->max_size) {
+        remove(partial);
+        return;
+    }
+
+    mtx_lock(&cache->lock);
+    if (rename(partial, path) == 0) {
+        int index = ResultCache_find(cache, key);
+        if (index >= 0) {
+            ResultCache_forget(cache, index);
+        }
+        ResultCache_add(cache, key, size, ++cache->clock, failed);
+        cache->entries[cache->newest].changed = true;
+        cache->run.stores++;
+        cache->total.stores++;
+        cache->changes++;
+        ResultCache_evict(cache);
+        if (cache->changes >= RESULT_CACHE_MERGE_INTERVAL) {
+            ResultCache_merge(cache);
+        }
+    } else {
+        remove(partial);
+    }
+    mtx_unlock(&cache->lock);
+}
+
+/**
+ * @brief Print one line of counters
+ */
+void ResultCache_print_counters (const char* label, ResultCacheStats* stats, FILE* output)
+{
+    long lookups = stats->hits + stats->misses;
+    fprintf(output, "  %-10s %8ld hits %8ld misses %8ld stores %8ld evictions",
+            label, stats->hits, stats->misses, stats->stores, stats->evictions);
+    if (lookups > 0) {
+        fprintf(output, "  (%.1f%% hit rate)", 100.0 * (double)stats->hits / (double)lookups);
+    }
+    fprintf(output, "\n");
+}
+
+void ResultCache_print_stats (ResultCache* cache, FILE* output)
+{
+    mtx_lock(&cache->lock);
+    fprintf(output, "Result cache %s: %d entries, %zu of %zu bytes\n",
+            cache->directory, cache->size, cache->total_size, cache->max_size);
+    ResultCache_print_counters("this run", &cache->run, output);
+    ResultCache_print_counters("all runs", &cache->total, output);
+    mtx_unlock(&cache->lock);
+}
+
+void ResultCache_close (ResultCache* cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    mtx_lock(&cache->lock);
+    ResultCache_merge(cache);
+    mtx_unlock(&cache->lock);
+    mtx_destroy(&cache->lock);
+    Memory_free(cache->removed);
+    Memory_free(cache->slots);
+    Memory_free(cache->entries);
+    Memory_free(cache);
+}
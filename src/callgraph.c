@@ -0,0 +1,304 @@
+#include "callgraph.h"
+#include "visitor.h"
+
+/**
+ * @brief Initial number of edges allocated for a graph
+ */
+#define CALLGRAPH_INITIAL_EDGES 64
+
+/**
+ * @brief State of a call graph construction
+ */
+typedef struct CallGraphBuilder
+{
+    CallGraph* graph;               /**< @brief Graph under construction */
+    int capacity;                   /**< @brief Allocated length of @c graph->edges */
+} CallGraphBuilder;
+
+/*
+ * NODES AND EDGES
+ */
+
+int CallGraph_find (CallGraph* graph, const Symbol* symbol)
+{
+    return (symbol == NULL ? -1 : PointerMap_find(&graph->functions, symbol));
+}
+
+/**
+ * @brief Record a call from the function being scanned (a @c previsit_funccall routine)
+ */
+void callgraph_visit_funccall (NodeVisitor* visitor, ASTNode* node)
+{
+    CallGraphBuilder* builder = (CallGraphBuilder*)visitor->data;
+    CallGraph* graph = builder->graph;
+    int callee = CallGraph_find(graph, node->funccall.symbol);
+    if (callee < 0) {
+        return;
+    }
+    if (graph->num_edges == builder->capacity) {
+        builder->capacity *= 2;
+        graph->edges = (CallGraphEdge*)Memory_realloc(graph->edges, builder->capacity, sizeof(CallGraphEdge));
+        CHECK_MALLOC_PTR(graph->edges)
+    }
+    graph->edges[graph->num_edges].callee = callee;
+    graph->edges[graph->num_edges].site = node;
+    graph->num_edges++;
+}
+
+/*
+ * STRONGLY CONNECTED COMPONENTS
+ */
+
+/**
+ * @brief Find the SCCs of a graph with Tarjan's algorithm
+ *
+ * The depth-first search keeps its own stack (with the next edge to follow
+ * from each function), so long call chains cannot overflow the C stack.
+ */
+void callgraph_tarjan (CallGraph* graph)
+{
+    int n = graph->num_nodes;
+    graph->sccs = (CallGraphSCC*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(CallGraphSCC));
+    CHECK_MALLOC_PTR(graph->sccs)
+    graph->members = (int*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(int));
+    CHECK_MALLOC_PTR(graph->members)
+    int* order = (int*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(int));
+    CHECK_MALLOC_PTR(order)
+    int* lowlink = (int*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(int));
+    CHECK_MALLOC_PTR(lowlink)
+    bool* on_stack = (bool*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(bool));
+    CHECK_MALLOC_PTR(on_stack)
+    int* stack = (int*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(int));
+    CHECK_MALLOC_PTR(stack)
+    int* path = (int*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(int));
+    CHECK_MALLOC_PTR(path)
+    int* next_edge = (int*)Memory_calloc(MEM_ANALYSIS, n + 1, sizeof(int));
+    CHECK_MALLOC_PTR(next_edge)
+
+    /* order[v] is one more than v's discovery time (0 until v is visited) */
+    int counter = 0, top = 0, depth = 0, filled = 0;
+    for (int root = 0; root < n; root++) {
+        if (order[root] != 0) {
+            continue;
+        }
+        order[root] = lowlink[root] = ++counter;
+        stack[top++] = root;
+        on_stack[root] = true;
+        path[depth++] = root;
+
+        while (depth > 0) {
+            int v = path[depth - 1];
+            CallGraphNode* node = &graph->nodes[v];
+            if (next_edge[v] < node->num_edges) {
+                int w = graph->edges[node->first_edge + next_edge[v]++].callee;
+                if (order[w] == 0) {
+                    order[w] = lowlink[w] = ++counter;
+                    stack[top++] = w;
+                    on_stack[w] = true;
+                    path[depth++] = w;
+                } else if (on_stack[w] && order[w] < lowlink[v]) {
+                    lowlink[v] = order[w];
+                }
+                continue;
+            }
+
+            /* v is finished; it is the root of an SCC if nothing below it reaches higher */
+            depth--;
+            if (depth > 0 && lowlink[v] < lowlink[path[depth - 1]]) {
+                lowlink[path[depth - 1]] = lowlink[v];
+            }
+            if (lowlink[v] == order[v]) {
+                CallGraphSCC* scc = &graph->sccs[graph->num_sccs];
+                scc->first_member = filled;
+                int w;
+                do {
+                    w = stack[--top];
+                    on_stack[w] = false;
+                    graph->nodes[w].scc = graph->num_sccs;
+                    graph->members[filled++] = w;
+                } while (w != v);
+                scc->num_members = filled - scc->first_member;
+
+                /* list the members in the order they were discovered */
+                for (int i = scc->first_member, j = filled - 1; i < j; i++, j--) {
+                    int t = graph->members[i];
+                    graph->members[i] = graph->members[j];
+                    graph->members[j] = t;
+                }
+                graph->num_sccs++;
+            }
+        }
+    }
+
+    Memory_free(next_edge);
+    Memory_free(path);
+    Memory_free(stack);
+    Memory_free(on_stack);
+    Memory_free(lowlink);
+    Memory_free(order);
+}
+
+/**
+ * @brief Compute the level of every SCC and group the SCCs by level
+ */
+void callgraph_levels (CallGraph* graph)
+{
+    /* callees' SCCs always come earlier, so one pass in bottom-up order suffices */
+    graph->num_levels = 0;
+    for (int s = 0; s < graph->num_sccs; s++) {
+        CallGraphSCC* scc = &graph->sccs[s];
+        scc->level = 0;
+        scc->recursive = (scc->num_members > 1);
+        for (int m = scc->first_member; m < scc->first_member + scc->num_members; m++) {
+            FOR_EACH_CALL(call, graph, graph->members[m]) {
+                int callee = graph->nodes[call->callee].scc;
+                if (callee == s) {
+                    scc->recursive = true;
+                } else if (graph->sccs[callee].level + 1 > scc->level) {
+                    scc->level = graph->sccs[callee].level + 1;
+                }
+            }
+        }
+        if (scc->level + 1 > graph->num_levels) {
+            graph->num_levels = scc->level + 1;
+        }
+    }
+
+    /* counting sort by level (stable, so each level stays in bottom-up order) */
+    graph->level_starts = (int*)Memory_calloc(MEM_ANALYSIS, graph->num_levels + 1, sizeof(int));
+    CHECK_MALLOC_PTR(graph->level_starts)
+    graph->levels = (int*)Memory_calloc(MEM_ANALYSIS, graph->num_sccs + 1, sizeof(int));
+    CHECK_MALLOC_PTR(graph->levels)
+    for (int s = 0; s < graph->num_sccs; s++) {
+        graph->level_starts[graph->sccs[s].level + 1]++;
+    }
+    for (int l = 0; l < graph->num_levels; l++) {
+        graph->level_starts[l + 1] += graph->level_starts[l];
+    }
+    int* fill = (int*)Memory_calloc(MEM_ANALYSIS, graph->num_levels + 1, sizeof(int));
+    CHECK_MALLOC_PTR(fill)
+    memcpy(fill, graph->level_starts, (graph->num_levels + 1) * sizeof(int));
+    for (int s = 0; s < graph->num_sccs; s++) {
+        graph->levels[fill[graph->sccs[s].level]++] = s;
+    }
+    Memory_free(fill);
+}
+
+CallGraph* CallGraph_build (ASTNode* tree)
+{
+    CallGraph* graph = (CallGraph*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(CallGraph));
+    CHECK_MALLOC_PTR(graph)
+    NodeList* functions = tree->program.functions;
+    graph->nodes = (CallGraphNode*)Memory_calloc(MEM_ANALYSIS, functions->size + 1, sizeof(CallGraphNode));
+    CHECK_MALLOC_PTR(graph->nodes)
+    PointerMap_init(&graph->functions, functions->size, MEM_ANALYSIS);
+
+    /* a duplicate declaration gets a node, but calls resolve to the first one */
+    FOR_EACH(ASTNode*, func, functions) {
+        CallGraphNode* node = &graph->nodes[graph->num_nodes];
+        node->function = func;
+        node->symbol = SymbolTable_lookup(tree->scope, func->funcdecl.name);
+        if (node->symbol != NULL) {
+            PointerMap_insert(&graph->functions, node->symbol, graph->num_nodes);
+        }
+        graph->num_nodes++;
+    }
+
+    CallGraphBuilder builder;
+    builder.graph = graph;
+    builder.capacity = CALLGRAPH_INITIAL_EDGES;
+    graph->edges = (CallGraphEdge*)Memory_calloc(MEM_ANALYSIS, builder.capacity, sizeof(CallGraphEdge));
+    CHECK_MALLOC_PTR(graph->edges)
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = &builder;
+    v->previsit_funccall = callgraph_visit_funccall;
+    for (int i = 0; i < graph->num_nodes; i++) {
+        graph->nodes[i].first_edge = graph->num_edges;
+        NodeVisitor_traverse(v, graph->nodes[i].function->funcdecl.body);
+        graph->nodes[i].num_edges = graph->num_edges - graph->nodes[i].first_edge;
+    }
+    NodeVisitor_free(v);
+
+    callgraph_tarjan(graph);
+    callgraph_levels(graph);
+    return graph;
+}
+
+/*
+ * OUTPUT
+ */
+
+/**
+ * @brief Print the members of an SCC
+ */
+void callgraph_print_members (CallGraph* graph, int s, FILE* output)
+{
+    CallGraphSCC* scc = &graph->sccs[s];
+    for (int m = scc->first_member; m < scc->first_member + scc->num_members; m++) {
+        fprintf(output, " %s", graph->nodes[graph->members[m]].function->funcdecl.name);
+    }
+}
+
+void CallGraph_print (CallGraph* graph, FILE* output)
+{
+    fprintf(output, "CALL GRAPH: %d functions, %d call sites, %d SCCs, %d levels\n",
+            graph->num_nodes, graph->num_edges, graph->num_sccs, graph->num_levels);
+
+    /* each callee once, in the order of its first call, with its number of calls */
+    int* calls = (int*)Memory_calloc(MEM_ANALYSIS, graph->num_nodes + 1, sizeof(int));
+    CHECK_MALLOC_PTR(calls)
+    for (int v = 0; v < graph->num_nodes; v++) {
+        CallGraphNode* node = &graph->nodes[v];
+        fprintf(output, "  %s [line %d] calls:", node->function->funcdecl.name,
+                node->function->source_line);
+        if (node->num_edges == 0) {
+            fprintf(output, " -");
+        }
+        FOR_EACH_CALL(call, graph, v) {
+            calls[call->callee]++;
+        }
+        FOR_EACH_CALL(call, graph, v) {
+            if (calls[call->callee] > 1) {
+                fprintf(output, " %s (%d sites)", graph->nodes[call->callee].function->funcdecl.name,
+                        calls[call->callee]);
+            } else if (calls[call->callee] == 1) {
+                fprintf(output, " %s", graph->nodes[call->callee].function->funcdecl.name);
+            }
+            calls[call->callee] = 0;
+        }
+        fprintf(output, "\n");
+    }
+    Memory_free(calls);
+
+    fprintf(output, "SCCS (bottom-up):\n");
+    for (int s = 0; s < graph->num_sccs; s++) {
+        fprintf(output, "  #%d level %d%s:", s, graph->sccs[s].level,
+                graph->sccs[s].recursive ? " recursive" : "");
+        callgraph_print_members(graph, s, output);
+        fprintf(output, "\n");
+    }
+
+    fprintf(output, "LEVELS (SCCs in a level do not call each other):\n");
+    for (int l = 0; l < graph->num_levels; l++) {
+        fprintf(output, "  %d:", l);
+        for (int i = graph->level_starts[l]; i < graph->level_starts[l + 1]; i++) {
+            fprintf(output, " #%d", graph->levels[i]);
+        }
+        fprintf(output, "\n");
+    }
+}
+
+void CallGraph_free (CallGraph* graph)
+{
+    if (graph == NULL) {
+        return;
+    }
+    PointerMap_free(&graph->functions);
+    Memory_free(graph->level_starts);
+    Memory_free(graph->levels);
+    Memory_free(graph->members);
+    Memory_free(graph->sccs);
+    Memory_free(graph->edges);
+    Memory_free(graph->nodes);
+    Memory_free(graph);
+}
@@ -0,0 +1,422 @@
+#include "cfg.h"
+
+/**
+ * @brief No block (the current point is unreachable)
+ */
+#define CFG_NONE (-1)
+
+/**
+ * @brief Edges still waiting for their target block to be created
+ *
+ * Loop exits and the function exit are created after the code that jumps to
+ * them, so that every block's statements stay contiguous; until then, the
+ * blocks that jump there are kept on a stack of pending sources.
+ */
+typedef struct CFGPending
+{
+    int* sources;                   /**< @brief Blocks waiting for an edge */
+    int size;                       /**< @brief Number of entries in @c sources */
+    int capacity;                   /**< @brief Allocated length of @c sources */
+} CFGPending;
+
+/**
+ * @brief State while lowering a function body
+ */
+typedef struct CFGBuilder
+{
+    ControlFlowGraph* cfg;          /**< @brief Graph under construction */
+    CFGPending breaks;              /**< @brief Blocks that end in @c break */
+    CFGPending returns;             /**< @brief Blocks that end in @c return */
+    int loop_header;                /**< @brief Header of the innermost loop (target of @c continue) */
+} CFGBuilder;
+
+/**
+ * @brief Double an array's allocation if it is full
+ */
+void* cfg_reserve (void* array, int size, int* capacity, size_t element_size)
+{
+    if (size < *capacity) {
+        return array;
+    }
+    *capacity *= 2;
+    array = Memory_realloc(array, *capacity, element_size);
+    CHECK_MALLOC_PTR(array)
+    return array;
+}
+
+void CFGPending_push (CFGPending* pending, int block)
+{
+    pending->sources = (int*)cfg_reserve(pending->sources, pending->size, &pending->capacity, sizeof(int));
+    pending->sources[pending->size++] = block;
+}
+
+/**
+ * @brief Start a new (empty) block
+ *
+ * @returns Index of the block
+ */
+int cfg_new_block (ControlFlowGraph* cfg)
+{
+    cfg->blocks = (CFGBlock*)cfg_reserve(cfg->blocks, cfg->num_blocks, &cfg->capacity_blocks, sizeof(CFGBlock));
+    CFGBlock* block = &cfg->blocks[cfg->num_blocks];
+    block->first_item = cfg->num_items;
+    block->num_items = 0;
+    block->branch = NULL;
+    block->first_succ = block->num_succ = 0;
+    block->first_pred = block->num_pred = 0;
+    block->rpo = -1;
+    return cfg->num_blocks++;
+}
+
+void cfg_add_edge (ControlFlowGraph* cfg, int from, int to)
+{
+    cfg->edges = (CFGEdge*)cfg_reserve(cfg->edges, cfg->num_edges, &cfg->capacity_edges, sizeof(CFGEdge));
+    cfg->edges[cfg->num_edges].from = from;
+    cfg->edges[cfg->num_edges].to = to;
+    cfg->num_edges++;
+}
+
+/**
+ * @brief Connect every pending source from @p mark on to a block
+ */
+void cfg_resolve (ControlFlowGraph* cfg, CFGPending* pending, int mark, int target)
+{
+    for (int i = mark; i < pending->size; i++) {
+        cfg_add_edge(cfg, pending->sources[i], target);
+    }
+    pending->size = mark;
+}
+
+/**
+ * @brief Append a statement to a block (starting a new unreachable block if needed)
+ *
+ * @returns Block that now ends with the statement
+ */
+int cfg_append (ControlFlowGraph* cfg, int current, ASTNode* item)
+{
+    if (current == CFG_NONE) {
+        current = cfg_new_block(cfg);
+    }
+    if (current != cfg->num_blocks - 1) {
+        fprintf(stderr, "ERROR: control-flow block %d is no longer open\n", current);
+        exit(EXIT_FAILURE);
+    }
+    cfg->items = (ASTNode**)cfg_reserve(cfg->items, cfg->num_items, &cfg->capacity_items, sizeof(ASTNode*));
+    cfg->items[cfg->num_items++] = item;
+    cfg->blocks[current].num_items++;
+    return current;
+}
+
+/**
+ * @brief End a block with a two-way branch
+ *
+ * @returns Block that tests the condition
+ */
+int cfg_branch (ControlFlowGraph* cfg, int current, ASTNode* condition)
+{
+    if (current == CFG_NONE) {
+        current = cfg_new_block(cfg);
+    }
+    cfg->blocks[current].branch = condition;
+    return current;
+}
+
+/**
+ * @brief Check whether a branch condition can evaluate to an outcome
+ *
+ * Only a literal condition rules an outcome out; the edge for an outcome that
+ * cannot happen is left out so that nothing flows along it.
+ */
+bool cfg_can_take (ASTNode* condition, bool outcome)
+{
+    return condition->type != LITERAL || condition->literal.type != BOOL ||
+           condition->literal.boolean == outcome;
+}
+
+/**
+ * @brief Lower a statement
+ *
+ * @param builder Builder state
+ * @param node Statement to lower
+ * @param current Block that control reaches the statement in (@ref CFG_NONE
+ * if it cannot be reached)
+ * @returns Block that control leaves the statement in (@ref CFG_NONE if it
+ * never falls through)
+ */
+int cfg_lower (CFGBuilder* builder, ASTNode* node, int current)
+{
+    ControlFlowGraph* cfg = builder->cfg;
+    switch (node->type) {
+        case BLOCK:
+            FOR_EACH(ASTNode*, var, node->block.variables) {
+                current = cfg_append(cfg, current, var);
+            }
+            FOR_EACH(ASTNode*, stmt, node->block.statements) {
+                current = cfg_lower(builder, stmt, current);
+            }
+            return current;
+
+        case CONDITIONAL: {
+            ASTNode* condition = node->conditional.condition;
+            int test = cfg_branch(cfg, current, condition);
+            int then_block = cfg_new_block(cfg);
+            if (cfg_can_take(condition, true)) {
+                cfg_add_edge(cfg, test, then_block);
+            }
+            int then_end = cfg_lower(builder, node->conditional.if_block, then_block);
+            int else_end = (cfg_can_take(condition, false) ? test : CFG_NONE);
+            if (node->conditional.else_block != NULL) {
+                int else_block = cfg_new_block(cfg);
+                if (cfg_can_take(condition, false)) {
+                    cfg_add_edge(cfg, test, else_block);
+                }
+                else_end = cfg_lower(builder, node->conditional.else_block, else_block);
+            }
+            if (then_end == CFG_NONE && else_end == CFG_NONE) {
+                return CFG_NONE;
+            }
+            int join = cfg_new_block(cfg);
+            if (then_end != CFG_NONE) {
+                cfg_add_edge(cfg, then_end, join);
+            }
+            if (else_end != CFG_NONE) {
+                cfg_add_edge(cfg, else_end, join);
+            }
+            return join;
+        }
+
+        case WHILELOOP: {
+            int header = cfg_new_block(cfg);
+            if (current != CFG_NONE) {
+                cfg_add_edge(cfg, current, header);
+            }
+            ASTNode* condition = node->whileloop.condition;
+            cfg_branch(cfg, header, condition);
+            int body = cfg_new_block(cfg);
+            if (cfg_can_take(condition, true)) {
+                cfg_add_edge(cfg, header, body);
+            }
+
+            int outer_header = builder->loop_header;
+            int break_mark = builder->breaks.size;
+            builder->loop_header = header;
+            int body_end = cfg_lower(builder, node->whileloop.body, body);
+            if (body_end != CFG_NONE) {
+                cfg_add_edge(cfg, body_end, header);
+            }
+            builder->loop_header = outer_header;
+
+            int after = cfg_new_block(cfg);
+            if (cfg_can_take(condition, false)) {
+                cfg_add_edge(cfg, header, after);
+            }
+            cfg_resolve(cfg, &builder->breaks, break_mark, after);
+            return after;
+        }
+
+        case RETURNSTMT:
+            current = cfg_append(cfg, current, node);
+            CFGPending_push(&builder->returns, current);
+            return CFG_NONE;
+
+        case BREAKSTMT:
+            current = cfg_append(cfg, current, node);
+            CFGPending_push(&builder->breaks, current);
+            return CFG_NONE;
+
+        case CONTINUESTMT:
+            current = cfg_append(cfg, current, node);
+            cfg_add_edge(cfg, current, builder->loop_header);
+            return CFG_NONE;
+
+        default:
+            return cfg_append(cfg, current, node);
+    }
+}
+
+/**
+ * @brief Fill in the predecessor and successor lists from the edge list
+ *
+ * A counting sort by block keeps each block's edges in the order they were
+ * added, so a branch's true successor comes before its false successor.
+ */
+void cfg_link (ControlFlowGraph* cfg)
+{
+    cfg->successors = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_edges + 1, sizeof(int));
+    CHECK_MALLOC_PTR(cfg->successors)
+    cfg->predecessors = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_edges + 1, sizeof(int));
+    CHECK_MALLOC_PTR(cfg->predecessors)
+    for (int e = 0; e < cfg->num_edges; e++) {
+        cfg->blocks[cfg->edges[e].from].num_succ++;
+        cfg->blocks[cfg->edges[e].to].num_pred++;
+    }
+    int succ = 0, pred = 0;
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        cfg->blocks[b].first_succ = succ;
+        cfg->blocks[b].first_pred = pred;
+        succ += cfg->blocks[b].num_succ;
+        pred += cfg->blocks[b].num_pred;
+        cfg->blocks[b].num_succ = cfg->blocks[b].num_pred = 0;
+    }
+    for (int e = 0; e < cfg->num_edges; e++) {
+        CFGBlock* from = &cfg->blocks[cfg->edges[e].from];
+        CFGBlock* to = &cfg->blocks[cfg->edges[e].to];
+        cfg->successors[from->first_succ + from->num_succ++] = cfg->edges[e].to;
+        cfg->predecessors[to->first_pred + to->num_pred++] = cfg->edges[e].from;
+    }
+}
+
+/**
+ * @brief Number the blocks reachable from the entry in reverse postorder
+ *
+ * Uses an explicit stack, so deeply nested code cannot overflow the C stack.
+ */
+void cfg_number (ControlFlowGraph* cfg)
+{
+    cfg->rpo = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_blocks, sizeof(int));
+    CHECK_MALLOC_PTR(cfg->rpo)
+    int* stack = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_blocks, sizeof(int));
+    CHECK_MALLOC_PTR(stack)
+    int* next_succ = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_blocks, sizeof(int));
+    CHECK_MALLOC_PTR(next_succ)
+    bool* visited = (bool*)Memory_calloc(MEM_ANALYSIS, cfg->num_blocks, sizeof(bool));
+    CHECK_MALLOC_PTR(visited)
+
+    /* postorder fills rpo from the back */
+    int depth = 0, position = cfg->num_blocks;
+    stack[depth++] = 0;
+    visited[0] = true;
+    while (depth > 0) {
+        int b = stack[depth - 1];
+        CFGBlock* block = &cfg->blocks[b];
+        if (next_succ[b] < block->num_succ) {
+            int s = cfg->successors[block->first_succ + next_succ[b]++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack[depth++] = s;
+            }
+        } else {
+            cfg->rpo[--position] = b;
+            depth--;
+        }
+    }
+
+    /* slide the reachable blocks to the front */
+    cfg->num_reachable = cfg->num_blocks - position;
+    memmove(cfg->rpo, cfg->rpo + position, cfg->num_reachable * sizeof(int));
+    for (int i = 0; i < cfg->num_reachable; i++) {
+        cfg->blocks[cfg->rpo[i]].rpo = i;
+    }
+    Memory_free(visited);
+    Memory_free(next_succ);
+    Memory_free(stack);
+}
+
+ControlFlowGraph* ControlFlowGraph_build (ASTNode* function)
+{
+    ControlFlowGraph* cfg = (ControlFlowGraph*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ControlFlowGraph));
+    CHECK_MALLOC_PTR(cfg)
+    cfg->function = function;
+    cfg->capacity_blocks = 16;
+    cfg->blocks = (CFGBlock*)Memory_calloc(MEM_ANALYSIS, cfg->capacity_blocks, sizeof(CFGBlock));
+    CHECK_MALLOC_PTR(cfg->blocks)
+    cfg->capacity_items = 32;
+    cfg->items = (ASTNode**)Memory_calloc(MEM_ANALYSIS, cfg->capacity_items, sizeof(ASTNode*));
+    CHECK_MALLOC_PTR(cfg->items)
+    cfg->capacity_edges = 16;
+    cfg->edges = (CFGEdge*)Memory_calloc(MEM_ANALYSIS, cfg->capacity_edges, sizeof(CFGEdge));
+    CHECK_MALLOC_PTR(cfg->edges)
+
+    CFGBuilder builder;
+    builder.cfg = cfg;
+    builder.loop_header = CFG_NONE;
+    builder.breaks.capacity = builder.returns.capacity = 8;
+    builder.breaks.size = builder.returns.size = 0;
+    builder.breaks.sources = (int*)Memory_calloc(MEM_ANALYSIS, builder.breaks.capacity, sizeof(int));
+    CHECK_MALLOC_PTR(builder.breaks.sources)
+    builder.returns.sources = (int*)Memory_calloc(MEM_ANALYSIS, builder.returns.capacity, sizeof(int));
+    CHECK_MALLOC_PTR(builder.returns.sources)
+
+    int entry = cfg_new_block(cfg);
+    int end = cfg_lower(&builder, function->funcdecl.body, entry);
+    int exit_block = cfg_new_block(cfg);
+    if (end != CFG_NONE) {
+        cfg_add_edge(cfg, end, exit_block);
+    }
+    cfg_resolve(cfg, &builder.returns, 0, exit_block);
+    Memory_free(builder.breaks.sources);
+    Memory_free(builder.returns.sources);
+
+    cfg_link(cfg);
+    cfg_number(cfg);
+    return cfg;
+}
+
+/**
+ * @brief Print a list of block indices (or "-" if it is empty)
+ */
+void cfg_print_blocks (const int* blocks, int count, FILE* output)
+{
+    if (count == 0) {
+        fprintf(output, " -");
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(output, " B%d", blocks[i]);
+    }
+}
+
+void ControlFlowGraph_print (ControlFlowGraph* cfg, FILE* output)
+{
+    fprintf(output, "CFG for %s: %d blocks (%d reachable), %d edges\n", cfg->function->funcdecl.name,
+            cfg->num_blocks, cfg->num_reachable, cfg->num_edges);
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        CFGBlock* block = &cfg->blocks[b];
+        fprintf(output, "  B%d", b);
+        if (block->rpo >= 0) {
+            fprintf(output, " [rpo %d]", block->rpo);
+        } else {
+            fprintf(output, " [unreachable]");
+        }
+        if (b == 0) {
+            fprintf(output, " entry");
+        } else if (b == CFG_EXIT(cfg)) {
+            fprintf(output, " exit");
+        }
+        fprintf(output, ": %d statements", block->num_items);
+        if (block->num_items > 0) {
+            fprintf(output, " (lines %d-%d)", cfg->items[block->first_item]->source_line,
+                    cfg->items[block->first_item + block->num_items - 1]->source_line);
+        }
+        if (block->branch != NULL) {
+            fprintf(output, ", branch on line %d", block->branch->source_line);
+        }
+        fprintf(output, "\n    preds:");
+        cfg_print_blocks(cfg->predecessors + block->first_pred, block->num_pred, output);
+        fprintf(output, "\n    succs:");
+        cfg_print_blocks(cfg->successors + block->first_succ, block->num_succ, output);
+        fprintf(output, "\n");
+    }
+}
+
+void ControlFlowGraph_print_program (ASTNode* tree, FILE* output)
+{
+    FOR_EACH(ASTNode*, func, tree->program.functions) {
+        ControlFlowGraph* cfg = ControlFlowGraph_build(func);
+        ControlFlowGraph_print(cfg, output);
+        ControlFlowGraph_free(cfg);
+    }
+}
+
+void ControlFlowGraph_free (ControlFlowGraph* cfg)
+{
+    if (cfg == NULL) {
+        return;
+    }
+    Memory_free(cfg->rpo);
+    Memory_free(cfg->predecessors);
+    Memory_free(cfg->successors);
+    Memory_free(cfg->edges);
+    Memory_free(cfg->items);
+    Memory_free(cfg->blocks);
+    Memory_free(cfg);
+}
@@ -1,5 +1,7 @@
 #include "common.h"
 
+#include <stdatomic.h>
+
 const char* DecafType_to_string(DecafType type)
 {
     switch (type) {
@@ -25,3 +27,389 @@ void print_escaped_string(const char* string, FILE* output)
         }
     }
 }
+
+uint64_t hash_string(const char* string)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;      /* FNV-1a offset basis */
+    for (const unsigned char* p = (const unsigned char*)string; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;               /* FNV-1a prime */
+    }
+    return hash;
+}
+
+uint64_t hash_bytes(const void* data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;      /* FNV-1a offset basis */
+    for (size_t i = 0; i < size; i++) {
+        hash ^= ((const unsigned char*)data)[i];
+        hash *= 0x100000001b3ULL;               /* FNV-1a prime */
+    }
+    return hash;
+}
+
+uint64_t hash_combine(uint64_t hash, uint64_t value)
+{
+    /* boost-style mixing, widened to 64 bits */
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+/*
+ * pointer maps
+ */
+
+/**
+ * @brief Initial number of slots in a pointer map
+ */
+#define POINTER_MAP_INITIAL_CAPACITY 16
+
+/**
+ * @brief Find the slot of a key (or the empty slot that ends its probe)
+ */
+static int PointerMap_slot (const PointerMap* map, const void* key)
+{
+    int mask = map->capacity - 1;
+    int slot = (int)(hash_bytes(&key, sizeof(key)) & (uint64_t)mask);
+    while (map->keys[slot] != NULL && map->keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Allocate the slot arrays for the current capacity
+ */
+static void PointerMap_alloc_slots (PointerMap* map)
+{
+    map->keys = (const void**)Memory_calloc(map->category, map->capacity, sizeof(void*));
+    CHECK_MALLOC_PTR(map->keys)
+    map->values = (int*)Memory_calloc(map->category, map->capacity, sizeof(int));
+    CHECK_MALLOC_PTR(map->values)
+}
+
+void PointerMap_init (PointerMap* map, int expected, MemoryCategory category)
+{
+    map->capacity = POINTER_MAP_INITIAL_CAPACITY;
+    while (map->capacity < 2 * expected) {
+        map->capacity *= 2;
+    }
+    map->size = 0;
+    map->category = category;
+    PointerMap_alloc_slots(map);
+}
+
+int PointerMap_find (const PointerMap* map, const void* key)
+{
+    int slot = PointerMap_slot(map, key);
+    return (map->keys[slot] == NULL ? -1 : map->values[slot]);
+}
+
+int PointerMap_insert (PointerMap* map, const void* key, int value)
+{
+    int slot = PointerMap_slot(map, key);
+    if (map->keys[slot] != NULL) {
+        return map->values[slot];
+    }
+
+    /* keep the load factor at or below 1/2 */
+    if (2 * (map->size + 1) > map->capacity) {
+        const void** old_keys = map->keys;
+        int* old_values = map->values;
+        int old_capacity = map->capacity;
+        map->capacity *= 2;
+        PointerMap_alloc_slots(map);
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_keys[i] != NULL) {
+                int moved = PointerMap_slot(map, old_keys[i]);
+                map->keys[moved] = old_keys[i];
+                map->values[moved] = old_values[i];
+            }
+        }
+        Memory_free(old_keys);
+        Memory_free(old_values);
+        slot = PointerMap_slot(map, key);
+    }
+    map->keys[slot] = key;
+    map->values[slot] = value;
+    map->size++;
+    return value;
+}
+
+void PointerMap_free (PointerMap* map)
+{
+    Memory_free(map->keys);
+    Memory_free(map->values);
+    map->keys = NULL;
+    map->values = NULL;
+    map->capacity = map->size = 0;
+}
+
+/*
+ * memory accounting
+ */
+
+/**
+ * @brief Bookkeeping stored in front of every accounted allocation
+ *
+ * The union with @c max_align_t keeps the user's memory suitably aligned.
+ */
+typedef union MemoryHeader {
+    struct {
+        size_t size;                /**< @brief Requested size in bytes */
+        MemoryCategory category;    /**< @brief Accounting category */
+        int capture_slot;           /**< @brief Index in the thread's capture (or -1) */
+        MemoryAccount* account;     /**< @brief Account the block is charged to */
+    } info;                         /**< @brief Allocation info */
+    max_align_t align;              /**< @brief Forces maximal alignment */
+} MemoryHeader;
+
+/**
+ * @brief Usage counters for a single memory category
+ *
+ * The counters are atomic so that worker threads (see threadpool.h) can
+ * allocate concurrently; the peaks are raised with compare-and-swap.
+ */
+typedef struct MemoryStats {
+    atomic_size_t live_bytes;       /**< @brief Bytes currently allocated */
+    atomic_size_t live_objects;     /**< @brief Objects currently allocated */
+    atomic_size_t peak_bytes;       /**< @brief Maximum value of @c live_bytes */
+    atomic_size_t peak_objects;     /**< @brief Maximum value of @c live_objects */
+    atomic_size_t total_objects;    /**< @brief Objects allocated over the whole run */
+} MemoryStats;
+
+struct MemoryAccount {
+    MemoryStats stats[MEM_NUM_CATEGORIES];  /**< @brief Per-category counters */
+    atomic_size_t live_bytes;               /**< @brief Bytes currently allocated (all categories) */
+    atomic_size_t peak_bytes;               /**< @brief Maximum value of @c live_bytes */
+    atomic_size_t references;               /**< @brief Live blocks, plus one until the owner frees it */
+};
+
+/**
+ * @brief Account used by threads that have not chosen one (never freed)
+ */
+static MemoryAccount process_account = { .references = 1 };
+
+/**
+ * @brief Account that the calling thread charges (@c NULL for the process-wide one)
+ */
+static _Thread_local MemoryAccount* current_account = NULL;
+
+MemoryAccount* MemoryAccount_new ()
+{
+    /* accounts are bookkeeping for the allocator, so they are not accounted */
+    MemoryAccount* account = (MemoryAccount*)calloc(1, sizeof(MemoryAccount));
+    CHECK_MALLOC_PTR(account)
+    atomic_init(&account->references, 1);
+    return account;
+}
+
+/**
+ * @brief Drop one reference to an account and deallocate it if it was the last
+ */
+static void MemoryAccount_release (MemoryAccount* account)
+{
+    if (atomic_fetch_sub_explicit(&account->references, 1, memory_order_acq_rel) == 1) {
+        free(account);
+    }
+}
+
+void MemoryAccount_free (MemoryAccount* account)
+{
+    if (account != NULL) {
+        MemoryAccount_release(account);
+    }
+}
+
+MemoryAccount* Memory_set_account (MemoryAccount* account)
+{
+    MemoryAccount* previous = current_account;
+    current_account = account;
+    return previous;
+}
+
+/**
+ * @brief Blocks allocated by one thread since @ref Memory_begin_capture
+ */
+typedef struct MemoryCapture {
+    bool active;                    /**< @brief True between begin and end */
+    void** blocks;                  /**< @brief Captured blocks (@c NULL once freed) */
+    int size;                       /**< @brief Number of captured blocks */
+    int capacity;                   /**< @brief Allocated length of @c blocks */
+} MemoryCapture;
+
+static _Thread_local MemoryCapture capture = { false, NULL, 0, 0 };
+
+/**
+ * @brief Raise a peak counter to at least @p value
+ */
+static void Memory_raise_peak (atomic_size_t* peak, size_t value)
+{
+    size_t current = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > current &&
+            !atomic_compare_exchange_weak_explicit(peak, &current, value,
+                memory_order_relaxed, memory_order_relaxed)) {
+        /* current was reloaded; retry */
+    }
+}
+
+static const char* MemoryCategory_to_string (MemoryCategory category)
+{
+    switch (category) {
+        case MEM_TOKEN:     return "tokens";
+        case MEM_AST:       return "ast nodes";
+        case MEM_ATTRIBUTE: return "attributes";
+        case MEM_SYMBOL:    return "symbols";
+        case MEM_PARAMETER: return "parameters";
+        case MEM_ERROR:     return "errors";
+        case MEM_ANALYSIS:  return "analysis";
+        default:            return "???";
+    }
+}
+
+/**
+ * @brief Allocate a block charged to a specific account
+ */
+static void* Memory_calloc_in (MemoryAccount* account, MemoryCategory category, size_t count, size_t size)
+{
+    if (size != 0 && count > (SIZE_MAX - sizeof(MemoryHeader)) / size) {
+        return NULL;
+    }
+    size_t bytes = count * size;
+    MemoryHeader* header = (MemoryHeader*)calloc(1, sizeof(MemoryHeader) + bytes);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->info.size = bytes;
+    header->info.category = category;
+    header->info.capture_slot = -1;
+    header->info.account = account;
+    if (capture.active) {
+        if (capture.size == capture.capacity) {
+            /* the capture is allocator bookkeeping, so it is not accounted */
+            capture.capacity = (capture.capacity == 0 ? 256 : capture.capacity * 2);
+            capture.blocks = (void**)realloc(capture.blocks, capture.capacity * sizeof(void*));
+            CHECK_MALLOC_PTR(capture.blocks)
+        }
+        header->info.capture_slot = capture.size;
+        capture.blocks[capture.size++] = header + 1;
+    }
+
+    MemoryStats* stats = &account->stats[category];
+    Memory_raise_peak(&stats->peak_bytes,
+            atomic_fetch_add_explicit(&stats->live_bytes, bytes, memory_order_relaxed) + bytes);
+    Memory_raise_peak(&stats->peak_objects,
+            atomic_fetch_add_explicit(&stats->live_objects, 1, memory_order_relaxed) + 1);
+    atomic_fetch_add_explicit(&stats->total_objects, 1, memory_order_relaxed);
+    Memory_raise_peak(&account->peak_bytes,
+            atomic_fetch_add_explicit(&account->live_bytes, bytes, memory_order_relaxed) + bytes);
+    atomic_fetch_add_explicit(&account->references, 1, memory_order_relaxed);
+    return header + 1;
+}
+
+void* Memory_calloc (MemoryCategory category, size_t count, size_t size)
+{
+    return Memory_calloc_in(current_account != NULL ? current_account : &process_account,
+            category, count, size);
+}
+
+void* Memory_realloc (void* ptr, size_t count, size_t size)
+{
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    void* resized = Memory_calloc_in(header->info.account, header->info.category, count, size);
+    if (resized == NULL) {
+        return NULL;
+    }
+    size_t bytes = count * size;
+    memcpy(resized, ptr, header->info.size < bytes ? header->info.size : bytes);
+    Memory_free(ptr);
+    return resized;
+}
+
+void Memory_free (void* ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    if (header->info.capture_slot >= 0) {
+        capture.blocks[header->info.capture_slot] = NULL;
+    }
+    MemoryAccount* account = header->info.account;
+    MemoryStats* stats = &account->stats[header->info.category];
+    atomic_fetch_sub_explicit(&stats->live_bytes, header->info.size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&stats->live_objects, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&account->live_bytes, header->info.size, memory_order_relaxed);
+    free(header);
+    MemoryAccount_release(account);
+}
+
+void Memory_begin_capture ()
+{
+    capture.active = true;
+    capture.size = 0;
+}
+
+void Memory_end_capture (bool release)
+{
+    capture.active = false;
+    for (int i = 0; i < capture.size; i++) {
+        if (capture.blocks[i] == NULL) {
+            continue;
+        }
+        MemoryHeader* header = (MemoryHeader*)capture.blocks[i] - 1;
+        header->info.capture_slot = -1;
+        if (release) {
+            Memory_free(capture.blocks[i]);
+        }
+    }
+    free(capture.blocks);
+    capture.blocks = NULL;
+    capture.size = 0;
+    capture.capacity = 0;
+}
+
+void Memory_print_report (const char* phase, FILE* output)
+{
+    MemoryAccount* account = (current_account != NULL ? current_account : &process_account);
+    fprintf(output, "MEMORY after %s:\n", phase);
+    fprintf(output, "  %-12s %12s %10s %12s %10s %10s\n",
+            "category", "live bytes", "live objs", "peak bytes", "peak objs", "total objs");
+    size_t live_objects = 0, total_objects = 0;
+    for (int c = 0; c < MEM_NUM_CATEGORIES; c++) {
+        MemoryStats* stats = &account->stats[c];
+        fprintf(output, "  %-12s %12zu %10zu %12zu %10zu %10zu\n",
+                MemoryCategory_to_string((MemoryCategory)c),
+                (size_t)stats->live_bytes, (size_t)stats->live_objects,
+                (size_t)stats->peak_bytes, (size_t)stats->peak_objects, (size_t)stats->total_objects);
+        live_objects += stats->live_objects;
+        total_objects += stats->total_objects;
+    }
+    fprintf(output, "  %-12s %12zu %10zu %12zu %10s %10zu\n",
+            "total", (size_t)account->live_bytes, live_objects, (size_t)account->peak_bytes, "", total_objects);
+}
+
+ReadStatus read_file (const char* filename, char* text)
+{
+    FILE* input = fopen(filename, "r");
+    if (input == NULL) {
+        return READ_FAILED;
+    }
+    size_t nchars = 0;
+    char* p = text;
+    int c;
+    while (nchars < MAX_FILE_SIZE && (c = fgetc(input)) != EOF) {
+        *p++ = (char)c;
+        nchars++;
+    }
+    *p = '\0';
+
+    /* anything left over means the text above is only a prefix */
+    ReadStatus status = READ_OK;
+    if (ferror(input)) {
+        status = READ_FAILED;
+    } else if (nchars == MAX_FILE_SIZE && fgetc(input) != EOF) {
+        status = READ_TOO_LARGE;
+    }
+    fclose(input);
+    return status;
+}
@@ -0,0 +1,159 @@
+#include "p1-lexer.h"
+#include "p2-parser.h"
+#include "compile.h"
+#include "allocate.h"
+#include "fold.h"
+#include "dce.h"
+#include "cfg.h"
+#include "callgraph.h"
+#include "dataflow.h"
+#include "xref.h"
+
+DecafStatus compile_source (char* text, const CompileOptions* options,
+                            FILE* output, FILE* diagnostics, FILE* graph)
+{
+    /* all per-compilation state (error handling, memory accounting) */
+    DecafContext* context = DecafContext_new();
+    DecafContext* previous = DecafContext_set_current(context);
+    context->max_errors = options->max_errors;
+
+    /* FRONT END */
+
+    TokenQueue* tokens = NULL;
+    ASTNode* tree = NULL;
+
+    /* fatal errors are possible in the front end, so check for them (they
+     * abandon whatever the lexer or parser had built so far; the capture
+     * reclaims it) */
+    Memory_begin_capture();
+    DecafContext_arm(context);
+    if (setjmp(context->error_jump) == 0) {
+
+        /* PROJECT 1: lexer */
+        tokens = lex(text);
+        if (options->mem_report) {
+            Memory_print_report("lexing", diagnostics);
+        }
+
+        /* PROJECT 2: parser */
+        tree = parse(tokens);
+        if (options->mem_report) {
+            Memory_print_report("parsing", diagnostics);
+        }
+
+    } else {
+
+        /* handle fatal error: print message and clean up */
+        DecafContext_disarm(context);
+        Memory_end_capture(true);
+        fprintf(diagnostics, "%s", context->error_msg);
+        DecafContext_set_current(previous);
+        DecafContext_free(context);
+        return DECAF_SYNTAX_ERROR;
+    }
+
+    DecafContext_disarm(context);
+    Memory_end_capture(false);
+
+    /* clean up tokens (no longer needed) */
+    TokenQueue_free(tokens);
+    tokens = NULL;
+
+    /* set up parent links and calculate node depths */
+    NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
+    NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
+
+    /* MIDDLE END */
+
+    /* build symbol tables */
+    NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
+    if (options->mem_report) {
+        Memory_print_report("symbol tables", diagnostics);
+    }
+
+    /* optional: hash-cons expressions so the analysis can memoize their types */
+    HashConsTable* hashcons = NULL;
+    if (options->hash_cons) {
+        hashcons = HashConsTable_new();
+        NodeVisitor_traverse_and_free(HashConsVisitor_new(hashcons), tree);
+    }
+
+    /* PROJECT 3: analysis */
+    ErrorList* errors = analyze_parallel(tree, options->threads);
+    if (options->mem_report) {
+        Memory_print_report("analysis", diagnostics);
+    }
+    if (hashcons != NULL) {
+        HashConsTable_print_stats(hashcons, diagnostics);
+    }
+
+    /* optional: fold constants (only valid for programs that passed analysis) */
+    if (options->fold && ErrorList_size(errors) == 0) {
+        FoldStats stats = fold_constants(tree, errors);
+        FoldStats_print(&stats, diagnostics);
+    }
+
+    /* optional: remove dead code (only valid for programs that passed analysis) */
+    if (options->dce && ErrorList_size(errors) == 0) {
+        DeadCodeStats stats = eliminate_dead_code(tree);
+        DeadCodeStats_print(&stats, diagnostics);
+    }
+
+    /* optional: flag reads of locals that may not have been assigned */
+    if (options->check_init && ErrorList_size(errors) == 0) {
+        DefiniteAssignment_check_program(tree, errors);
+    }
+
+    /* output */
+    ErrorList_print(errors, output);
+    DecafStatus status = (ErrorList_size(errors) == 0 ? DECAF_OK : DECAF_ANALYSIS_ERRORS);
+
+    /* optional: lay out storage (only valid for programs that passed analysis) */
+    if (options->allocate && status == DECAF_OK) {
+        NodeVisitor_traverse_and_free(AllocateSymbolsVisitor_new(), tree);
+    }
+
+    /* print symbol tables if there are no errors */
+    if (status == DECAF_OK) {
+        NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new(output), tree);
+    }
+
+    /* optional: cross-reference dump */
+    if (options->xref) {
+        XrefIndex* index = XrefIndex_build(tree);
+        XrefIndex_print(index, output);
+        XrefIndex_free(index);
+    }
+
+    /* optional: call graph and bottom-up order */
+    if (options->callgraph) {
+        CallGraph* callgraph = CallGraph_build(tree);
+        CallGraph_print(callgraph, output);
+        CallGraph_free(callgraph);
+    }
+
+    /* optional: control-flow graphs (only valid for programs that passed analysis) */
+    if (options->cfg && status == DECAF_OK) {
+        ControlFlowGraph_print_program(tree, output);
+    }
+
+    /* optional: graphical AST */
+    if (graph != NULL) {
+        NodeVisitor_traverse_and_free(GenerateASTGraph_new(graph), tree);
+    }
+
+    /* clean up */
+    if (hashcons != NULL) {
+        HashConsTable_free(hashcons);
+    }
+    ASTNode_free(tree);
+    ErrorList_free(errors);
+    errors = NULL;
+    if (options->mem_report) {
+        Memory_print_report("cleanup", diagnostics);
+    }
+    DecafContext_set_current(previous);
+    DecafContext_free(context);
+
+    return status;
+}
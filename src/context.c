@@ -0,0 +1,73 @@
+#include "context.h"
+
+/**
+ * @brief Context used by threads that have not set one
+ */
+static _Thread_local DecafContext default_context;
+
+/**
+ * @brief Calling thread's current context (@c NULL for @c default_context)
+ */
+static _Thread_local DecafContext* current_context = NULL;
+
+DecafContext* DecafContext_new ()
+{
+    DecafContext* context = (DecafContext*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(DecafContext));
+    CHECK_MALLOC_PTR(context)
+    context->armed = false;
+    context->error_msg[0] = '\0';
+    context->memory = MemoryAccount_new();
+    context->next_dot_id = 0;
+    context->max_errors = 0;
+    return context;
+}
+
+void DecafContext_free (DecafContext* context)
+{
+    MemoryAccount_free(context->memory);
+    Memory_free(context);
+}
+
+DecafContext* DecafContext_set_current (DecafContext* context)
+{
+    DecafContext* previous = current_context;
+    current_context = context;
+    Memory_set_account(context != NULL ? context->memory : NULL);
+    return previous;
+}
+
+DecafContext* DecafContext_current ()
+{
+    return (current_context != NULL ? current_context : &default_context);
+}
+
+void DecafContext_arm (DecafContext* context)
+{
+    context->armed_thread = thrd_current();
+    context->armed = true;
+}
+
+void DecafContext_disarm (DecafContext* context)
+{
+    context->armed = false;
+}
+
+void Error_throw_printf (const char* format, ...)
+{
+    DecafContext* context = DecafContext_current();
+
+    /* delegate to vsnprintf for error message formatting */
+    va_list args;
+    va_start(args, format);
+    vsnprintf(context->error_msg, MAX_ERROR_LEN, format, args);
+    va_end(args);
+
+    /* a jmp_buf is only valid on the thread that saved it */
+    if (!context->armed || !thrd_equal(context->armed_thread, thrd_current())) {
+        fprintf(stderr, "%s", context->error_msg);
+        exit(EXIT_FAILURE);
+    }
+
+    /* jump to location saved by setjmp */
+    longjmp(context->error_jump, 1);
+}
@@ -0,0 +1,548 @@
+#include "dataflow.h"
+#include "context.h"
+
+/*
+ * BIT VECTORS
+ */
+
+bool BitSet_test (const uint64_t* set, int bit)
+{
+    return (set[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1;
+}
+
+void BitSet_set (uint64_t* set, int bit)
+{
+    set[bit / BITSET_WORD_BITS] |= (uint64_t)1 << (bit % BITSET_WORD_BITS);
+}
+
+void BitSet_clear (uint64_t* set, int bit)
+{
+    set[bit / BITSET_WORD_BITS] &= ~((uint64_t)1 << (bit % BITSET_WORD_BITS));
+}
+
+void BitSet_union (uint64_t* set, const uint64_t* other, int words)
+{
+    for (int i = 0; i < words; i++) {
+        set[i] |= other[i];
+    }
+}
+
+void BitSet_intersect (uint64_t* set, const uint64_t* other, int words)
+{
+    for (int i = 0; i < words; i++) {
+        set[i] &= other[i];
+    }
+}
+
+void BitSet_difference (uint64_t* set, const uint64_t* other, int words)
+{
+    for (int i = 0; i < words; i++) {
+        set[i] &= ~other[i];
+    }
+}
+
+/**
+ * @brief Find the lowest set bit at or after a position
+ *
+ * @returns Index of the bit, or -1 if there is none
+ */
+int BitSet_next (const uint64_t* set, int words, int from)
+{
+    for (int i = from / BITSET_WORD_BITS; i < words; i++) {
+        uint64_t word = set[i];
+        if (i == from / BITSET_WORD_BITS) {
+            word &= ~(uint64_t)0 << (from % BITSET_WORD_BITS);
+        }
+        if (word != 0) {
+            int bit = 0;
+            while (!(word & 1)) {
+                word >>= 1;
+                bit++;
+            }
+            return i * BITSET_WORD_BITS + bit;
+        }
+    }
+    return -1;
+}
+
+/*
+ * SOLVER
+ */
+
+DataflowAnalysis* DataflowAnalysis_new (ControlFlowGraph* cfg, int num_bits,
+                                        DataflowDirection direction, DataflowMeet meet)
+{
+    DataflowAnalysis* analysis = (DataflowAnalysis*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(DataflowAnalysis));
+    CHECK_MALLOC_PTR(analysis)
+    analysis->cfg = cfg;
+    analysis->direction = direction;
+    analysis->meet = meet;
+    analysis->num_bits = num_bits;
+    analysis->words = BITSET_WORDS(num_bits);
+
+    /* one allocation holds gen, kill, in, and out for every block, plus the boundary */
+    size_t per_array = (size_t)cfg->num_blocks * analysis->words;
+    analysis->gen = (uint64_t*)Memory_calloc(MEM_ANALYSIS, 4 * per_array + analysis->words + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(analysis->gen)
+    analysis->kill = analysis->gen + per_array;
+    analysis->in = analysis->kill + per_array;
+    analysis->out = analysis->in + per_array;
+    analysis->boundary = analysis->out + per_array;
+    analysis->visits = 0;
+    return analysis;
+}
+
+uint64_t* DataflowAnalysis_set (DataflowAnalysis* analysis, uint64_t* sets, int block)
+{
+    return sets + (size_t)block * analysis->words;
+}
+
+void DataflowAnalysis_solve (DataflowAnalysis* analysis)
+{
+    ControlFlowGraph* cfg = analysis->cfg;
+    int words = analysis->words;
+    bool forward = (analysis->direction == DATAFLOW_FORWARD);
+    int n = cfg->num_reachable;
+
+    /* a must analysis starts from "everything" (except past the last fact) */
+    uint64_t* top = (uint64_t*)Memory_calloc(MEM_ANALYSIS, words + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(top)
+    if (analysis->meet == DATAFLOW_INTERSECTION) {
+        for (int bit = 0; bit < analysis->num_bits; bit++) {
+            BitSet_set(top, bit);
+        }
+    }
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        memcpy(DataflowAnalysis_set(analysis, analysis->in, b), top, words * sizeof(uint64_t));
+        memcpy(DataflowAnalysis_set(analysis, analysis->out, b), top, words * sizeof(uint64_t));
+    }
+
+    /* worklist of positions in (reverse) postorder, visited in ascending order */
+    int pending_words = BITSET_WORDS(n);
+    uint64_t* pending = (uint64_t*)Memory_calloc(MEM_ANALYSIS, pending_words + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(pending)
+    int* position = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_blocks, sizeof(int));
+    CHECK_MALLOC_PTR(position)
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        int rpo = cfg->blocks[b].rpo;
+        position[b] = (rpo < 0 ? -1 : forward ? rpo : n - 1 - rpo);
+    }
+    for (int p = 0; p < n; p++) {
+        BitSet_set(pending, p);
+    }
+
+    int cursor = 0;
+    uint64_t* result = (uint64_t*)Memory_calloc(MEM_ANALYSIS, words + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(result)
+    while (true) {
+        int p = BitSet_next(pending, pending_words, cursor);
+        if (p < 0) {
+            p = BitSet_next(pending, pending_words, 0);
+            if (p < 0) {
+                break;
+            }
+        }
+        BitSet_clear(pending, p);
+        cursor = p + 1;
+        int b = cfg->rpo[forward ? p : n - 1 - p];
+        CFGBlock* block = &cfg->blocks[b];
+
+        /* meet over the neighbors the facts come from */
+        uint64_t* input = DataflowAnalysis_set(analysis, forward ? analysis->in : analysis->out, b);
+        uint64_t* output = DataflowAnalysis_set(analysis, forward ? analysis->out : analysis->in, b);
+        const int* sources = (forward ? cfg->predecessors + block->first_pred : cfg->successors + block->first_succ);
+        int num_sources = (forward ? block->num_pred : block->num_succ);
+        bool first = true;
+        for (int i = 0; i < num_sources; i++) {
+            if (position[sources[i]] < 0) {
+                continue;
+            }
+            uint64_t* source = DataflowAnalysis_set(analysis, forward ? analysis->out : analysis->in, sources[i]);
+            if (first) {
+                memcpy(input, source, words * sizeof(uint64_t));
+                first = false;
+            } else if (analysis->meet == DATAFLOW_UNION) {
+                BitSet_union(input, source, words);
+            } else {
+                BitSet_intersect(input, source, words);
+            }
+        }
+        if (first) {
+            memcpy(input, analysis->boundary, words * sizeof(uint64_t));
+        }
+
+        /* result = gen | (input & ~kill) */
+        memcpy(result, input, words * sizeof(uint64_t));
+        BitSet_difference(result, DataflowAnalysis_set(analysis, analysis->kill, b), words);
+        BitSet_union(result, DataflowAnalysis_set(analysis, analysis->gen, b), words);
+        analysis->visits++;
+        if (memcmp(result, output, words * sizeof(uint64_t)) == 0) {
+            continue;
+        }
+        memcpy(output, result, words * sizeof(uint64_t));
+
+        /* the neighbors the facts flow to must be revisited */
+        const int* targets = (forward ? cfg->successors + block->first_succ : cfg->predecessors + block->first_pred);
+        int num_targets = (forward ? block->num_succ : block->num_pred);
+        for (int i = 0; i < num_targets; i++) {
+            if (position[targets[i]] >= 0) {
+                BitSet_set(pending, position[targets[i]]);
+            }
+        }
+    }
+
+    Memory_free(result);
+    Memory_free(position);
+    Memory_free(pending);
+    Memory_free(top);
+}
+
+void DataflowAnalysis_free (DataflowAnalysis* analysis)
+{
+    if (analysis == NULL) {
+        return;
+    }
+    Memory_free(analysis->gen);
+    Memory_free(analysis);
+}
+
+/*
+ * VARIABLES
+ */
+
+/**
+ * @brief Add a scalar variable (if it is not already numbered)
+ */
+void VariableIndex_add (VariableIndex* vars, const Symbol* symbol)
+{
+    if (symbol == NULL || symbol->symbol_type != SCALAR_SYMBOL) {
+        return;
+    }
+    if (PointerMap_insert(&vars->positions, symbol, vars->size) == vars->size) {
+        vars->symbols[vars->size++] = symbol;
+    }
+}
+
+VariableIndex* VariableIndex_build (ControlFlowGraph* cfg)
+{
+    SymbolTable* parameters = cfg->function->scope;
+    int limit = parameters->size;
+    for (int i = 0; i < cfg->num_items; i++) {
+        limit += (cfg->items[i]->type == VARDECL ? 1 : 0);
+    }
+
+    VariableIndex* vars = (VariableIndex*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(VariableIndex));
+    CHECK_MALLOC_PTR(vars)
+    vars->symbols = (const Symbol**)Memory_calloc(MEM_ANALYSIS, limit + 1, sizeof(Symbol*));
+    CHECK_MALLOC_PTR(vars->symbols)
+    PointerMap_init(&vars->positions, limit, MEM_ANALYSIS);
+
+    FOR_EACH(Symbol*, param, parameters->local_symbols) {
+        VariableIndex_add(vars, param);
+    }
+    vars->num_parameters = vars->size;
+    for (int i = 0; i < cfg->num_items; i++) {
+        ASTNode* item = cfg->items[i];
+        if (item->type == VARDECL) {
+            VariableIndex_add(vars, SymbolTable_lookup(item->scope, item->vardecl.name));
+        }
+    }
+    return vars;
+}
+
+int VariableIndex_find (VariableIndex* vars, const Symbol* symbol)
+{
+    return (symbol == NULL ? -1 : PointerMap_find(&vars->positions, symbol));
+}
+
+void VariableIndex_free (VariableIndex* vars)
+{
+    if (vars == NULL) {
+        return;
+    }
+    PointerMap_free(&vars->positions);
+    Memory_free(vars->symbols);
+    Memory_free(vars);
+}
+
+/*
+ * STATEMENT EFFECTS
+ */
+
+void dataflow_expression_uses (VariableIndex* vars, ASTNode* node, DataflowUseFn use, void* data)
+{
+    switch (node->type) {
+        case BINARYOP:
+            dataflow_expression_uses(vars, node->binaryop.left, use, data);
+            dataflow_expression_uses(vars, node->binaryop.right, use, data);
+            break;
+        case UNARYOP:
+            dataflow_expression_uses(vars, node->unaryop.child, use, data);
+            break;
+        case LOCATION:
+            if (node->location.index != NULL) {
+                dataflow_expression_uses(vars, node->location.index, use, data);
+            } else {
+                int v = VariableIndex_find(vars, node->location.symbol);
+                if (v >= 0) {
+                    use(data, v, node);
+                }
+            }
+            break;
+        case FUNCCALL:
+            FOR_EACH(ASTNode*, arg, node->funccall.arguments) {
+                dataflow_expression_uses(vars, arg, use, data);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void dataflow_item_uses (VariableIndex* vars, ASTNode* item, DataflowUseFn use, void* data)
+{
+    switch (item->type) {
+        case ASSIGNMENT:
+            if (item->assignment.location->location.index != NULL) {
+                dataflow_expression_uses(vars, item->assignment.location->location.index, use, data);
+            }
+            dataflow_expression_uses(vars, item->assignment.value, use, data);
+            break;
+        case RETURNSTMT:
+            if (item->funcreturn.value != NULL) {
+                dataflow_expression_uses(vars, item->funcreturn.value, use, data);
+            }
+            break;
+        case FUNCCALL:
+            dataflow_expression_uses(vars, item, use, data);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Find the tracked variable a block statement assigns or declares
+ *
+ * @returns Index of the variable, or -1 if there is none
+ */
+int dataflow_item_target (VariableIndex* vars, ASTNode* item)
+{
+    if (item->type == ASSIGNMENT && item->assignment.location->location.index == NULL) {
+        return VariableIndex_find(vars, item->assignment.location->location.symbol);
+    } else if (item->type == VARDECL) {
+        return VariableIndex_find(vars, SymbolTable_lookup(item->scope, item->vardecl.name));
+    }
+    return -1;
+}
+
+/*
+ * LIVENESS
+ */
+
+/**
+ * @brief Mark a read as live (a @ref DataflowUseFn)
+ */
+void liveness_use (void* data, int variable, ASTNode* location)
+{
+    BitSet_set((uint64_t*)data, variable);
+}
+
+DataflowAnalysis* Liveness_solve (ControlFlowGraph* cfg, VariableIndex* vars)
+{
+    DataflowAnalysis* analysis = DataflowAnalysis_new(cfg, vars->size, DATAFLOW_BACKWARD, DATAFLOW_UNION);
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        CFGBlock* block = &cfg->blocks[b];
+        uint64_t* gen = DataflowAnalysis_set(analysis, analysis->gen, b);
+        uint64_t* kill = DataflowAnalysis_set(analysis, analysis->kill, b);
+
+        /* walk backward: a read is exposed unless a later-walked (earlier) statement assigns it */
+        if (block->branch != NULL) {
+            dataflow_expression_uses(vars, block->branch, liveness_use, gen);
+        }
+        for (int i = block->num_items - 1; i >= 0; i--) {
+            ASTNode* item = cfg->items[block->first_item + i];
+            int target = dataflow_item_target(vars, item);
+            if (target >= 0) {
+                BitSet_clear(gen, target);
+                BitSet_set(kill, target);
+            }
+            dataflow_item_uses(vars, item, liveness_use, gen);
+        }
+    }
+    DataflowAnalysis_solve(analysis);
+    return analysis;
+}
+
+/*
+ * REACHING DEFINITIONS
+ */
+
+ReachingDefinitions* ReachingDefinitions_solve (ControlFlowGraph* cfg, VariableIndex* vars)
+{
+    ReachingDefinitions* defs = (ReachingDefinitions*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ReachingDefinitions));
+    CHECK_MALLOC_PTR(defs)
+    defs->sites = (ASTNode**)Memory_calloc(MEM_ANALYSIS, cfg->num_items + 1, sizeof(ASTNode*));
+    CHECK_MALLOC_PTR(defs->sites)
+    defs->variables = (int*)Memory_calloc(MEM_ANALYSIS, cfg->num_items + 1, sizeof(int));
+    CHECK_MALLOC_PTR(defs->variables)
+
+    /* number the assignments to tracked variables */
+    for (int i = 0; i < cfg->num_items; i++) {
+        ASTNode* item = cfg->items[i];
+        int target = dataflow_item_target(vars, item);
+        if (target >= 0 && item->type == ASSIGNMENT) {
+            defs->sites[defs->num_sites] = item;
+            defs->variables[defs->num_sites++] = target;
+        }
+    }
+
+    /* the definitions of each variable, as a set */
+    int words = BITSET_WORDS(defs->num_sites);
+    uint64_t* of_variable = (uint64_t*)Memory_calloc(MEM_ANALYSIS, (size_t)vars->size * words + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(of_variable)
+    for (int d = 0; d < defs->num_sites; d++) {
+        BitSet_set(of_variable + (size_t)defs->variables[d] * words, d);
+    }
+
+    DataflowAnalysis* analysis = DataflowAnalysis_new(cfg, defs->num_sites, DATAFLOW_FORWARD, DATAFLOW_UNION);
+    int d = 0;
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        CFGBlock* block = &cfg->blocks[b];
+        uint64_t* gen = DataflowAnalysis_set(analysis, analysis->gen, b);
+        uint64_t* kill = DataflowAnalysis_set(analysis, analysis->kill, b);
+        for (int i = 0; i < block->num_items; i++) {
+            ASTNode* item = cfg->items[block->first_item + i];
+            int target = dataflow_item_target(vars, item);
+            if (target < 0) {
+                continue;
+            }
+            /* an assignment or a (re)declaration replaces every earlier definition */
+            uint64_t* others = of_variable + (size_t)target * words;
+            BitSet_difference(gen, others, words);
+            BitSet_union(kill, others, words);
+            if (item->type == ASSIGNMENT) {
+                BitSet_set(gen, d++);
+            }
+        }
+    }
+    Memory_free(of_variable);
+    DataflowAnalysis_solve(analysis);
+    defs->analysis = analysis;
+    return defs;
+}
+
+void ReachingDefinitions_free (ReachingDefinitions* defs)
+{
+    if (defs == NULL) {
+        return;
+    }
+    DataflowAnalysis_free(defs->analysis);
+    Memory_free(defs->variables);
+    Memory_free(defs->sites);
+    Memory_free(defs);
+}
+
+/*
+ * DEFINITE ASSIGNMENT
+ */
+
+/**
+ * @brief State while checking the reads in one block
+ */
+typedef struct DefiniteAssignmentCheck
+{
+    VariableIndex* vars;            /**< @brief Variables of the function */
+    uint64_t* assigned;             /**< @brief Variables assigned on every path to this point */
+    ErrorList* errors;              /**< @brief Destination for errors */
+    int max_errors;                 /**< @brief Error limit (0 for none) */
+    int reported;                   /**< @brief Number of errors reported */
+} DefiniteAssignmentCheck;
+
+/**
+ * @brief Report a read of a local that may be unassigned (a @ref DataflowUseFn)
+ */
+void definite_assignment_use (void* data, int variable, ASTNode* location)
+{
+    DefiniteAssignmentCheck* check = (DefiniteAssignmentCheck*)data;
+    if (variable < check->vars->num_parameters || BitSet_test(check->assigned, variable)) {
+        return;
+    }
+    if (check->max_errors == 0 || ErrorList_size(check->errors) < check->max_errors) {
+        ErrorList_report(check->errors, ERR_UNINITIALIZED, location, check->vars->symbols[variable],
+                         UNKNOWN, UNKNOWN);
+        check->reported++;
+    }
+    /* report each variable once per path */
+    BitSet_set(check->assigned, variable);
+}
+
+int DefiniteAssignment_check (ControlFlowGraph* cfg, VariableIndex* vars, ErrorList* errors)
+{
+    DataflowAnalysis* analysis = DataflowAnalysis_new(cfg, vars->size, DATAFLOW_FORWARD, DATAFLOW_INTERSECTION);
+    for (int p = 0; p < vars->num_parameters; p++) {
+        BitSet_set(analysis->boundary, p);
+    }
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        CFGBlock* block = &cfg->blocks[b];
+        uint64_t* gen = DataflowAnalysis_set(analysis, analysis->gen, b);
+        uint64_t* kill = DataflowAnalysis_set(analysis, analysis->kill, b);
+        for (int i = 0; i < block->num_items; i++) {
+            ASTNode* item = cfg->items[block->first_item + i];
+            int target = dataflow_item_target(vars, item);
+            if (target < 0) {
+                continue;
+            }
+            if (item->type == VARDECL) {
+                BitSet_clear(gen, target);
+                BitSet_set(kill, target);
+            } else {
+                BitSet_set(gen, target);
+            }
+        }
+    }
+    DataflowAnalysis_solve(analysis);
+
+    /* replay each reachable block from its entry facts, checking every read */
+    DefiniteAssignmentCheck check;
+    check.vars = vars;
+    check.errors = errors;
+    check.max_errors = DecafContext_current()->max_errors;
+    check.reported = 0;
+    check.assigned = (uint64_t*)Memory_calloc(MEM_ANALYSIS, analysis->words + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(check.assigned)
+    for (int r = 0; r < cfg->num_reachable; r++) {
+        int b = cfg->rpo[r];
+        CFGBlock* block = &cfg->blocks[b];
+        memcpy(check.assigned, DataflowAnalysis_set(analysis, analysis->in, b), analysis->words * sizeof(uint64_t));
+        for (int i = 0; i < block->num_items; i++) {
+            ASTNode* item = cfg->items[block->first_item + i];
+            dataflow_item_uses(vars, item, definite_assignment_use, &check);
+            int target = dataflow_item_target(vars, item);
+            if (target >= 0 && item->type == VARDECL) {
+                BitSet_clear(check.assigned, target);
+            } else if (target >= 0) {
+                BitSet_set(check.assigned, target);
+            }
+        }
+        if (block->branch != NULL) {
+            dataflow_expression_uses(vars, block->branch, definite_assignment_use, &check);
+        }
+    }
+    Memory_free(check.assigned);
+    DataflowAnalysis_free(analysis);
+    return check.reported;
+}
+
+int DefiniteAssignment_check_program (ASTNode* tree, ErrorList* errors)
+{
+    int reported = 0;
+    FOR_EACH(ASTNode*, func, tree->program.functions) {
+        ControlFlowGraph* cfg = ControlFlowGraph_build(func);
+        VariableIndex* vars = VariableIndex_build(cfg);
+        reported += DefiniteAssignment_check(cfg, vars, errors);
+        VariableIndex_free(vars);
+        ControlFlowGraph_free(cfg);
+    }
+    return reported;
+}
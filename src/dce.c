@@ -0,0 +1,494 @@
+#include "dce.h"
+#include "callgraph.h"
+#include "dataflow.h"
+#include "fold.h"
+#include "visitor.h"
+
+/**
+ * @brief State of a dead code elimination pass
+ */
+typedef struct DeadCodeState
+{
+    bool breaks;                    /**< @brief True once the innermost loop has a reachable @c break */
+    bool moved;                     /**< @brief True once a node has been given a new parent */
+    DeadCodeStats stats;            /**< @brief Running statistics */
+} DeadCodeState;
+
+/*
+ * TREE SURGERY
+ */
+
+/**
+ * @brief Remove a node from a list (without deallocating it)
+ *
+ * @param list List that holds @p node
+ * @param prev Node before @p node (@c NULL if @p node is the head)
+ * @param node Node to remove
+ */
+void dce_unlink (NodeList* list, ASTNode* prev, ASTNode* node)
+{
+    if (prev == NULL) {
+        list->head = node->next;
+    } else {
+        prev->next = node->next;
+    }
+    if (list->tail == node) {
+        list->tail = prev;
+    }
+    list->size--;
+    node->next = NULL;
+}
+
+/**
+ * @brief Put a node in another node's place in a list (without deallocating either)
+ */
+void dce_replace (NodeList* list, ASTNode* prev, ASTNode* node, ASTNode* replacement)
+{
+    replacement->next = node->next;
+    if (prev == NULL) {
+        list->head = replacement;
+    } else {
+        prev->next = replacement;
+    }
+    if (list->tail == node) {
+        list->tail = replacement;
+    }
+    node->next = NULL;
+}
+
+/**
+ * @brief Record a node's new parent
+ *
+ * The @c parent attribute has no destructor, so it is updated in place
+ * rather than replaced.
+ */
+void dce_set_parent (DeadCodeState* state, ASTNode* node, ASTNode* parent)
+{
+    state->moved = true;
+    for (Attribute* a = node->attributes; a != NULL; a = a->next) {
+        if (strncmp(a->key, "parent", MAX_ID_LEN) == 0) {
+            a->value = parent;
+            return;
+        }
+    }
+    ASTNode_set_attribute(node, "parent", parent, NULL);
+}
+
+/**
+ * @brief Deallocate a node whose children have already been moved or deallocated
+ */
+void dce_free_shell (ASTNode* node)
+{
+    /* a type without children, so only the node and its attributes are freed */
+    node->type = BREAKSTMT;
+    ASTNode_free(node);
+}
+
+/**
+ * @brief Check whether an expression is a @c bool literal
+ */
+bool dce_is_literal (ASTNode* node)
+{
+    return node->type == LITERAL && node->literal.type == BOOL;
+}
+
+/*
+ * UNREACHABLE CODE AND CONSTANT BRANCHES
+ */
+
+bool dce_block (DeadCodeState* state, ASTNode* block);
+
+/**
+ * @brief Simplify the blocks nested in a statement
+ *
+ * @returns True if control can continue after the statement
+ */
+bool dce_statement (DeadCodeState* state, ASTNode* node)
+{
+    switch (node->type) {
+        case BLOCK:
+            return dce_block(state, node);
+        case CONDITIONAL: {
+            bool then_ends = dce_block(state, node->conditional.if_block);
+            bool else_ends = true;
+            if (node->conditional.else_block != NULL) {
+                else_ends = dce_block(state, node->conditional.else_block);
+            }
+            return then_ends || else_ends;
+        }
+        case WHILELOOP: {
+            bool outer_breaks = state->breaks;
+            state->breaks = false;
+            dce_block(state, node->whileloop.body);
+            bool exits = state->breaks || !dce_is_literal(node->whileloop.condition);
+            state->breaks = outer_breaks;
+            return exits;
+        }
+        case BREAKSTMT:
+            state->breaks = true;
+            return false;
+        case RETURNSTMT:
+        case CONTINUESTMT:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief Take apart a conditional whose condition is a literal
+ *
+ * The condition and the branch that is never taken are deallocated, but the
+ * conditional node itself is not.
+ *
+ * @returns The block that is always taken (@c NULL if it is a missing @c else)
+ */
+ASTNode* dce_taken_branch (ASTNode* node)
+{
+    bool value = node->conditional.condition->literal.boolean;
+    ASTNode* taken = value ? node->conditional.if_block : node->conditional.else_block;
+    ASTNode* dropped = value ? node->conditional.else_block : node->conditional.if_block;
+    ASTNode_free(node->conditional.condition);
+    if (dropped != NULL) {
+        ASTNode_free(dropped);
+    }
+    return taken;
+}
+
+/**
+ * @brief Remove unreachable statements and constant branches from a block
+ *
+ * @returns True if control can fall off the end of the block
+ */
+bool dce_block (DeadCodeState* state, ASTNode* block)
+{
+    NodeList* list = block->block.statements;
+    ASTNode* prev = NULL;
+    ASTNode* stmt = list->head;
+    bool reachable = true;
+    while (stmt != NULL) {
+        ASTNode* next = stmt->next;
+        if (!reachable) {
+            dce_unlink(list, prev, stmt);
+            ASTNode_free(stmt);
+            state->stats.statements++;
+            stmt = next;
+            continue;
+        }
+
+        if (stmt->type == CONDITIONAL && dce_is_literal(stmt->conditional.condition)) {
+            /* replace the conditional by the block it always takes */
+            ASTNode* taken = dce_taken_branch(stmt);
+            if (taken != NULL) {
+                dce_replace(list, prev, stmt, taken);
+                dce_set_parent(state, taken, block);
+            } else {
+                dce_unlink(list, prev, stmt);
+            }
+            dce_free_shell(stmt);
+            state->stats.branches++;
+            stmt = taken;
+        } else if (stmt->type == WHILELOOP && dce_is_literal(stmt->whileloop.condition) &&
+                   !stmt->whileloop.condition->literal.boolean) {
+            dce_unlink(list, prev, stmt);
+            ASTNode_free(stmt);
+            state->stats.branches++;
+            stmt = NULL;
+        }
+
+        if (stmt != NULL) {
+            reachable = dce_statement(state, stmt);
+            prev = stmt;
+        }
+        stmt = next;
+    }
+    return reachable;
+}
+
+/*
+ * UNCALLED FUNCTIONS
+ */
+
+/**
+ * @brief Remove the functions that cannot be reached through calls from @c main
+ */
+void dce_uncalled_functions (DeadCodeState* state, ASTNode* tree)
+{
+    CallGraph* graph = CallGraph_build(tree);
+    int root = CallGraph_find(graph, SymbolTable_lookup(tree->scope, "main"));
+    if (root < 0) {
+        CallGraph_free(graph);
+        return;
+    }
+
+    /* depth-first search from main */
+    bool* called = (bool*)Memory_calloc(MEM_ANALYSIS, graph->num_nodes, sizeof(bool));
+    CHECK_MALLOC_PTR(called)
+    int* pending = (int*)Memory_calloc(MEM_ANALYSIS, graph->num_nodes, sizeof(int));
+    CHECK_MALLOC_PTR(pending)
+    int num_pending = 0;
+    called[root] = true;
+    pending[num_pending++] = root;
+    while (num_pending > 0) {
+        int caller = pending[--num_pending];
+        FOR_EACH_CALL(call, graph, caller) {
+            if (!called[call->callee]) {
+                called[call->callee] = true;
+                pending[num_pending++] = call->callee;
+            }
+        }
+    }
+
+    /* graph nodes are in declaration order, like the list */
+    Symbol** removed = (Symbol**)Memory_calloc(MEM_ANALYSIS, graph->num_nodes + 1, sizeof(Symbol*));
+    CHECK_MALLOC_PTR(removed)
+    int num_removed = 0;
+    NodeList* list = tree->program.functions;
+    ASTNode* prev = NULL;
+    ASTNode* func = list->head;
+    for (int i = 0; func != NULL; i++) {
+        ASTNode* next = func->next;
+        if (!called[i]) {
+            removed[num_removed++] = (Symbol*)graph->nodes[i].symbol;
+            dce_unlink(list, prev, func);
+            ASTNode_free(func);
+            state->stats.functions++;
+        } else {
+            prev = func;
+        }
+        func = next;
+    }
+    SymbolTable_remove_all(tree->scope, removed, num_removed);
+    Memory_free(removed);
+    Memory_free(pending);
+    Memory_free(called);
+    CallGraph_free(graph);
+}
+
+/*
+ * UNUSED LOCALS
+ */
+
+/**
+ * @brief Count a read of a variable (a @ref DataflowUseFn)
+ */
+void dce_count_read (void* data, int variable, ASTNode* location)
+{
+    ((int*)data)[variable]++;
+}
+
+/**
+ * @brief Check whether an expression contains a function call
+ */
+bool dce_has_call (ASTNode* node)
+{
+    switch (node->type) {
+        case BINARYOP:
+            return dce_has_call(node->binaryop.left) || dce_has_call(node->binaryop.right);
+        case UNARYOP:
+            return dce_has_call(node->unaryop.child);
+        case LOCATION:
+            return node->location.index != NULL && dce_has_call(node->location.index);
+        case FUNCCALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Check whether a variable is a local that is never read
+ */
+bool dce_is_unused (VariableIndex* vars, const int* reads, const Symbol* symbol)
+{
+    int v = VariableIndex_find(vars, symbol);
+    return v >= vars->num_parameters && reads[v] == 0;
+}
+
+/**
+ * @brief Remove the assignments to unused locals in a block and its nested blocks
+ *
+ * An assignment that cannot be removed without losing a call keeps its
+ * variable (by counting it as read).
+ */
+void dce_remove_stores (DeadCodeState* state, VariableIndex* vars, int* reads, ASTNode* block)
+{
+    NodeList* list = block->block.statements;
+    ASTNode* prev = NULL;
+    ASTNode* stmt = list->head;
+    while (stmt != NULL) {
+        ASTNode* next = stmt->next;
+        ASTNode* kept = stmt;
+        switch (stmt->type) {
+            case ASSIGNMENT: {
+                ASTNode* location = stmt->assignment.location;
+                ASTNode* value = stmt->assignment.value;
+                if (location->location.index != NULL ||
+                        !dce_is_unused(vars, reads, location->location.symbol)) {
+                    break;
+                }
+                if (!dce_has_call(value)) {
+                    dce_unlink(list, prev, stmt);
+                    ASTNode_free(stmt);
+                    kept = prev;
+                } else if (value->type == FUNCCALL) {
+                    /* keep the call for its effects */
+                    dce_replace(list, prev, stmt, value);
+                    dce_set_parent(state, value, block);
+                    ASTNode_free(location);
+                    dce_free_shell(stmt);
+                    kept = value;
+                } else {
+                    reads[VariableIndex_find(vars, location->location.symbol)]++;
+                    break;
+                }
+                state->stats.assignments++;
+                break;
+            }
+            case BLOCK:
+                dce_remove_stores(state, vars, reads, stmt);
+                break;
+            case CONDITIONAL:
+                dce_remove_stores(state, vars, reads, stmt->conditional.if_block);
+                if (stmt->conditional.else_block != NULL) {
+                    dce_remove_stores(state, vars, reads, stmt->conditional.else_block);
+                }
+                break;
+            case WHILELOOP:
+                dce_remove_stores(state, vars, reads, stmt->whileloop.body);
+                break;
+            default:
+                break;
+        }
+        prev = kept;
+        stmt = next;
+    }
+}
+
+/**
+ * @brief Remove the declarations of unused locals in a block and its nested blocks
+ */
+void dce_remove_decls (DeadCodeState* state, VariableIndex* vars, const int* reads, ASTNode* block)
+{
+    /* every declaration in the block is in the block's table */
+    NodeList* list = block->block.variables;
+    Symbol** removed = (Symbol**)Memory_calloc(MEM_ANALYSIS, list->size + 1, sizeof(Symbol*));
+    CHECK_MALLOC_PTR(removed)
+    int num_removed = 0;
+    SymbolTable* scope = NULL;
+    ASTNode* prev = NULL;
+    ASTNode* var = list->head;
+    while (var != NULL) {
+        ASTNode* next = var->next;
+        Symbol* symbol = SymbolTable_lookup(var->scope, var->vardecl.name);
+        if (dce_is_unused(vars, reads, symbol)) {
+            removed[num_removed++] = symbol;
+            scope = var->scope;
+            dce_unlink(list, prev, var);
+            ASTNode_free(var);
+            state->stats.locals++;
+        } else {
+            prev = var;
+        }
+        var = next;
+    }
+    if (scope != NULL) {
+        SymbolTable_remove_all(scope, removed, num_removed);
+    }
+    Memory_free(removed);
+    FOR_EACH(ASTNode*, stmt, block->block.statements) {
+        switch (stmt->type) {
+            case BLOCK:
+                dce_remove_decls(state, vars, reads, stmt);
+                break;
+            case CONDITIONAL:
+                dce_remove_decls(state, vars, reads, stmt->conditional.if_block);
+                if (stmt->conditional.else_block != NULL) {
+                    dce_remove_decls(state, vars, reads, stmt->conditional.else_block);
+                }
+                break;
+            case WHILELOOP:
+                dce_remove_decls(state, vars, reads, stmt->whileloop.body);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Remove the locals of a function that are never read
+ *
+ * Reads are counted over the function's control-flow graph, which covers
+ * every statement and condition in the body.
+ *
+ * @returns True if anything was removed (which may leave other locals unread)
+ */
+bool dce_unused_locals (DeadCodeState* state, ASTNode* func)
+{
+    ControlFlowGraph* cfg = ControlFlowGraph_build(func);
+    VariableIndex* vars = VariableIndex_build(cfg);
+    int* reads = (int*)Memory_calloc(MEM_ANALYSIS, vars->size + 1, sizeof(int));
+    CHECK_MALLOC_PTR(reads)
+    for (int i = 0; i < cfg->num_items; i++) {
+        dataflow_item_uses(vars, cfg->items[i], dce_count_read, reads);
+    }
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        if (cfg->blocks[b].branch != NULL) {
+            dataflow_expression_uses(vars, cfg->blocks[b].branch, dce_count_read, reads);
+        }
+    }
+
+    bool unused = false;
+    for (int v = vars->num_parameters; v < vars->size; v++) {
+        unused = unused || reads[v] == 0;
+    }
+    int before = state->stats.locals + state->stats.assignments;
+    if (unused) {
+        dce_remove_stores(state, vars, reads, func->funcdecl.body);
+        dce_remove_decls(state, vars, reads, func->funcdecl.body);
+    }
+
+    Memory_free(reads);
+    VariableIndex_free(vars);
+    ControlFlowGraph_free(cfg);
+    return state->stats.locals + state->stats.assignments > before;
+}
+
+DeadCodeStats eliminate_dead_code (ASTNode* tree)
+{
+    DeadCodeState state;
+    state.breaks = false;
+    state.moved = false;
+    state.stats = (DeadCodeStats){ 0 };
+    state.stats.nodes_before = fold_count_nodes(tree);
+
+    /* calls in unreachable code do not keep their targets alive */
+    FOR_EACH(ASTNode*, func, tree->program.functions) {
+        dce_block(&state, func->funcdecl.body);
+    }
+    dce_uncalled_functions(&state, tree);
+    FOR_EACH(ASTNode*, func, tree->program.functions) {
+        while (dce_unused_locals(&state, func)) {
+            /* removing an assignment may remove the last read of another local */
+        }
+    }
+
+    if (state.moved) {
+        NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
+    }
+    state.stats.nodes_after = fold_count_nodes(tree);
+    return state.stats;
+}
+
+void DeadCodeStats_print (const DeadCodeStats* stats, FILE* output)
+{
+    int removed = stats->nodes_before - stats->nodes_after;
+    fprintf(output, "dce: %d unreachable statements, %d constant branches, %d uncalled functions removed\n",
+            stats->statements, stats->branches, stats->functions);
+    fprintf(output, "dce: %d unused locals and %d assignments to them removed\n",
+            stats->locals, stats->assignments);
+    fprintf(output, "dce: %d AST nodes, %d after elimination (%d removed, %.1f%% reduction)\n",
+            stats->nodes_before, stats->nodes_after, removed,
+            stats->nodes_before > 0 ? 100.0 * removed / stats->nodes_before : 0.0);
+}
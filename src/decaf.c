@@ -0,0 +1,96 @@
+#include "p1-lexer.h"
+#include "p2-parser.h"
+#include "decaf.h"
+
+/**
+ * @brief Record a fatal front end error as the only error in a result
+ */
+void decaf_result_fail (DecafResult* result, const char* message)
+{
+    /* front end messages are meant for stderr and may end with a newline */
+    size_t length = strlen(message);
+    while (length > 0 && message[length - 1] == '\n') {
+        length--;
+    }
+    ErrorList_printf(result->errors, "%.*s", (int)length, message);
+}
+
+DecafStatus decaf_parse_buffer (DecafContext* context, const char* text, size_t length,
+                                DecafResult* result)
+{
+    if (result == NULL) {
+        return DECAF_INVALID_INPUT;
+    }
+    result->tree = NULL;
+    result->globals = NULL;
+    result->errors = NULL;
+    if (context == NULL || text == NULL || length > MAX_FILE_SIZE) {
+        return DECAF_INVALID_INPUT;
+    }
+    DecafContext* previous = DecafContext_set_current(context);
+    result->errors = ErrorList_new();
+
+    /* front end (fatal errors are thrown, abandoning whatever the lexer or
+     * parser had built so far; the capture reclaims it) */
+    Memory_begin_capture();
+
+    /* the lexer needs a mutable, NUL-terminated copy */
+    char* source = (char*)Memory_calloc(MEM_TOKEN, length + 1, sizeof(char));
+    CHECK_MALLOC_PTR(source)
+    memcpy(source, text, length);
+    source[length] = '\0';
+
+    TokenQueue* tokens = NULL;
+    ASTNode* tree = NULL;
+    DecafContext_arm(context);
+    if (setjmp(context->error_jump) == 0) {
+        tokens = lex(source);
+        tree = parse(tokens);
+    } else {
+        DecafContext_disarm(context);
+        Memory_end_capture(true);
+        decaf_result_fail(result, context->error_msg);
+        DecafContext_set_current(previous);
+        return DECAF_SYNTAX_ERROR;
+    }
+    DecafContext_disarm(context);
+    Memory_end_capture(false);
+    TokenQueue_free(tokens);
+    Memory_free(source);
+
+    /* middle end */
+    NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
+    NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
+    NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
+
+    result->tree = tree;
+    result->globals = tree->scope;
+    DecafContext_set_current(previous);
+    return DECAF_OK;
+}
+
+DecafStatus decaf_analyze_buffer (DecafContext* context, const char* text, size_t length,
+                                  DecafResult* result)
+{
+    DecafStatus status = decaf_parse_buffer(context, text, length, result);
+    if (status != DECAF_OK) {
+        return status;
+    }
+    DecafContext* previous = DecafContext_set_current(context);
+    ErrorList_append_all(result->errors, analyze(result->tree));
+    DecafContext_set_current(previous);
+    return (ErrorList_is_empty(result->errors) ? DECAF_OK : DECAF_ANALYSIS_ERRORS);
+}
+
+void decaf_result_free (DecafResult* result)
+{
+    if (result->tree != NULL) {
+        ASTNode_free(result->tree);
+    }
+    if (result->errors != NULL) {
+        ErrorList_free(result->errors);
+    }
+    result->tree = NULL;
+    result->globals = NULL;
+    result->errors = NULL;
+}
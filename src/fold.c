@@ -0,0 +1,440 @@
+#include "fold.h"
+#include "context.h"
+
+/**
+ * @brief Initial number of facts in the table of known constants
+ */
+#define FOLD_INITIAL_CAPACITY 64
+
+/**
+ * @brief Scalar variable with a known constant value
+ *
+ * Facts are invalidated in bulk by bumping a generation counter rather than
+ * by clearing the table, so a join point costs constant time.
+ */
+typedef struct FoldFact
+{
+    DecafType type;                 /**< @brief Type of the value (@c INT or @c BOOL) */
+    int value;                      /**< @brief Value (0 or 1 for @c BOOL) */
+    bool global;                    /**< @brief True if the variable is a global */
+    unsigned generation;            /**< @brief Value of @c generation when recorded */
+    unsigned global_generation;     /**< @brief Value of @c global_generation when recorded */
+} FoldFact;
+
+/**
+ * @brief State of a folding pass
+ */
+typedef struct FoldState
+{
+    SymbolTable* globals;           /**< @brief Global scope (to recognize global variables) */
+    ErrorList* errors;              /**< @brief Destination for division by zero errors */
+    int max_errors;                 /**< @brief Error limit (0 for none) */
+    FoldFact* facts;                /**< @brief One fact per variable ever assigned a literal */
+    int num_facts;                  /**< @brief Number of facts */
+    int capacity;                   /**< @brief Allocated length of @c facts */
+    PointerMap variables;           /**< @brief Map from variable symbol to fact index */
+    unsigned generation;            /**< @brief Facts from older generations are invalid */
+    unsigned global_generation;     /**< @brief Facts about globals from older generations are invalid */
+    FoldStats stats;                /**< @brief Running statistics */
+} FoldState;
+
+/**
+ * @brief Wrap a value around to 32 bits (two's complement)
+ */
+int fold_wrap (int64_t value)
+{
+    return (int)(int32_t)(uint32_t)(uint64_t)value;
+}
+
+/**
+ * @brief Check whether a fact is still valid
+ */
+bool FoldFact_valid (FoldState* state, FoldFact* fact)
+{
+    return fact->generation == state->generation &&
+           (!fact->global || fact->global_generation == state->global_generation);
+}
+
+/**
+ * @brief Look up the known value of a variable
+ *
+ * @returns The variable's fact, or @c NULL if its value is not known
+ */
+FoldFact* FoldState_lookup (FoldState* state, const Symbol* symbol)
+{
+    int i = PointerMap_find(&state->variables, symbol);
+    return (i >= 0 && FoldFact_valid(state, &state->facts[i]) ? &state->facts[i] : NULL);
+}
+
+/**
+ * @brief Record a variable's value (or forget it if @p value is not a literal)
+ */
+void FoldState_assign (FoldState* state, const Symbol* symbol, ASTNode* value)
+{
+    int i = PointerMap_find(&state->variables, symbol);
+    if (value->type != LITERAL) {
+        if (i >= 0) {
+            state->facts[i].generation = state->generation - 1;
+        }
+        return;
+    }
+    if (i < 0) {
+        if (state->num_facts == state->capacity) {
+            state->capacity *= 2;
+            state->facts = (FoldFact*)Memory_realloc(state->facts, state->capacity, sizeof(FoldFact));
+            CHECK_MALLOC_PTR(state->facts)
+        }
+        i = PointerMap_insert(&state->variables, symbol, state->num_facts++);
+    }
+    FoldFact* fact = &state->facts[i];
+    fact->type = value->literal.type;
+    fact->value = (value->literal.type == BOOL ? value->literal.boolean : value->literal.integer);
+    fact->global = (SymbolTable_lookup(state->globals, symbol->name) == symbol);
+    fact->generation = state->generation;
+    fact->global_generation = state->global_generation;
+}
+
+/**
+ * @brief Forget every known value (at a control-flow join)
+ */
+void FoldState_clear (FoldState* state)
+{
+    state->generation++;
+}
+
+/**
+ * @brief Turn an expression node into a literal, freeing its operands
+ */
+void fold_to_literal (ASTNode* node, DecafType type, int value)
+{
+    switch (node->type) {
+        case BINARYOP:
+            ASTNode_free(node->binaryop.left);
+            ASTNode_free(node->binaryop.right);
+            break;
+        case UNARYOP:
+            ASTNode_free(node->unaryop.child);
+            break;
+        default:
+            break;
+    }
+    node->type = LITERAL;
+    node->literal.type = type;
+    if (type == BOOL) {
+        node->literal.boolean = (value != 0);
+    } else {
+        node->literal.integer = value;
+    }
+}
+
+/**
+ * @brief Check whether an expression is a literal or a plain variable read
+ *
+ * Such operands have no side effects and no children, so they can be dropped
+ * or moved into their parent node.
+ */
+bool fold_is_leaf (ASTNode* node)
+{
+    return node->type == LITERAL || (node->type == LOCATION && node->location.index == NULL);
+}
+
+/**
+ * @brief Get the value of an @c int or @c bool literal
+ */
+int fold_value (ASTNode* node)
+{
+    return (node->literal.type == BOOL ? node->literal.boolean : node->literal.integer);
+}
+
+/**
+ * @brief Replace a binary operation by one of its leaf operands
+ */
+void fold_to_operand (ASTNode* node, ASTNode* operand)
+{
+    if (operand->type == LITERAL) {
+        fold_to_literal(node, operand->literal.type, fold_value(operand));
+        return;
+    }
+    LocationNode location = operand->location;
+    ASTNode_free(node->binaryop.left);
+    ASTNode_free(node->binaryop.right);
+    node->type = LOCATION;
+    node->location = location;
+}
+
+/**
+ * @brief Check whether an expression is a particular @c int or @c bool literal
+ */
+bool fold_is_constant (ASTNode* node, int value)
+{
+    return node->type == LITERAL && node->literal.type != STR && fold_value(node) == value;
+}
+
+void fold_expression (FoldState* state, ASTNode* node);
+
+/**
+ * @brief Report a constant zero divisor (up to the error limit)
+ */
+void fold_report_zero_divisor (FoldState* state, ASTNode* node)
+{
+    if (state->max_errors == 0 || ErrorList_size(state->errors) < state->max_errors) {
+        ErrorList_report(state->errors, ERR_DIVISION_BY_ZERO, node, NULL, UNKNOWN, UNKNOWN);
+    }
+}
+
+/**
+ * @brief Evaluate an operation on two literals
+ *
+ * @returns False if the operation cannot be evaluated at compile time
+ */
+bool fold_evaluate (BinaryOpType op, ASTNode* left, ASTNode* right, DecafType* type, int* result)
+{
+    int64_t a = fold_value(left);
+    int64_t b = fold_value(right);
+    *type = INT;
+    switch (op) {
+        case ADDOP:     *result = fold_wrap(a + b);     return true;
+        case SUBOP:     *result = fold_wrap(a - b);     return true;
+        case MULOP:     *result = fold_wrap(a * b);     return true;
+        case DIVOP:     if (b == 0) return false;
+                        *result = fold_wrap(a / b);     return true;
+        case MODOP:     if (b == 0) return false;
+                        *result = fold_wrap(a % b);     return true;
+        default:        break;
+    }
+    *type = BOOL;
+    switch (op) {
+        case OROP:      *result = (a || b);             return true;
+        case ANDOP:     *result = (a && b);             return true;
+        case EQOP:      *result = (a == b);             return true;
+        case NEQOP:     *result = (a != b);             return true;
+        case LTOP:      *result = (a < b);              return true;
+        case LEOP:      *result = (a <= b);             return true;
+        case GEOP:      *result = (a >= b);             return true;
+        case GTOP:      *result = (a > b);              return true;
+        default:        break;
+    }
+    return false;
+}
+
+/**
+ * @brief Fold a binary operation (after its operands)
+ */
+void fold_binaryop (FoldState* state, ASTNode* node)
+{
+    BinaryOpType op = node->binaryop.operator;
+    ASTNode* left = node->binaryop.left;
+    ASTNode* right = node->binaryop.right;
+    fold_expression(state, left);
+
+    /* a deciding left operand means the right one is never evaluated */
+    if ((op == ANDOP && fold_is_constant(left, false)) || (op == OROP && fold_is_constant(left, true))) {
+        fold_to_literal(node, BOOL, op == OROP);
+        state->stats.folded++;
+        return;
+    }
+    fold_expression(state, right);
+
+    if ((op == DIVOP || op == MODOP) && fold_is_constant(right, 0)) {
+        fold_report_zero_divisor(state, node);
+        return;
+    }
+    if (left->type == LITERAL && right->type == LITERAL) {
+        DecafType type;
+        int result;
+        if (fold_evaluate(op, left, right, &type, &result)) {
+            fold_to_literal(node, type, result);
+            state->stats.folded++;
+        }
+        return;
+    }
+
+    /* algebraic identities with a side-effect-free operand */
+    ASTNode* keep = NULL;
+    if (fold_is_leaf(left) && fold_is_leaf(right)) {
+        switch (op) {
+            case ADDOP:
+                keep = fold_is_constant(left, 0) ? right : fold_is_constant(right, 0) ? left : NULL;
+                break;
+            case SUBOP:
+                keep = fold_is_constant(right, 0) ? left : NULL;
+                break;
+            case MULOP:
+                keep = fold_is_constant(left, 0) ? left : fold_is_constant(right, 0) ? right :
+                       fold_is_constant(left, 1) ? right : fold_is_constant(right, 1) ? left : NULL;
+                break;
+            case DIVOP:
+                keep = fold_is_constant(right, 1) ? left : NULL;
+                break;
+            case ANDOP:
+                keep = fold_is_constant(left, true) ? right : fold_is_constant(right, true) ? left :
+                       fold_is_constant(right, false) ? right : NULL;
+                break;
+            case OROP:
+                keep = fold_is_constant(left, false) ? right : fold_is_constant(right, false) ? left :
+                       fold_is_constant(right, true) ? right : NULL;
+                break;
+            default:
+                break;
+        }
+    }
+    if (keep != NULL) {
+        fold_to_operand(node, keep);
+        state->stats.simplified++;
+    }
+}
+
+/**
+ * @brief Fold an expression in evaluation order
+ */
+void fold_expression (FoldState* state, ASTNode* node)
+{
+    switch (node->type) {
+        case BINARYOP:
+            fold_binaryop(state, node);
+            break;
+        case UNARYOP:
+            fold_expression(state, node->unaryop.child);
+            if (node->unaryop.child->type == LITERAL) {
+                int value = fold_value(node->unaryop.child);
+                if (node->unaryop.operator == NEGOP) {
+                    fold_to_literal(node, INT, fold_wrap(-(int64_t)value));
+                } else {
+                    fold_to_literal(node, BOOL, !value);
+                }
+                state->stats.folded++;
+            }
+            break;
+        case LOCATION:
+            if (node->location.index != NULL) {
+                fold_expression(state, node->location.index);
+            } else if (node->location.symbol != NULL) {
+                FoldFact* fact = FoldState_lookup(state, node->location.symbol);
+                if (fact != NULL) {
+                    fold_to_literal(node, fact->type, fact->value);
+                    state->stats.propagated++;
+                }
+            }
+            break;
+        case FUNCCALL:
+            FOR_EACH(ASTNode*, arg, node->funccall.arguments) {
+                fold_expression(state, arg);
+            }
+            /* the callee may assign to any global */
+            state->global_generation++;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Fold the expressions of a statement, tracking assigned constants
+ */
+void fold_statement (FoldState* state, ASTNode* node)
+{
+    switch (node->type) {
+        case BLOCK:
+            FOR_EACH(ASTNode*, stmt, node->block.statements) {
+                fold_statement(state, stmt);
+            }
+            break;
+        case ASSIGNMENT: {
+            ASTNode* location = node->assignment.location;
+            if (location->location.index != NULL) {
+                fold_expression(state, location->location.index);
+            }
+            fold_expression(state, node->assignment.value);
+            if (location->location.index == NULL && location->location.symbol != NULL) {
+                FoldState_assign(state, location->location.symbol, node->assignment.value);
+            }
+            break;
+        }
+        case CONDITIONAL:
+            fold_expression(state, node->conditional.condition);
+            FoldState_clear(state);
+            fold_statement(state, node->conditional.if_block);
+            FoldState_clear(state);
+            if (node->conditional.else_block != NULL) {
+                fold_statement(state, node->conditional.else_block);
+                FoldState_clear(state);
+            }
+            break;
+        case WHILELOOP:
+            /* the condition is also reached from the end of the body */
+            FoldState_clear(state);
+            fold_expression(state, node->whileloop.condition);
+            fold_statement(state, node->whileloop.body);
+            FoldState_clear(state);
+            break;
+        case RETURNSTMT:
+            if (node->funcreturn.value != NULL) {
+                fold_expression(state, node->funcreturn.value);
+            }
+            break;
+        case BREAKSTMT:
+        case CONTINUESTMT:
+            FoldState_clear(state);
+            break;
+        default:
+            fold_expression(state, node);
+            break;
+    }
+}
+
+/**
+ * @brief Count every node (a @c previsit_default routine)
+ */
+void fold_count_node (NodeVisitor* visitor, ASTNode* node)
+{
+    (*(int*)visitor->data)++;
+}
+
+int fold_count_nodes (ASTNode* tree)
+{
+    int count = 0;
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = &count;
+    v->previsit_default = fold_count_node;
+    NodeVisitor_traverse_and_free(v, tree);
+    return count;
+}
+
+FoldStats fold_constants (ASTNode* tree, ErrorList* errors)
+{
+    FoldState state;
+    state.globals = tree->scope;
+    state.errors = errors;
+    state.max_errors = DecafContext_current()->max_errors;
+    state.capacity = FOLD_INITIAL_CAPACITY;
+    state.facts = (FoldFact*)Memory_calloc(MEM_ANALYSIS, state.capacity, sizeof(FoldFact));
+    CHECK_MALLOC_PTR(state.facts)
+    state.num_facts = 0;
+    PointerMap_init(&state.variables, FOLD_INITIAL_CAPACITY, MEM_ANALYSIS);
+    state.generation = 1;
+    state.global_generation = 1;
+    state.stats = (FoldStats){ 0 };
+    state.stats.nodes_before = fold_count_nodes(tree);
+
+    FOR_EACH(ASTNode*, func, tree->program.functions) {
+        /* nothing is known about parameters or globals on entry */
+        FoldState_clear(&state);
+        state.global_generation++;
+        fold_statement(&state, func->funcdecl.body);
+    }
+
+    state.stats.nodes_after = fold_count_nodes(tree);
+    PointerMap_free(&state.variables);
+    Memory_free(state.facts);
+    return state.stats;
+}
+
+void FoldStats_print (const FoldStats* stats, FILE* output)
+{
+    int removed = stats->nodes_before - stats->nodes_after;
+    fprintf(output, "fold: %d operations folded, %d simplified, %d constant reads propagated\n",
+            stats->folded, stats->simplified, stats->propagated);
+    fprintf(output, "fold: %d AST nodes, %d after folding (%.1f%% reduction)\n",
+            stats->nodes_before, stats->nodes_after,
+            stats->nodes_before > 0 ? 100.0 * removed / stats->nodes_before : 0.0);
+}
@@ -0,0 +1,265 @@
+#include "hashcons.h"
+
+/**
+ * @brief Initial number of buckets in a @ref HashConsTable
+ */
+#define HASHCONS_INITIAL_CAPACITY 256
+
+HashConsTable* HashConsTable_new ()
+{
+    HashConsTable* table = (HashConsTable*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(HashConsTable));
+    CHECK_MALLOC_PTR(table)
+    table->capacity = HASHCONS_INITIAL_CAPACITY;
+    table->buckets = (HashConsEntry**)Memory_calloc(MEM_ANALYSIS, table->capacity, sizeof(HashConsEntry*));
+    CHECK_MALLOC_PTR(table->buckets)
+    table->size = 0;
+    table->expression_nodes = 0;
+    return table;
+}
+
+void HashConsTable_print_stats (HashConsTable* table, FILE* output)
+{
+    int shared = table->expression_nodes - table->size;
+    int hits = 0, skipped = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        for (HashConsEntry* e = table->buckets[i]; e != NULL; e = e->next) {
+            hits += e->reuses;
+            skipped += e->reuses * e->size;
+        }
+    }
+    fprintf(output, "hash-cons: %d expression nodes, %d unique (%d shared, %.1f%% reduction)\n",
+            table->expression_nodes, table->size, shared,
+            table->expression_nodes > 0 ? 100.0 * shared / table->expression_nodes : 0.0);
+    fprintf(output, "hash-cons: %d memoized subtrees reused, %d nodes not re-checked\n",
+            hits, skipped);
+}
+
+void HashConsTable_free (HashConsTable* table)
+{
+    for (int i = 0; i < table->capacity; i++) {
+        HashConsEntry* next = table->buckets[i];
+        while (next != NULL) {
+            HashConsEntry* cur = next;
+            next = cur->next;
+            Memory_free(cur);
+        }
+    }
+    Memory_free(table->buckets);
+    Memory_free(table);
+}
+
+/**
+ * @brief Double the number of buckets and rehash all entries
+ */
+void HashConsTable_grow (HashConsTable* table)
+{
+    int capacity = table->capacity * 2;
+    HashConsEntry** buckets = (HashConsEntry**)Memory_calloc(MEM_ANALYSIS, capacity, sizeof(HashConsEntry*));
+    CHECK_MALLOC_PTR(buckets)
+    for (int i = 0; i < table->capacity; i++) {
+        HashConsEntry* next = table->buckets[i];
+        while (next != NULL) {
+            HashConsEntry* cur = next;
+            next = cur->next;
+            size_t b = (size_t)(cur->hash % (uint64_t)capacity);
+            cur->next = buckets[b];
+            buckets[b] = cur;
+        }
+    }
+    Memory_free(table->buckets);
+    table->buckets = buckets;
+    table->capacity = capacity;
+}
+
+/*
+ * AST VISITOR: HASH-CONSING
+ */
+
+#define TABLE ((HashConsTable*)visitor->data)
+
+#define ENTRY(N) ((HashConsEntry*)ASTNode_get_attribute(N, "hashcons"))
+
+/**
+ * @brief Compute the structural hash of an expression node
+ *
+ * Children must already have been hash-consed (i.e., this is called in
+ * postorder).
+ */
+uint64_t HashCons_hash_node (ASTNode* node)
+{
+    uint64_t hash = hash_combine(0, (uint64_t)node->type);
+    switch (node->type) {
+        case BINARYOP:
+            hash = hash_combine(hash, (uint64_t)node->binaryop.operator);
+            hash = hash_combine(hash, ENTRY(node->binaryop.left)->hash);
+            hash = hash_combine(hash, ENTRY(node->binaryop.right)->hash);
+            break;
+        case UNARYOP:
+            hash = hash_combine(hash, (uint64_t)node->unaryop.operator);
+            hash = hash_combine(hash, ENTRY(node->unaryop.child)->hash);
+            break;
+        case LOCATION:
+            hash = hash_combine(hash, hash_string(node->location.name));
+            if (node->location.index != NULL) {
+                hash = hash_combine(hash, ENTRY(node->location.index)->hash);
+            }
+            break;
+        case FUNCCALL:
+            hash = hash_combine(hash, hash_string(node->funccall.name));
+            hash = hash_combine(hash, (uint64_t)node->funccall.arguments->size);
+            FOR_EACH(ASTNode*, arg, node->funccall.arguments) {
+                hash = hash_combine(hash, ENTRY(arg)->hash);
+            }
+            break;
+        case LITERAL:
+            hash = hash_combine(hash, (uint64_t)node->literal.type);
+            switch (node->literal.type) {
+                case INT:  hash = hash_combine(hash, (uint64_t)(uint32_t)node->literal.integer); break;
+                case BOOL: hash = hash_combine(hash, (uint64_t)node->literal.boolean); break;
+                case STR:  hash = hash_combine(hash, hash_string(node->literal.string)); break;
+                default:   break;
+            }
+            break;
+        default:
+            break;
+    }
+    return hash;
+}
+
+/**
+ * @brief Check whether an expression node has the same shape as an existing entry
+ *
+ * Because children are hash-consed first, child subtrees are identical if and
+ * only if they share the same entry, so this comparison is shallow.
+ */
+bool HashCons_same_shape (ASTNode* node, HashConsEntry* entry)
+{
+    ASTNode* other = entry->canonical;
+    if (node->type != other->type) {
+        return false;
+    }
+    switch (node->type) {
+        case BINARYOP:
+            return node->binaryop.operator == other->binaryop.operator &&
+                   ENTRY(node->binaryop.left)  == ENTRY(other->binaryop.left) &&
+                   ENTRY(node->binaryop.right) == ENTRY(other->binaryop.right);
+        case UNARYOP:
+            return node->unaryop.operator == other->unaryop.operator &&
+                   ENTRY(node->unaryop.child) == ENTRY(other->unaryop.child);
+        case LOCATION:
+            if (strncmp(node->location.name, other->location.name, MAX_ID_LEN) != 0) {
+                return false;
+            }
+            if (node->location.index == NULL || other->location.index == NULL) {
+                return node->location.index == other->location.index;
+            }
+            return ENTRY(node->location.index) == ENTRY(other->location.index);
+        case FUNCCALL: {
+            if (strncmp(node->funccall.name, other->funccall.name, MAX_ID_LEN) != 0 ||
+                node->funccall.arguments->size != other->funccall.arguments->size) {
+                return false;
+            }
+            ASTNode* b = other->funccall.arguments->head;
+            FOR_EACH(ASTNode*, a, node->funccall.arguments) {
+                if (ENTRY(a) != ENTRY(b)) {
+                    return false;
+                }
+                b = b->next;
+            }
+            return true;
+        }
+        case LITERAL:
+            if (node->literal.type != other->literal.type) {
+                return false;
+            }
+            switch (node->literal.type) {
+                case INT:  return node->literal.integer == other->literal.integer;
+                case BOOL: return node->literal.boolean == other->literal.boolean;
+                case STR:  return strncmp(node->literal.string, other->literal.string, MAX_LINE_LEN) == 0;
+                default:   return true;
+            }
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Count the nodes in an expression subtree from its children's entries
+ */
+int HashCons_subtree_size (ASTNode* node)
+{
+    int size = 1;
+    switch (node->type) {
+        case BINARYOP:
+            size += ENTRY(node->binaryop.left)->size + ENTRY(node->binaryop.right)->size;
+            break;
+        case UNARYOP:
+            size += ENTRY(node->unaryop.child)->size;
+            break;
+        case LOCATION:
+            if (node->location.index != NULL) {
+                size += ENTRY(node->location.index)->size;
+            }
+            break;
+        case FUNCCALL:
+            FOR_EACH(ASTNode*, arg, node->funccall.arguments) {
+                size += ENTRY(arg)->size;
+            }
+            break;
+        default:
+            break;
+    }
+    return size;
+}
+
+void HashConsVisitor_visit_expression (NodeVisitor* visitor, ASTNode* node)
+{
+    HashConsTable* table = TABLE;
+    uint64_t hash = HashCons_hash_node(node);
+    table->expression_nodes++;
+
+    /* look for an existing entry with the same shape in the same scope */
+    size_t b = (size_t)(hash % (uint64_t)table->capacity);
+    for (HashConsEntry* e = table->buckets[b]; e != NULL; e = e->next) {
+        if (e->hash == hash && e->scope == node->scope && HashCons_same_shape(node, e)) {
+            e->occurrences++;
+            ASTNode_set_attribute(node, "hashcons", e, dummy_free);
+            return;
+        }
+    }
+
+    /* new shape; this node becomes its canonical representative */
+    HashConsEntry* entry = (HashConsEntry*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(HashConsEntry));
+    CHECK_MALLOC_PTR(entry)
+    entry->hash = hash;
+    entry->scope = node->scope;
+    entry->canonical = node;
+    entry->occurrences = 1;
+    entry->size = HashCons_subtree_size(node);
+    entry->checked = false;
+    entry->clean = false;
+    entry->type = UNKNOWN;
+    entry->reuses = 0;
+    entry->next = table->buckets[b];
+    table->buckets[b] = entry;
+    table->size++;
+    ASTNode_set_attribute(node, "hashcons", entry, dummy_free);
+
+    if (table->size > table->capacity * 2) {
+        HashConsTable_grow(table);
+    }
+}
+
+NodeVisitor* HashConsVisitor_new (HashConsTable* table)
+{
+    NodeVisitor* v = NodeVisitor_new();
+    /* use "data" field to store the table (owned by the caller); scopes come
+     * from the nodes' scope pointers */
+    v->data = table;
+    v->postvisit_binaryop = HashConsVisitor_visit_expression;
+    v->postvisit_unaryop  = HashConsVisitor_visit_expression;
+    v->postvisit_location = HashConsVisitor_visit_expression;
+    v->postvisit_funccall = HashConsVisitor_visit_expression;
+    v->postvisit_literal  = HashConsVisitor_visit_expression;
+    return v;
+}
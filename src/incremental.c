@@ -0,0 +1,480 @@
+#include "incremental.h"
+
+/*
+ * FUNCTION FINGERPRINTS
+ */
+
+/**
+ * @brief State for the fingerprint visitor
+ */
+typedef struct FingerprintData
+{
+    uint64_t hash;              /**< @brief Running hash of the nodes visited so far */
+    int base_line;              /**< @brief First line of the function */
+    uint64_t* references;       /**< @brief Hashes of used names (in visit order) */
+    int num_references;         /**< @brief Number of used names */
+    int capacity;               /**< @brief Allocated length of @c references */
+} FingerprintData;
+
+#define DATA ((FingerprintData*)visitor->data)
+
+/**
+ * @brief Record a use of a name
+ */
+void Fingerprint_add_reference (NodeVisitor* visitor, uint64_t name)
+{
+    if (DATA->num_references == DATA->capacity) {
+        DATA->capacity *= 2;
+        DATA->references = (uint64_t*)Memory_realloc(DATA->references, DATA->capacity, sizeof(uint64_t));
+        CHECK_MALLOC_PTR(DATA->references)
+    }
+    DATA->references[DATA->num_references++] = name;
+}
+
+/**
+ * @brief Mix one node into the fingerprint
+ *
+ * Visiting in preorder and including the number of children of every kind
+ * makes the sequence of node hashes unambiguous.
+ */
+void Fingerprint_previsit (NodeVisitor* visitor, ASTNode* node)
+{
+    uint64_t hash = hash_combine(DATA->hash, (uint64_t)node->type);
+    hash = hash_combine(hash, (uint64_t)(node->source_line - DATA->base_line));
+    switch (node->type) {
+        case VARDECL:
+            hash = hash_combine(hash, hash_string(node->vardecl.name));
+            hash = hash_combine(hash, (uint64_t)node->vardecl.type);
+            hash = hash_combine(hash, (uint64_t)node->vardecl.is_array);
+            hash = hash_combine(hash, (uint64_t)node->vardecl.array_length);
+            break;
+        case FUNCDECL:
+            hash = hash_combine(hash, hash_string(node->funcdecl.name));
+            hash = hash_combine(hash, (uint64_t)node->funcdecl.return_type);
+            FOR_EACH(Parameter*, p, node->funcdecl.parameters) {
+                hash = hash_combine(hash, hash_string(p->name));
+                hash = hash_combine(hash, (uint64_t)p->type);
+            }
+            break;
+        case BLOCK:
+            hash = hash_combine(hash, (uint64_t)NodeList_size(node->block.variables));
+            hash = hash_combine(hash, (uint64_t)NodeList_size(node->block.statements));
+            break;
+        case CONDITIONAL:
+            hash = hash_combine(hash, (uint64_t)(node->conditional.else_block != NULL));
+            break;
+        case RETURNSTMT:
+            hash = hash_combine(hash, (uint64_t)(node->funcreturn.value != NULL));
+            break;
+        case BINARYOP:
+            hash = hash_combine(hash, (uint64_t)node->binaryop.operator);
+            break;
+        case UNARYOP:
+            hash = hash_combine(hash, (uint64_t)node->unaryop.operator);
+            break;
+        case LOCATION:
+            hash = hash_combine(hash, hash_string(node->location.name));
+            hash = hash_combine(hash, (uint64_t)(node->location.index != NULL));
+            Fingerprint_add_reference(visitor, hash_string(node->location.name));
+            break;
+        case FUNCCALL:
+            hash = hash_combine(hash, hash_string(node->funccall.name));
+            hash = hash_combine(hash, (uint64_t)NodeList_size(node->funccall.arguments));
+            Fingerprint_add_reference(visitor, hash_string(node->funccall.name));
+            break;
+        case LITERAL:
+            hash = hash_combine(hash, (uint64_t)node->literal.type);
+            switch (node->literal.type) {
+                case INT:  hash = hash_combine(hash, (uint64_t)(uint32_t)node->literal.integer); break;
+                case BOOL: hash = hash_combine(hash, (uint64_t)node->literal.boolean); break;
+                case STR:  hash = hash_combine(hash, hash_string(node->literal.string)); break;
+                default:   break;
+            }
+            break;
+        default:
+            break;
+    }
+    DATA->hash = hash;
+}
+
+#undef DATA
+
+/**
+ * @brief Summarize a function declaration (without any errors)
+ */
+void FunctionSummary_init (FunctionSummary* summary, ASTNode* declaration)
+{
+    FingerprintData data;
+    data.hash = 0;
+    data.base_line = declaration->source_line;
+    data.capacity = 16;
+    data.num_references = 0;
+    data.references = (uint64_t*)Memory_calloc(MEM_ANALYSIS, data.capacity, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(data.references)
+
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = &data;
+    v->previsit_default = Fingerprint_previsit;
+    NodeVisitor_traverse_and_free(v, declaration);
+
+    summary->declaration = declaration;
+    summary->fingerprint = data.hash;
+    summary->references = data.references;
+    summary->num_references = data.num_references;
+    summary->errors = NULL;
+}
+
+/*
+ * CHANGED DECLARATIONS
+ */
+
+/**
+ * @brief Hash everything about a global declaration that other functions can
+ * observe
+ */
+uint64_t DecafSession_hash_declaration (const Symbol* symbol)
+{
+    uint64_t hash = hash_combine(0, (uint64_t)symbol->symbol_type);
+    hash = hash_combine(hash, (uint64_t)symbol->type);
+    hash = hash_combine(hash, (uint64_t)symbol->length);
+    if (symbol->parameters != NULL) {
+        hash = hash_combine(hash, (uint64_t)symbol->parameters->size);
+        for (int i = 0; i < symbol->parameters->size; i++) {
+            hash = hash_combine(hash, (uint64_t)symbol->parameters->types[i]);
+        }
+    }
+    return hash;
+}
+
+int compare_uint64 (const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+/**
+ * @brief Find the global names whose declarations differ between two versions
+ *
+ * @param before Global scope of the previous version
+ * @param after Global scope of the new version
+ * @param count Set to the number of changed names
+ * @returns Sorted hashes of the changed names
+ */
+uint64_t* DecafSession_changed_globals (const SymbolTable* before, const SymbolTable* after, int* count)
+{
+    uint64_t* changed = (uint64_t*)Memory_calloc(MEM_ANALYSIS, before->size + after->size + 1, sizeof(uint64_t));
+    CHECK_MALLOC_PTR(changed)
+    *count = 0;
+    for (int i = 0; i < after->size; i++) {
+        const char* name = after->symbols[i]->name;
+        Symbol* old = SymbolTable_lookup(before, name);
+        if (old == NULL || DecafSession_hash_declaration(old) !=
+                DecafSession_hash_declaration(SymbolTable_lookup(after, name))) {
+            changed[(*count)++] = hash_string(name);
+        }
+    }
+    for (int i = 0; i < before->size; i++) {
+        if (SymbolTable_lookup(after, before->symbols[i]->name) == NULL) {
+            changed[(*count)++] = hash_string(before->symbols[i]->name);
+        }
+    }
+    qsort(changed, *count, sizeof(uint64_t), compare_uint64);
+    return changed;
+}
+
+/**
+ * @brief Check whether a function uses any changed global name
+ */
+bool FunctionSummary_uses_any (const FunctionSummary* summary, const uint64_t* changed, int num_changed)
+{
+    for (int i = 0; num_changed > 0 && i < summary->num_references; i++) {
+        if (bsearch(&summary->references[i], changed, num_changed, sizeof(uint64_t), compare_uint64) != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * ERROR REUSE
+ */
+
+/**
+ * @brief Growable array of nodes in preorder
+ */
+typedef struct NodeArray
+{
+    ASTNode** nodes;            /**< @brief Nodes in preorder */
+    int size;                   /**< @brief Number of nodes */
+    int capacity;               /**< @brief Allocated length of @c nodes */
+} NodeArray;
+
+void NodeArray_previsit (NodeVisitor* visitor, ASTNode* node)
+{
+    NodeArray* array = (NodeArray*)visitor->data;
+    if (array->size == array->capacity) {
+        array->capacity *= 2;
+        array->nodes = (ASTNode**)Memory_realloc(array->nodes, array->capacity, sizeof(ASTNode*));
+        CHECK_MALLOC_PTR(array->nodes)
+    }
+    array->nodes[array->size++] = node;
+}
+
+/**
+ * @brief List all nodes of a subtree in preorder
+ */
+void NodeArray_collect (NodeArray* array, ASTNode* root)
+{
+    array->size = 0;
+    array->capacity = 64;
+    array->nodes = (ASTNode**)Memory_calloc(MEM_ANALYSIS, array->capacity, sizeof(ASTNode*));
+    CHECK_MALLOC_PTR(array->nodes)
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = array;
+    v->previsit_default = NodeArray_previsit;
+    NodeVisitor_traverse_and_free(v, root);
+}
+
+/**
+ * @brief Find the symbol in a new node that corresponds to one in an old node
+ */
+const Symbol* DecafSession_remap_symbol (const Symbol* symbol, ASTNode* from, ASTNode* to)
+{
+    if (symbol == NULL) {
+        return NULL;
+    }
+    switch (to->type) {
+        case LOCATION: return to->location.symbol;
+        case FUNCCALL: return to->funccall.symbol;
+        default:       break;
+    }
+    /* duplicate declarations are reported on the node that owns the scope */
+    for (int i = 0; i < from->scope->size && i < to->scope->size; i++) {
+        if (from->scope->symbols[i] == symbol) {
+            return to->scope->symbols[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Move a function's errors from its old declaration to a new one
+ *
+ * Both declarations have the same fingerprint, so their nodes correspond one
+ * to one in preorder.
+ *
+ * @returns Errors referring to @p to, or @c NULL if they cannot be moved
+ */
+ErrorList* DecafSession_remap_errors (ErrorList* errors, ASTNode* from, ASTNode* to)
+{
+    ErrorList* remapped = ErrorList_new();
+    if (ErrorList_is_empty(errors)) {
+        return remapped;
+    }
+    NodeArray before, after;
+    NodeArray_collect(&before, from);
+    NodeArray_collect(&after, to);
+    bool valid = (before.size == after.size);
+    FOR_EACH(AnalysisError*, err, errors) {
+        int index = 0;
+        while (valid && index < before.size && before.nodes[index] != err->node) {
+            index++;
+        }
+        if (!valid || index == before.size || after.nodes[index]->type != err->node->type) {
+            valid = false;
+            break;
+        }
+        ASTNode* node = after.nodes[index];
+        ErrorList_report(remapped, err->code, node, DecafSession_remap_symbol(err->symbol, err->node, node),
+                         err->types[0], err->types[1]);
+    }
+    Memory_free(before.nodes);
+    Memory_free(after.nodes);
+    if (!valid) {
+        ErrorList_free(remapped);
+        return NULL;
+    }
+    return remapped;
+}
+
+/*
+ * SESSIONS
+ */
+
+DecafSession* DecafSession_new (DecafContext* context, int num_threads)
+{
+    DecafSession* session = (DecafSession*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(DecafSession));
+    CHECK_MALLOC_PTR(session)
+    session->context = context;
+    session->num_threads = num_threads;
+    session->tree = NULL;
+    session->functions = NULL;
+    session->num_functions = 0;
+    session->result.tree = NULL;
+    session->result.globals = NULL;
+    session->result.errors = NULL;
+    session->checked_functions = 0;
+    session->reused_functions = 0;
+    return session;
+}
+
+/**
+ * @brief Deallocate the summaries of a version
+ */
+void DecafSession_free_summaries (FunctionSummary* functions, int num_functions)
+{
+    for (int i = 0; i < num_functions; i++) {
+        Memory_free(functions[i].references);
+        if (functions[i].errors != NULL) {
+            ErrorList_free(functions[i].errors);
+        }
+    }
+    Memory_free(functions);
+}
+
+/**
+ * @brief Find the old summary for a function by name
+ *
+ * @param slots Open-addressing map from name to summary index (-1 if empty)
+ * @param mask Number of slots minus one (a power of two minus one)
+ */
+int DecafSession_find_slot (DecafSession* session, int* slots, int mask, const char* name)
+{
+    int slot = (int)(hash_string(name) & (uint64_t)mask);
+    while (slots[slot] >= 0 &&
+            strcmp(session->functions[slots[slot]].declaration->funcdecl.name, name) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Decide which functions of a new version can reuse their old errors
+ *
+ * @param session Session holding the previous version
+ * @param tree New version
+ * @param functions Summaries of the new version's functions
+ * @param cache Set to the reused errors for clean functions (left @c NULL for
+ * dirty ones)
+ * @returns Number of reused functions
+ */
+int DecafSession_reuse (DecafSession* session, ASTNode* tree, FunctionSummary* functions,
+                        int num_functions, ErrorList** cache)
+{
+    if (session->tree == NULL || session->num_functions == 0) {
+        return 0;
+    }
+
+    /* map names to the previous version's functions (first declaration only) */
+    int capacity = 1;
+    while (capacity < 2 * session->num_functions) {
+        capacity *= 2;
+    }
+    int* slots = (int*)Memory_calloc(MEM_ANALYSIS, capacity, sizeof(int));
+    CHECK_MALLOC_PTR(slots)
+    for (int s = 0; s < capacity; s++) {
+        slots[s] = -1;
+    }
+    for (int i = 0; i < session->num_functions; i++) {
+        int slot = DecafSession_find_slot(session, slots, capacity - 1,
+                                          session->functions[i].declaration->funcdecl.name);
+        if (slots[slot] < 0) {
+            slots[slot] = i;
+        }
+    }
+    bool* matched = (bool*)Memory_calloc(MEM_ANALYSIS, session->num_functions, sizeof(bool));
+    CHECK_MALLOC_PTR(matched)
+
+    int num_changed = 0;
+    uint64_t* changed = DecafSession_changed_globals(session->tree->scope, tree->scope, &num_changed);
+
+    int reused = 0;
+    for (int i = 0; i < num_functions; i++) {
+        FunctionSummary* now = &functions[i];
+        int slot = DecafSession_find_slot(session, slots, capacity - 1, now->declaration->funcdecl.name);
+        if (slots[slot] < 0 || matched[slots[slot]]) {
+            continue;
+        }
+        matched[slots[slot]] = true;
+        FunctionSummary* then = &session->functions[slots[slot]];
+        if (then->errors == NULL || then->fingerprint != now->fingerprint ||
+                FunctionSummary_uses_any(now, changed, num_changed)) {
+            continue;
+        }
+        cache[i] = DecafSession_remap_errors(then->errors, then->declaration, now->declaration);
+        if (cache[i] != NULL) {
+            reused++;
+        }
+    }
+
+    Memory_free(changed);
+    Memory_free(matched);
+    Memory_free(slots);
+    return reused;
+}
+
+DecafStatus DecafSession_update (DecafSession* session, const char* text, size_t length)
+{
+    DecafResult parsed;
+    DecafStatus status = decaf_parse_buffer(session->context, text, length, &parsed);
+    if (session->result.errors != NULL) {
+        ErrorList_free(session->result.errors);
+    }
+    session->result.tree = NULL;
+    session->result.globals = NULL;
+    session->result.errors = parsed.errors;
+    session->checked_functions = 0;
+    session->reused_functions = 0;
+    if (status != DECAF_OK) {
+        /* keep the last version that parsed as the base for the next one */
+        return status;
+    }
+    DecafContext* previous = DecafContext_set_current(session->context);
+    ASTNode* tree = parsed.tree;
+
+    /* summarize the new version and find the functions that need checking */
+    int num_functions = NodeList_size(tree->program.functions);
+    FunctionSummary* functions = (FunctionSummary*)Memory_calloc(MEM_ANALYSIS, num_functions + 1,
+                                                                  sizeof(FunctionSummary));
+    CHECK_MALLOC_PTR(functions)
+    ErrorList** cache = (ErrorList**)Memory_calloc(MEM_ANALYSIS, num_functions + 1, sizeof(ErrorList*));
+    CHECK_MALLOC_PTR(cache)
+    int i = 0;
+    FOR_EACH(ASTNode*, func, tree->program.functions) {
+        FunctionSummary_init(&functions[i++], func);
+    }
+    session->reused_functions = DecafSession_reuse(session, tree, functions, num_functions, cache);
+    session->checked_functions = num_functions - session->reused_functions;
+
+    /* check the dirty functions; the cache then holds every function's errors */
+    ErrorList_append_all(session->result.errors, analyze_incremental(tree, session->num_threads, cache));
+    for (i = 0; i < num_functions; i++) {
+        functions[i].errors = cache[i];
+    }
+    Memory_free(cache);
+
+    /* the previous version is no longer needed */
+    DecafSession_free_summaries(session->functions, session->num_functions);
+    if (session->tree != NULL) {
+        ASTNode_free(session->tree);
+    }
+    session->tree = tree;
+    session->functions = functions;
+    session->num_functions = num_functions;
+    session->result.tree = tree;
+    session->result.globals = tree->scope;
+    DecafContext_set_current(previous);
+    return (ErrorList_is_empty(session->result.errors) ? DECAF_OK : DECAF_ANALYSIS_ERRORS);
+}
+
+void DecafSession_free (DecafSession* session)
+{
+    DecafSession_free_summaries(session->functions, session->num_functions);
+    if (session->tree != NULL) {
+        ASTNode_free(session->tree);
+    }
+    if (session->result.errors != NULL) {
+        ErrorList_free(session->result.errors);
+    }
+    Memory_free(session);
+}
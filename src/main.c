@@ -3,61 +3,176 @@
  * @brief Compiler driver
  */
 
-#include "p1-lexer.h"
-#include "p2-parser.h"
-#include "p3-analysis.h"
+#include "compile.h"
+#include "context.h"
+#include "server.h"
+#include "batch.h"
 
 /**
- * @brief Error message buffer
+ * @brief Print command-line usage information
+ *
+ * @param program Name of the compiler executable
  */
-char decaf_error_msg[MAX_ERROR_LEN];
+void print_usage (const char* program)
+{
+    fprintf(stderr, "Usage: %s [--hash-cons] [--mem-report] [--fold] [--dce] [--check-init] [--allocate] [--xref] [--callgraph] [--cfg] [--threads=N] [--max-errors=N] [--fail-fast] <decaf-filename>\n", program);
+    fprintf(stderr, "       %s [--fold] [--dce] [--check-init] [--allocate] [--xref] [--callgraph] [--cfg] [--max-errors=N] [--fail-fast] [-j N] <file|@listfile>...\n", program);
+    fprintf(stderr, "       (either form may add --cache=DIR [--cache-size=BYTES] [--cache-stats])\n");
+    fprintf(stderr, "       %s [--max-errors=N] [--fail-fast] --server\n", program);
+}
 
 /**
- * @brief Data structure used by @c setjmp / @c longjmp for exception handling
+ * @brief Copy a number of bytes from one stream to another
+ *
+ * @returns True if all of them could be read
  */
-jmp_buf decaf_error;
+bool copy_bytes (FILE* from, FILE* to, long size)
+{
+    char buffer[4096];
+    while (size > 0) {
+        size_t count = fread(buffer, 1, size < (long)sizeof(buffer) ? (size_t)size : sizeof(buffer), from);
+        if (count == 0) {
+            return false;
+        }
+        if (to != NULL) {
+            fwrite(buffer, 1, count, to);
+        }
+        size -= (long)count;
+    }
+    return true;
+}
 
 /**
- * @brief Throw an exception with an error message using printf syntax
+ * @brief Compile one source file
  *
- * This function is declared in common.h but must be defined here in main.c
- * because that's where the @c jmp_buf declaration is.
+ * @param text Source code
+ * @param options Settings
+ * @param output Stream for diagnostics and dumps (normally @c stdout)
+ * @param diagnostics Stream for fatal errors and statistics (normally @c stderr)
+ * @param graph Stream for the DOT rendering of the AST, or @c NULL to write
+ * it to @c ast.dot and render @c ast.png
+ * @returns Exit status of the run
  */
-void Error_throw_printf (const char* format, ...)
+int compile_file (char* text, const CompileOptions* options, FILE* output, FILE* diagnostics, FILE* graph)
 {
-    /* delegate to vsnprintf for error message formatting */
-    va_list args;
-    va_start(args, format);
-    vsnprintf(decaf_error_msg, MAX_ERROR_LEN, format, args);
-    va_end(args);
+    if (graph != NULL) {
+        DecafStatus status = compile_source(text, options, output, diagnostics, graph);
+        return (status == DECAF_SYNTAX_ERROR ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
 
-    /* jump to location saved by setjmp */
-    longjmp(decaf_error, 1);
+    /* a run that stops in the front end leaves any earlier ast.dot alone */
+    FILE* rendering = tmpfile();
+    DecafStatus status = compile_source(text, options, output, diagnostics, rendering);
+    if (rendering != NULL && status != DECAF_SYNTAX_ERROR) {
+        long size = ftell(rendering);
+        rewind(rendering);
+        FILE* graph_file = fopen("ast.dot", "w");
+        if (graph_file != NULL) {
+            copy_bytes(rendering, graph_file, size);
+            fclose(graph_file);
+        }
+        system("dot -Tpng -o ast.png ast.dot");
+    }
+    if (rendering != NULL) {
+        fclose(rendering);
+    }
+    return (status == DECAF_SYNTAX_ERROR ? EXIT_FAILURE : EXIT_SUCCESS);
 }
 
 /**
- * @brief Read all text data from a file
+ * @brief Reproduce a recorded run (see @ref compile_file_cached)
  *
- * @param filename Name of file to read
- * @param text String buffer destination (must be #MAX_FILE_SIZE characters long)
- * @returns True if and only if the file read was successful.
+ * @returns Exit status of the run, or -1 if the record is damaged
  */
-bool read_file (const char* filename, char* text)
+int replay_run (FILE* record)
 {
-    FILE* input = fopen(filename, "r");
-    if (input == NULL) {
-        return false;
-    }
-    size_t nchars = 0;
-    char* p = text;
-    int c;
-    while (nchars < MAX_FILE_SIZE && (c = fgetc(input)) != EOF) {
-        *p++ = (char)c;
-        nchars++;
-    }
-    *p = '\0';
-    fclose(input);
-    return true;
+    char header[MAX_LINE_LEN];
+    int status;
+    long sizes[3];
+    if (fgets(header, sizeof(header), record) == NULL ||
+            sscanf(header, "decaf-run %d %ld %ld %ld", &status, &sizes[0], &sizes[1], &sizes[2]) != 4) {
+        return -1;
+    }
+
+    /* check the whole record before printing any of it */
+    long start = ftell(record);
+    if (!copy_bytes(record, NULL, sizes[0] + sizes[1] + sizes[2])) {
+        return -1;
+    }
+    fseek(record, start, SEEK_SET);
+    copy_bytes(record, stdout, sizes[0]);
+    copy_bytes(record, stderr, sizes[1]);
+    if (sizes[2] > 0) {
+        FILE* graph_file = fopen("ast.dot", "w");
+        copy_bytes(record, graph_file, sizes[2]);
+        if (graph_file != NULL) {
+            fclose(graph_file);
+        }
+        system("dot -Tpng -o ast.png ast.dot");
+    }
+    return status;
+}
+
+/**
+ * @brief Compile one source file through a result cache
+ *
+ * A cache entry records everything a run produces: its exit status, its
+ * standard output and standard error, and the AST graph. A replayed run is
+ * therefore indistinguishable from a compiled one.
+ *
+ * @returns Exit status of the run
+ */
+int compile_file_cached (ResultCache* cache, char* text, const CompileOptions* options)
+{
+    char settings[MAX_LINE_LEN];
+    snprintf(settings, sizeof(settings), "single max_errors=%d hash_cons=%d fold=%d dce=%d "
+             "check_init=%d allocate=%d xref=%d callgraph=%d cfg=%d", options->max_errors,
+             options->hash_cons ? 1 : 0, options->fold ? 1 : 0, options->dce ? 1 : 0,
+             options->check_init ? 1 : 0, options->allocate ? 1 : 0, options->xref ? 1 : 0,
+             options->callgraph ? 1 : 0, options->cfg ? 1 : 0);
+    uint64_t key = ResultCache_key(text, strlen(text), settings);
+
+    FILE* record = tmpfile();
+    if (record == NULL) {
+        return compile_file(text, options, stdout, stderr, NULL);
+    }
+    bool failed;
+    int status = -1;
+    if (ResultCache_replay(cache, key, record, &failed)) {
+        rewind(record);
+        status = replay_run(record);
+    }
+    if (status < 0) {
+        /* record the run's outputs, store them, and then play them back */
+        FILE* output = tmpfile();
+        FILE* diagnostics = tmpfile();
+        FILE* graph = tmpfile();
+        if (output == NULL || diagnostics == NULL || graph == NULL) {
+            fprintf(stderr, "ERROR: could not create temporary output\n");
+            exit(EXIT_FAILURE);
+        }
+        status = compile_file(text, options, output, diagnostics, graph);
+        fclose(record);
+        record = tmpfile();
+        if (record == NULL) {
+            fprintf(stderr, "ERROR: could not create temporary output\n");
+            exit(EXIT_FAILURE);
+        }
+        fprintf(record, "decaf-run %d %ld %ld %ld\n", status, ftell(output), ftell(diagnostics), ftell(graph));
+        FILE* streams[] = { output, diagnostics, graph };
+        for (int i = 0; i < 3; i++) {
+            long size = ftell(streams[i]);
+            rewind(streams[i]);
+            copy_bytes(streams[i], record, size);
+            fclose(streams[i]);
+        }
+        fflush(record);
+        ResultCache_store(cache, key, record, status != EXIT_SUCCESS);
+        rewind(record);
+        status = replay_run(record);
+    }
+    fclose(record);
+    return status;
 }
 
 /**
@@ -70,81 +185,165 @@ bool read_file (const char* filename, char* text)
  */
 int main(int argc, char** argv)
 {
-    /* check for filename */
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <decaf-filename>\n", argv[0]);
+    /* check for options and filenames */
+    int num_files = 0;
+    int file_capacity = 8;
+    char** files = (char**)Memory_calloc(MEM_TOKEN, file_capacity, sizeof(char*));
+    CHECK_MALLOC_PTR(files)
+    bool batch = false;
+    int jobs = 1;
+    bool hash_cons = false;
+    bool mem_report = false;
+    bool fold = false;
+    bool dce = false;
+    bool check_init = false;
+    bool allocate = false;
+    bool xref = false;
+    bool callgraph = false;
+    bool cfg = false;
+    int threads = 1;
+    int max_errors = 0;
+    bool server = false;
+    const char* cache_dir = NULL;
+    size_t cache_size = RESULT_CACHE_DEFAULT_SIZE;
+    bool cache_stats = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hash-cons") == 0) {
+            hash_cons = true;
+        } else if (strcmp(argv[i], "--mem-report") == 0) {
+            mem_report = true;
+        } else if (strcmp(argv[i], "--fold") == 0) {
+            fold = true;
+        } else if (strcmp(argv[i], "--dce") == 0) {
+            dce = true;
+        } else if (strcmp(argv[i], "--check-init") == 0) {
+            check_init = true;
+        } else if (strcmp(argv[i], "--allocate") == 0) {
+            allocate = true;
+        } else if (strcmp(argv[i], "--xref") == 0) {
+            xref = true;
+        } else if (strcmp(argv[i], "--callgraph") == 0) {
+            callgraph = true;
+        } else if (strcmp(argv[i], "--cfg") == 0) {
+            cfg = true;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0 && atoi(argv[i] + 10) > 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--max-errors=", 13) == 0 && atoi(argv[i] + 13) >= 0) {
+            max_errors = atoi(argv[i] + 13);
+        } else if (strcmp(argv[i], "--fail-fast") == 0) {
+            max_errors = 1;
+        } else if (strcmp(argv[i], "--server") == 0) {
+            server = true;
+        } else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != '\0') {
+            cache_dir = argv[i] + 8;
+        } else if (strncmp(argv[i], "--cache-size=", 13) == 0 && atol(argv[i] + 13) > 0) {
+            cache_size = (size_t)atol(argv[i] + 13);
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            cache_stats = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            jobs = atoi(argv[++i]);
+            batch = true;
+        } else if (strncmp(argv[i], "-j", 2) == 0 && atoi(argv[i] + 2) > 0) {
+            jobs = atoi(argv[i] + 2);
+            batch = true;
+        } else if (argv[i][0] == '@') {
+            if (!batch_read_list(argv[i] + 1, &files, &num_files, &file_capacity)) {
+                fprintf(stderr, "Could not read file list: %s\n", argv[i] + 1);
+                return EXIT_FAILURE;
+            }
+            batch = true;
+        } else if (argv[i][0] != '-') {
+            if (num_files == file_capacity) {
+                file_capacity *= 2;
+                files = (char**)Memory_realloc(files, file_capacity, sizeof(char*));
+                CHECK_MALLOC_PTR(files)
+            }
+            size_t length = strlen(argv[i]);
+            files[num_files] = (char*)Memory_calloc(MEM_TOKEN, length + 1, sizeof(char));
+            CHECK_MALLOC_PTR(files[num_files])
+            memcpy(files[num_files++], argv[i], length);
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    batch = (batch || num_files > 1);
+    if (server && num_files == 0 && !batch) {
+        /* answer requests on stdin until it closes */
+        DecafContext* context = DecafContext_new();
+        context->max_errors = max_errors;
+        decaf_serve(context, stdin, stdout);
+        DecafContext_free(context);
+        return EXIT_SUCCESS;
+    }
+    if (batch && num_files > 0 && !server) {
+        /* per-compilation reports would interleave, and files already run in parallel */
+        if (hash_cons || mem_report) {
+            fprintf(stderr, "%s is not supported with multiple files\n",
+                    hash_cons ? "--hash-cons" : "--mem-report");
+            return EXIT_FAILURE;
+        }
+        if (threads > 1) {
+            fprintf(stderr, "Warning: --threads is ignored with multiple files (use -j N)\n");
+            threads = 1;
+        }
+    }
+    if (batch && num_files > 0 && !server) {
+        /* many files: one job per file, outputs grouped in the order given */
+        BatchOptions options = { { hash_cons, mem_report, fold, dce, check_init, allocate, xref,
+                                   callgraph, cfg, threads, max_errors }, jobs, batch, NULL };
+        if (cache_dir != NULL) {
+            options.cache = ResultCache_open(cache_dir, cache_size);
+            if (options.cache == NULL) {
+                fprintf(stderr, "Could not open cache directory: %s\n", cache_dir);
+                return EXIT_FAILURE;
+            }
+        }
+        int failures = decaf_batch(files, num_files, &options, stdout);
+        if (options.cache != NULL && cache_stats) {
+            ResultCache_print_stats(options.cache, stderr);
+        }
+        ResultCache_close(options.cache);
+        for (int i = 0; i < num_files; i++) {
+            Memory_free(files[i]);
+        }
+        Memory_free(files);
+        return (failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (num_files != 1 || batch || server) {
+        print_usage(argv[0]);
         return EXIT_FAILURE;
     }
-    char* filename = argv[argc-1];
+    char* filename = files[0];
 
     /* read file */
-    char text[MAX_FILE_SIZE];
-    if (!read_file(filename, text)) {
-        fprintf(stderr, "Could not read file: %s", filename);
+    char text[MAX_FILE_SIZE + 1];
+    ReadStatus read = read_file(filename, text);
+    if (read == READ_TOO_LARGE) {
+        fprintf(stderr, "File too large (over %d bytes): %s\n", MAX_FILE_SIZE, filename);
         exit(EXIT_FAILURE);
-    }
-
-    /* FRONT END */
-
-    TokenQueue* tokens = NULL;
-    ASTNode* tree = NULL;
-
-    /* fatal errors are possible in the front end, so check for them */
-    if (setjmp(decaf_error) == 0) {
-
-        /* PROJECT 1: lexer */
-        tokens = lex(text);
-
-        /* PROJECT 2: parser */
-        tree = parse(tokens);
-
-    } else {
-
-        /* handle fatal error: print message and clean up */
-        fprintf(stderr, "%s", decaf_error_msg);
-        if (tokens   != NULL) TokenQueue_free(tokens);
-        if (tree     != NULL) ASTNode_free(tree);
+    } else if (read != READ_OK) {
+        fprintf(stderr, "Could not read file: %s", filename);
         exit(EXIT_FAILURE);
     }
+    Memory_free(filename);
+    Memory_free(files);
 
-    /* clean up tokens (no longer needed) */
-    TokenQueue_free(tokens);
-    tokens = NULL;
-
-    /* set up parent links and calculate node depths */
-    NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
-    NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
-
-    /* MIDDLE END */
-
-    /* build symbol tables */
-    NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
-
-    /* PROJECT 3: analysis */
-    ErrorList* errors = analyze(tree);
-
-    /* output */
-    FOR_EACH(AnalysisError*, err, errors) {
-        printf("%s\n", err->message);
+    CompileOptions options = { hash_cons, mem_report, fold, dce, check_init, allocate, xref,
+                               callgraph, cfg, threads, max_errors };
+    if (cache_dir == NULL || mem_report) {
+        /* a memory report describes an actual compilation, so it bypasses the cache */
+        return compile_file(text, &options, stdout, stderr, NULL);
     }
-
-    /* print symbol tables if there are no errors */
-    if (ErrorList_size(errors) == 0) {
-        NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new(stdout), tree);
+    ResultCache* cache = ResultCache_open(cache_dir, cache_size);
+    if (cache == NULL) {
+        fprintf(stderr, "Could not open cache directory: %s\n", cache_dir);
+        return EXIT_FAILURE;
     }
-
-    /* generate graphical AST */
-    FILE* graph_file = fopen("ast.dot", "w");
-    if (graph_file != NULL) {
-        NodeVisitor_traverse_and_free(GenerateASTGraph_new(graph_file), tree);
-        fclose(graph_file);
+    int status = compile_file_cached(cache, text, &options);
+    if (cache_stats) {
+        ResultCache_print_stats(cache, stderr);
     }
-    system("dot -Tpng -o ast.png ast.dot");
-
-    /* clean up */
-    ASTNode_free(tree);
-    ErrorList_free(errors);
-    errors = NULL;
-
-    return EXIT_SUCCESS;
+    ResultCache_close(cache);
+    return status;
 }
@@ -30,7 +30,7 @@ typedef struct AnalysisData
  */
 AnalysisData *AnalysisData_new()
 {
-    AnalysisData *data = (AnalysisData *)calloc(1, sizeof(AnalysisData));
+    AnalysisData *data = (AnalysisData *)Memory_calloc(MEM_ANALYSIS, 1, sizeof(AnalysisData));
     CHECK_MALLOC_PTR(data);
     data->errors = ErrorList_new();
     return data;
@@ -47,7 +47,7 @@ void AnalysisData_free(AnalysisData *data)
      * list; it needs to be returned after the analysis is complete */
 
     /* free "data" itself */
-    free(data);
+    Memory_free(data);
 }
 
 /**
@@ -63,22 +63,20 @@ void AnalysisData_free(AnalysisData *data)
 #define ERROR_LIST (((AnalysisData *)visitor->data)->errors)
 
 /**
- * @brief Wrapper for @ref lookup_symbol that reports an error if the symbol isn't found
+ * @brief Report an error and stop the traversal once the error limit is hit
  *
- * @param visitor Visitor with the error list for reporting
- * @param node AST node to begin the search at
- * @param name Name of symbol to find
- * @returns The @ref Symbol if found, otherwise @c NULL
+ * See @ref ErrorList_report for the parameters; the limit is the current
+ * context's @c max_errors.
  */
-Symbol *lookup_symbol_with_reporting(NodeVisitor *visitor, ASTNode *node, const char *name)
+void report_error(NodeVisitor *visitor, ErrorCode code, ASTNode *node, const Symbol *symbol,
+                  DecafType type0, DecafType type1)
 {
-    Symbol *symbol = lookup_symbol(node, name);
-
-    if (symbol == NULL)
+    ErrorList_report(ERROR_LIST, code, node, symbol, type0, type1);
+    int limit = DecafContext_current()->max_errors;
+    if (limit > 0 && ERROR_LIST->size >= limit)
     {
-        ErrorList_printf(ERROR_LIST, "Symbol '%s' undefined on line %d", name, node->source_line);
+        visitor->stop_traversal = true;
     }
-    return symbol;
 }
 
 /**
@@ -93,32 +91,128 @@ Symbol *lookup_symbol_with_reporting(NodeVisitor *visitor, ASTNode *node, const
 #define GET_INFERRED_TYPE(N) (DecafType) ASTNode_get_attribute(N, "type")
 
 /**
- * @brief helper method for checking for duplicate symbols
+ * @brief Copy the inferred types of a subtree onto a structurally identical one
  *
- * @param node
+ * @param from Checked subtree
+ * @param to Subtree with the same shape (its nodes get the same @c type attributes)
  */
-void find_ducplicat_helper(ASTNode *node)
+void copy_inferred_types(ASTNode *from, ASTNode *to)
 {
-    // get the current symbol table
-    SymbolTable *table = (SymbolTable *)ASTNode_get_attribute(node, "symbolTable");
-    int count = 0;
-
-    // compare each item to every other item in the list to find duplicates
-    FOR_EACH(Symbol *, s1, table->local_symbols)
+    ASTNode *node = to;
+    if (ASTNode_has_attribute(from, "type"))
     {
-        count = 0;
-        FOR_EACH(Symbol *, s2, table->local_symbols)
+        SET_INFERRED_TYPE(GET_INFERRED_TYPE(from));
+    }
+    switch (from->type)
+    {
+    case BINARYOP:
+        copy_inferred_types(from->binaryop.left, to->binaryop.left);
+        copy_inferred_types(from->binaryop.right, to->binaryop.right);
+        break;
+    case UNARYOP:
+        copy_inferred_types(from->unaryop.child, to->unaryop.child);
+        break;
+    case LOCATION:
+        if (from->location.index != NULL)
         {
-            if (strncmp(s1->name, s2->name, 30) == 0)
-            {
-                count = count + 1;
+            copy_inferred_types(from->location.index, to->location.index);
+        }
+        break;
+    case FUNCCALL:
+    {
+        ASTNode *arg = to->funccall.arguments->head;
+        FOR_EACH(ASTNode *, canonical_arg, from->funccall.arguments)
+        {
+            copy_inferred_types(canonical_arg, arg);
+            arg = arg->next;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
 
-                // make sure it hasn't found itself
-                if (count > 1)
-                {
-                    Error_throw_printf("Duplicate names %s\n", s1->name);
-                }
-            }
+/**
+ * @brief Reuse the memoized result of a structurally identical expression
+ *
+ * Only applies if a @ref HashConsVisitor_new pass has run. If the canonical
+ * occurrence of this expression's shape (in the same scope) has already been
+ * checked without errors, its types are copied onto the whole subtree and
+ * the traversal skips the checks of the rest of the subtree.
+ *
+ * @param visitor Analysis visitor
+ * @param node Expression node about to be checked
+ * @returns True if the memoized type was reused
+ */
+bool reuse_memoized_type(NodeVisitor *visitor, ASTNode *node)
+{
+    if (!ASTNode_has_attribute(node, "hashcons"))
+    {
+        return false;
+    }
+    HashConsEntry *entry = (HashConsEntry *)ASTNode_get_attribute(node, "hashcons");
+    if (entry->canonical == node)
+    {
+        // remember where this subtree's errors (if any) will start
+        entry->errors_before = ERROR_LIST->size;
+        return false;
+    }
+    if (!entry->checked || !entry->clean)
+    {
+        return false;
+    }
+    copy_inferred_types(entry->canonical, node);
+    entry->reuses++;
+    visitor->skip_subtree = true;
+    return true;
+}
+
+/**
+ * @brief Record the result of checking a canonical expression subtree
+ *
+ * @param visitor Analysis visitor
+ * @param node Expression node that was just checked
+ */
+void memoize_type(NodeVisitor *visitor, ASTNode *node)
+{
+    if (!ASTNode_has_attribute(node, "hashcons"))
+    {
+        return;
+    }
+    HashConsEntry *entry = (HashConsEntry *)ASTNode_get_attribute(node, "hashcons");
+    if (entry->canonical == node)
+    {
+        entry->type = GET_INFERRED_TYPE(node);
+        entry->clean = (ERROR_LIST->size == entry->errors_before);
+        entry->checked = true;
+    }
+}
+
+/**
+ * @brief report duplicate declarations in a node's scope
+ *
+ * Duplicates are detected by SymbolTable_insert as the table is built, so
+ * this is a single pass over the scope that reports each one once.
+ *
+ * @param visitor
+ * @param node program, funcdecl, or block node
+ */
+void report_duplicate_symbols(NodeVisitor *visitor, ASTNode *node)
+{
+    FOR_EACH(Symbol *, sym, node->scope->local_symbols)
+    {
+        if (sym->duplicate_of == NULL)
+        {
+            continue;
+        }
+        if (sym->duplicate_of->source_line == 0)
+        {
+            report_error(visitor, ERR_DUPLICATE_BUILTIN, node, sym, UNKNOWN, UNKNOWN);
+        }
+        else
+        {
+            report_error(visitor, ERR_DUPLICATE, node, sym, UNKNOWN, UNKNOWN);
         }
     }
 }
@@ -131,29 +225,31 @@ void find_ducplicat_helper(ASTNode *node)
  */
 void Analysis_previsit_program(NodeVisitor *visitor, ASTNode *node)
 {
+    Symbol *main_sym = (node != NULL ? lookup_symbol(node, "main") : NULL);
     if (node == NULL)
     {
-        ErrorList_printf(ERROR_LIST, "NULL Tree");
+        report_error(visitor, ERR_NULL_TREE, NULL, NULL, UNKNOWN, UNKNOWN);
     }
     // make sure there is a "main" function
-    else if (lookup_symbol(node, "main") == NULL)
+    else if (main_sym == NULL)
     {
-        ErrorList_printf(ERROR_LIST, "Program does not contain a 'main' function");
+        report_error(visitor, ERR_NO_MAIN, node, NULL, UNKNOWN, UNKNOWN);
     }
     // make sure the thing called "main" is a function
-    else if (lookup_symbol(node, "main")->symbol_type != FUNCTION_SYMBOL)
+    else if (main_sym->symbol_type != FUNCTION_SYMBOL)
     {
-        ErrorList_printf(ERROR_LIST, "Program does not contain a 'main' function");
+        report_error(visitor, ERR_NO_MAIN, node, NULL, UNKNOWN, UNKNOWN);
     }
     // check for no paramaters in the main method
-    else if (lookup_symbol(node, "main")->parameters->size > 0)
+    else if (main_sym->parameters->size > 0)
     {
-        ErrorList_printf(ERROR_LIST, "'main' must take no parameters");
+        report_error(visitor, ERR_MAIN_PARAMETERS, node, main_sym, UNKNOWN, UNKNOWN);
     }
-    // check for multiple methods with the same name
-    else
+
+    // check for multiple globals or methods with the same name
+    if (node != NULL)
     {
-        find_ducplicat_helper(node);
+        report_duplicate_symbols(visitor, node);
     }
 }
 
@@ -168,12 +264,13 @@ void Analysis_postvisit_program(NodeVisitor *visitor, ASTNode *node)
     if (node != NULL)
     {
         // make sure the "main" method is not null
-        if (lookup_symbol(node, "main") != NULL)
+        Symbol *main_sym = lookup_symbol(node, "main");
+        if (main_sym != NULL)
         {
             // make sure "main" returns an INT
-            if (lookup_symbol(node, "main")->type != INT)
+            if (main_sym->type != INT)
             {
-                ErrorList_printf(ERROR_LIST, "Program 'main' function must return an int");
+                report_error(visitor, ERR_MAIN_RETURN_TYPE, node, main_sym, UNKNOWN, UNKNOWN);
             }
         }
     }
@@ -207,7 +304,7 @@ void Analysis_postvisit_vardecl(NodeVisitor *visitor, ASTNode *node)
         // variable cannot be VOID type
         if (type == VOID)
         {
-            ErrorList_printf(ERROR_LIST, "Void variable '%s' on line %d", node->vardecl.name, node->source_line);
+            report_error(visitor, ERR_VOID_VARIABLE, node, NULL, UNKNOWN, UNKNOWN);
         }
         else
         {
@@ -217,12 +314,12 @@ void Analysis_postvisit_vardecl(NodeVisitor *visitor, ASTNode *node)
                 // array declarations can only be global
                 if (DATA->is_block || DATA->is_func)
                 {
-                    ErrorList_printf(ERROR_LIST, "Local variable '%s' on line %d cannot be an array", node->vardecl.name, node->source_line);
+                    report_error(visitor, ERR_LOCAL_ARRAY, node, NULL, UNKNOWN, UNKNOWN);
                     return;
                 }
                 if (node->vardecl.array_length <= 0)
                 {
-                    ErrorList_printf(ERROR_LIST, "Array length must be greater than 0");
+                    report_error(visitor, ERR_ARRAY_LENGTH, node, NULL, UNKNOWN, UNKNOWN);
                 }
             }
         }
@@ -258,8 +355,8 @@ void Analysis_postvisit_funcdecl(NodeVisitor *visitor, ASTNode *node)
     if (node != NULL)
     {
         DATA->is_func = false;
-        // check for duplicate variable declarations
-        find_ducplicat_helper(node);
+        // check for duplicate parameter and variable declarations
+        report_duplicate_symbols(visitor, node);
     }
 }
 
@@ -290,7 +387,7 @@ void Analysis_postvisit_block(NodeVisitor *visitor, ASTNode *node)
     {
         DATA->is_block = false;
         // check for duplicate variable declarations in a block
-        find_ducplicat_helper(node);
+        report_duplicate_symbols(visitor, node);
     }
 }
 
@@ -320,7 +417,7 @@ void Analysis_postvisit_assignment(NodeVisitor *visitor, ASTNode *node)
         DecafType right_type = GET_INFERRED_TYPE(node->assignment.value);
         if (left_type != right_type)
         {
-            ErrorList_printf(ERROR_LIST, "Expected %s type but type was %s", DecafType_to_string(left_type), DecafType_to_string(right_type));
+            report_error(visitor, ERR_ASSIGNMENT_TYPE, node, NULL, left_type, right_type);
         }
     }
 }
@@ -349,7 +446,7 @@ void Analysis_postvisit_conditional(NodeVisitor *visitor, ASTNode *node)
         // the condition must evaluate to a boolean
         if (cond_type != BOOL)
         {
-            ErrorList_printf(ERROR_LIST, "Conditional type was %s, expected bool on line %d", DecafType_to_string(cond_type), node->source_line);
+            report_error(visitor, ERR_CONDITION_TYPE, node, NULL, cond_type, UNKNOWN);
         }
     }
 }
@@ -384,7 +481,7 @@ void Analysis_postvisit_while_loop(NodeVisitor *visitor, ASTNode *node)
         // condition must evaluate to a boolean
         if (cond_type != BOOL)
         {
-            ErrorList_printf(ERROR_LIST, "Conditional type was %s, expected bool on line %d", DecafType_to_string(cond_type), node->source_line);
+            report_error(visitor, ERR_CONDITION_TYPE, node, NULL, cond_type, UNKNOWN);
         }
     }
 }
@@ -410,12 +507,9 @@ void Analysis_postvisit_return(NodeVisitor *visitor, ASTNode *node)
     if (node != NULL && node->funcreturn.value != NULL)
     {
         // if the function returns a variable, make sure it has been declared
-        if (node->funcreturn.value->type == LOCATION)
+        if (node->funcreturn.value->type == LOCATION && node->funcreturn.value->location.symbol == NULL)
         {
-            if (lookup_symbol(node, node->funcreturn.value->location.name) == NULL)
-            {
-                return;
-            }
+            return;
         }
 
         // check that the function returns the correct type
@@ -424,7 +518,7 @@ void Analysis_postvisit_return(NodeVisitor *visitor, ASTNode *node)
         {
             if (DATA->funcdecl_return_type != infer_return_value)
             {
-                ErrorList_printf(ERROR_LIST, "Invalid return type, Expected %s was %s on line %d", DecafType_to_string(DATA->funcdecl_return_type), DecafType_to_string(infer_return_value), node->source_line);
+                report_error(visitor, ERR_RETURN_TYPE, node, NULL, DATA->funcdecl_return_type, infer_return_value);
             }
         }
     }
@@ -443,7 +537,7 @@ void Analysis_previsit_break(NodeVisitor *visitor, ASTNode *node)
         // make sure breaks only happen inside a loop
         if (!DATA->is_loop)
         {
-            ErrorList_printf(ERROR_LIST, "Break statement should be inside a while loop.");
+            report_error(visitor, ERR_BREAK_OUTSIDE_LOOP, node, NULL, UNKNOWN, UNKNOWN);
         }
     }
 }
@@ -471,7 +565,7 @@ void Analysis_previsit_continue(NodeVisitor *visitor, ASTNode *node)
         // make sure continues only happen inside a loop
         if (!DATA->is_loop)
         {
-            Error_throw_printf("Continue statement should be inside a while loop.");
+            report_error(visitor, ERR_CONTINUE_OUTSIDE_LOOP, node, NULL, UNKNOWN, UNKNOWN);
         }
     }
 }
@@ -494,7 +588,7 @@ void Analysis_postvisit_continue(NodeVisitor *visitor, ASTNode *node)
  */
 void Analysis_previsit_binop(NodeVisitor *visitor, ASTNode *node)
 {
-    if (node != NULL)
+    if (node != NULL && !reuse_memoized_type(visitor, node))
     {
         BinaryOpType binop_type = node->binaryop.operator;
         // expressions with ||, &&, ==, !=, <, <=, >=, > evaluate to BOOL
@@ -539,8 +633,7 @@ void Analysis_postvisit_binop(NodeVisitor *visitor, ASTNode *node)
         {
             if (left_type != INT || right_type != INT)
             {
-                ErrorList_printf(ERROR_LIST, "Cannot use operator %s on type %s and %s on line %d", BinaryOpToString(binop_type), DecafType_to_string(left_type), DecafType_to_string(right_type), node->source_line);
-                return;
+                report_error(visitor, ERR_BINARY_OPERANDS, node, NULL, left_type, right_type);
             }
         }
         // expressions with == and != must have the same type on both sides
@@ -548,8 +641,7 @@ void Analysis_postvisit_binop(NodeVisitor *visitor, ASTNode *node)
         {
             if (left_type != right_type)
             {
-                ErrorList_printf(ERROR_LIST, "Cannot use operator %s on type %s and %s on line %d", BinaryOpToString(binop_type), DecafType_to_string(left_type), DecafType_to_string(right_type), node->source_line);
-                return;
+                report_error(visitor, ERR_BINARY_OPERANDS, node, NULL, left_type, right_type);
             }
         }
         // expressions with || and && must be BOOL on both side
@@ -557,10 +649,10 @@ void Analysis_postvisit_binop(NodeVisitor *visitor, ASTNode *node)
         {
             if (left_type != BOOL || right_type != BOOL)
             {
-                ErrorList_printf(ERROR_LIST, "Cannot use operator %s on type %s and %s on line %d", BinaryOpToString(binop_type), DecafType_to_string(left_type), DecafType_to_string(right_type), node->source_line);
-                return;
+                report_error(visitor, ERR_BINARY_OPERANDS, node, NULL, left_type, right_type);
             }
         }
+        memoize_type(visitor, node);
     }
 }
 
@@ -572,7 +664,7 @@ void Analysis_postvisit_binop(NodeVisitor *visitor, ASTNode *node)
  */
 void Analysis_previsit_unop(NodeVisitor *visitor, ASTNode *node)
 {
-    if (node != NULL)
+    if (node != NULL && !reuse_memoized_type(visitor, node))
     {
         UnaryOpType unop = node->unaryop.operator;
         // - operator evaluates to INT
@@ -603,9 +695,9 @@ void Analysis_postvisit_unop(NodeVisitor *visitor, ASTNode *node)
         DecafType inferred_type = GET_INFERRED_TYPE(node);
         if (actual_type != inferred_type)
         {
-            ErrorList_printf(ERROR_LIST, "Type mismatch expected %s was %s on line %d", DecafType_to_string(inferred_type), DecafType_to_string(actual_type), node->source_line);
-            return;
+            report_error(visitor, ERR_UNARY_OPERAND, node, NULL, inferred_type, actual_type);
         }
+        memoize_type(visitor, node);
     }
 }
 
@@ -617,14 +709,12 @@ void Analysis_postvisit_unop(NodeVisitor *visitor, ASTNode *node)
  */
 void Analysis_previsit_location(NodeVisitor *visitor, ASTNode *node)
 {
-    if (node != NULL)
+    if (node != NULL && !reuse_memoized_type(visitor, node))
     {
-        // make sure variable exists in symbol table
-        Symbol *sym = lookup_symbol_with_reporting(visitor, node, node->location.name);
-        if (sym != NULL)
-        {
-            SET_INFERRED_TYPE(sym->type);
-        }
+        // use the binding from name resolution (undefined names were already reported)
+        Symbol *sym = node->location.symbol;
+        DecafType type = (sym != NULL ? sym->type : UNKNOWN);
+        SET_INFERRED_TYPE(type);
     }
 }
 
@@ -638,23 +728,22 @@ void Analysis_postvisit_location(NodeVisitor *visitor, ASTNode *node)
 {
     if (node != NULL)
     {
-        Symbol *sym = lookup_symbol(node, node->location.name);
-        // check again if variable exists in symbol table
+        Symbol *sym = node->location.symbol;
+        // only check array usage if the variable is defined
         if (sym != NULL)
         {
             // check for array location with no index
             if (sym->symbol_type == ARRAY_SYMBOL && node->location.index == NULL)
             {
-                ErrorList_printf(ERROR_LIST, "Expected array index on line %d", node->source_line);
-                return;
+                report_error(visitor, ERR_MISSING_INDEX, node, sym, UNKNOWN, UNKNOWN);
             }
             // check for array location with index that is not an INT
-            if (sym->symbol_type == ARRAY_SYMBOL && GET_INFERRED_TYPE(node->location.index) != INT)
+            else if (sym->symbol_type == ARRAY_SYMBOL && GET_INFERRED_TYPE(node->location.index) != INT)
             {
-                ErrorList_printf(ERROR_LIST, "Array index must be an integer on line %d", node->source_line);
-                return;
+                report_error(visitor, ERR_INDEX_TYPE, node, sym, UNKNOWN, UNKNOWN);
             }
         }
+        memoize_type(visitor, node);
     }
 }
 
@@ -666,14 +755,12 @@ void Analysis_postvisit_location(NodeVisitor *visitor, ASTNode *node)
  */
 void Analysis_previsit_funcall(NodeVisitor *visitor, ASTNode *node)
 {
-    if (node != NULL)
+    if (node != NULL && !reuse_memoized_type(visitor, node))
     {
-        // make sure function exists in symbol table
-        Symbol *sym = lookup_symbol_with_reporting(visitor, node, node->funccall.name);
-        if (sym != NULL)
-        {
-            SET_INFERRED_TYPE(sym->type);
-        }
+        // use the binding from name resolution (undefined names were already reported)
+        Symbol *sym = node->funccall.symbol;
+        DecafType type = (sym != NULL ? sym->type : UNKNOWN);
+        SET_INFERRED_TYPE(type);
     }
 }
 
@@ -687,34 +774,33 @@ void Analysis_postvisit_funcall(NodeVisitor *visitor, ASTNode *node)
 {
     if (node != NULL)
     {
-        Symbol *sym = lookup_symbol_with_reporting(visitor, node, node->funccall.name);
-        // check again that function exists in symbol table
+        Symbol *sym = node->funccall.symbol;
+        // only check arguments if the function is defined
         if (sym != NULL)
         {
-            // temporarily store head of parameter list
-            struct Parameter *head = sym->parameters->head;
-            // make sure there is the correct number of arguments
-            if (sym->parameters->size != node->funccall.arguments->size)
+            // make sure there is the correct number of arguments (non-functions have none)
+            int num_params = (sym->parameters != NULL ? sym->parameters->size : 0);
+            if (num_params != node->funccall.arguments->size)
             {
-                ErrorList_printf(ERROR_LIST, "Incorrect number of arguments, expected %d, but got %d on line %d", sym->parameters->size, node->funccall.arguments->size, node->source_line);
-                return;
+                report_error(visitor, ERR_ARGUMENT_COUNT, node, sym, UNKNOWN, UNKNOWN);
             }
-            // go through each parameter and make sure arguments are correct types
-            for (int i = 0; i < sym->parameters->size; i++)
+            else
             {
-                if (sym->parameters->head->type != GET_INFERRED_TYPE(node->funccall.arguments->head))
+                // go through each parameter and make sure arguments are correct types
+                ASTNode *arg = node->funccall.arguments->head;
+                for (int i = 0; i < num_params; i++)
                 {
-                    ErrorList_printf(ERROR_LIST, "Expected type %s but got type %s on line %d", DecafType_to_string(sym->parameters->head->type), DecafType_to_string(GET_INFERRED_TYPE(node->funccall.arguments->head)), node->source_line);
-                    return;
+                    DecafType param_type = sym->parameters->types[i];
+                    if (param_type != GET_INFERRED_TYPE(arg))
+                    {
+                        report_error(visitor, ERR_ARGUMENT_TYPE, node, sym, param_type, GET_INFERRED_TYPE(arg));
+                        break;
+                    }
+                    arg = arg->next;
                 }
-                // move head to the next parameter
-                sym->parameters->head = sym->parameters->head->next;
-                // move head to the next argument
-                node->funccall.arguments->head = node->funccall.arguments->head->next;
             }
-            // set the head back
-            sym->parameters->head = head;
         }
+        memoize_type(visitor, node);
     }
 }
 
@@ -742,22 +828,17 @@ void Analysis_postvisit_literal(NodeVisitor *visitor, ASTNode *node)
 {
 }
 
-ErrorList *analyze(ASTNode *tree)
+/**
+ * @brief Create a visitor with all of the analysis callbacks registered
+ *
+ * @returns Pointer to visitor structure (with its own, empty error list)
+ */
+NodeVisitor *AnalysisVisitor_new()
 {
-    /* allocate analysis structures */
     NodeVisitor *v = NodeVisitor_new();
     v->data = (void *)AnalysisData_new();
     v->dtor = (Destructor)AnalysisData_free;
 
-    // check if tree is null, if so create an error list and return
-    if (tree == NULL)
-    {
-        ErrorList *errors = ((AnalysisData *)v->data)->errors;
-        ErrorList_printf(errors, "Null Tree not allowed.");
-        return errors;
-    }
-
-    /* BOILERPLATE: TODO: register analysis callbacks */
     v->previsit_program = Analysis_previsit_program;
     v->postvisit_program = Analysis_postvisit_program;
 
@@ -804,11 +885,221 @@ ErrorList *analyze(ASTNode *tree)
     v->previsit_literal = Analysis_previsit_literal;
     v->postvisit_literal = Analysis_postvisit_literal;
 
-    // assign a tyoe to all the literals according to chart thing
+    return v;
+}
+
+/**
+ * @brief Function bodies to check in parallel, and where their results go
+ */
+typedef struct FunctionJobs
+{
+    ASTNode **functions;        /**< @brief Function declarations in source order */
+    ErrorList **errors;         /**< @brief Errors found in each function (same order; @c NULL if not checked) */
+    ErrorList **cache;          /**< @brief Caller's per-function error cache (or @c NULL) */
+    bool *complete;             /**< @brief Which functions were checked without stopping early */
+    NodeVisitor **visitors;     /**< @brief One analysis visitor per worker */
+    int max_errors;             /**< @brief Error limit (0 for none) */
+    mtx_t lock;                 /**< @brief Protects the fields below */
+    bool *finished;             /**< @brief Which functions have been checked */
+    int num_finished;           /**< @brief Length of the prefix of functions that have been checked */
+    int finished_errors;        /**< @brief Errors found before any function, plus those in the prefix */
+} FunctionJobs;
+
+/**
+ * @brief Errors of a function that has been checked or taken from the cache
+ */
+ErrorList *function_errors(FunctionJobs *jobs, int job)
+{
+    if (jobs->errors[job] == NULL && jobs->cache != NULL)
+    {
+        return jobs->cache[job];
+    }
+    return jobs->errors[job];
+}
+
+/**
+ * @brief Check one function body (a @ref ThreadPoolJob)
+ *
+ * Each worker reuses its own visitor, so the flags in @ref AnalysisData are
+ * never shared between threads. They start out false, just as they are at the
+ * start of every function in a single traversal of the whole program.
+ * Functions with cached errors are not checked at all.
+ *
+ * @param context @ref FunctionJobs for the program
+ * @param job Index of the function
+ * @param worker Index of the worker
+ */
+void analyze_function_job(void *context, int job, int worker)
+{
+    FunctionJobs *jobs = (FunctionJobs *)context;
+    NodeVisitor *visitor = jobs->visitors[worker];
+
+    // nothing found here could be reported if the functions before this one
+    // already used up the error limit
+    bool skip = (jobs->cache != NULL && jobs->cache[job] != NULL);
+    if (!skip && jobs->max_errors > 0)
+    {
+        mtx_lock(&jobs->lock);
+        skip = (jobs->finished_errors >= jobs->max_errors);
+        mtx_unlock(&jobs->lock);
+    }
+
+    if (!skip)
+    {
+        jobs->errors[job] = ErrorList_new();
+        DATA->errors = jobs->errors[job];
+        DATA->is_loop = false;
+        DATA->is_block = false;
+        DATA->is_func = false;
+        visitor->stop_traversal = false;
+        NodeVisitor_traverse(visitor, jobs->functions[job]);
+        jobs->complete[job] = !visitor->stop_traversal;
+    }
+
+    if (jobs->max_errors > 0)
+    {
+        mtx_lock(&jobs->lock);
+        jobs->finished[job] = true;
+        while (jobs->functions[jobs->num_finished] != NULL && jobs->finished[jobs->num_finished])
+        {
+            ErrorList *found = function_errors(jobs, jobs->num_finished++);
+            jobs->finished_errors += (found != NULL ? ErrorList_size(found) : 0);
+        }
+        mtx_unlock(&jobs->lock);
+    }
+}
 
-    /* perform analysis, save error list, clean up, and return errors */
-    NodeVisitor_traverse(v, tree);
+ErrorList *analyze(ASTNode *tree)
+{
+    return analyze_incremental(tree, 1, NULL);
+}
+
+ErrorList *analyze_parallel(ASTNode *tree, int num_threads)
+{
+    return analyze_incremental(tree, num_threads, NULL);
+}
+
+ErrorList *analyze_incremental(ASTNode *tree, int num_threads, ErrorList **cache)
+{
+    /* allocate analysis structures */
+    NodeVisitor *v = AnalysisVisitor_new();
     ErrorList *errors = ((AnalysisData *)v->data)->errors;
+
+    int max_errors = DecafContext_current()->max_errors;
+
+    // check if tree is null, if so create an error list and return
+    if (tree == NULL)
+    {
+        report_error(v, ERR_NULL_TREE, NULL, NULL, UNKNOWN, UNKNOWN);
+        NodeVisitor_free(v);
+        return errors;
+    }
+
+    /* bind every name use to its symbol once (the only pass that needs to see
+     * the whole program at once) */
+    NodeVisitor_traverse_and_free(ResolveSymbolsVisitor_new(errors), tree);
+    if (max_errors > 0 && ErrorList_size(errors) >= max_errors)
+    {
+        ErrorList_truncate(errors, max_errors);
+        NodeVisitor_free(v);
+        return errors;
+    }
+    if (tree->type != PROGRAM)
+    {
+        NodeVisitor_traverse(v, tree);
+        NodeVisitor_free(v);
+        return errors;
+    }
+
+    /* program-level checks and global variables */
+    Analysis_previsit_program(v, tree);
+    FOR_EACH(ASTNode *, var, tree->program.variables)
+    {
+        NodeVisitor_traverse(v, var);
+    }
+    if (v->stop_traversal)
+    {
+        ErrorList_truncate(errors, max_errors);
+        NodeVisitor_free(v);
+        return errors;
+    }
+
+    /* function bodies only read the (frozen) symbol tables and write to their
+     * own nodes, so they can be checked independently */
+    int num_functions = NodeList_size(tree->program.functions);
+    int num_workers = (num_threads < num_functions ? num_threads : num_functions);
+    ThreadPool *pool = ThreadPool_new(num_workers);
+    FunctionJobs jobs;
+    jobs.functions = (ASTNode **)Memory_calloc(MEM_ANALYSIS, num_functions + 1, sizeof(ASTNode *));
+    CHECK_MALLOC_PTR(jobs.functions);
+    jobs.errors = (ErrorList **)Memory_calloc(MEM_ANALYSIS, num_functions + 1, sizeof(ErrorList *));
+    CHECK_MALLOC_PTR(jobs.errors);
+    jobs.visitors = (NodeVisitor **)Memory_calloc(MEM_ANALYSIS, pool->num_workers, sizeof(NodeVisitor *));
+    CHECK_MALLOC_PTR(jobs.visitors);
+    jobs.finished = (bool *)Memory_calloc(MEM_ANALYSIS, num_functions + 1, sizeof(bool));
+    CHECK_MALLOC_PTR(jobs.finished);
+    jobs.complete = (bool *)Memory_calloc(MEM_ANALYSIS, num_functions + 1, sizeof(bool));
+    CHECK_MALLOC_PTR(jobs.complete);
+    jobs.cache = cache;
+    jobs.max_errors = max_errors;
+    jobs.num_finished = 0;
+    jobs.finished_errors = ErrorList_size(errors);
+    if (mtx_init(&jobs.lock, mtx_plain) != thrd_success)
+    {
+        fprintf(stderr, "ERROR: could not initialize analysis lock\n");
+        exit(EXIT_FAILURE);
+    }
+    int i = 0;
+    FOR_EACH(ASTNode *, func, tree->program.functions)
+    {
+        jobs.functions[i++] = func;
+    }
+    for (int w = 0; w < pool->num_workers; w++)
+    {
+        jobs.visitors[w] = AnalysisVisitor_new();
+        ErrorList_free(((AnalysisData *)jobs.visitors[w]->data)->errors);
+    }
+    ThreadPool_run(pool, num_functions, analyze_function_job, &jobs);
+
+    /* merge in source order so the output does not depend on scheduling */
+    for (int f = 0; f < num_functions; f++)
+    {
+        if (jobs.errors[f] == NULL)
+        {
+            if (cache != NULL && cache[f] != NULL)
+            {
+                ErrorList_append_copies(errors, cache[f]);
+            }
+        }
+        else if (cache != NULL && jobs.complete[f])
+        {
+            // keep the complete list for next time
+            cache[f] = jobs.errors[f];
+            ErrorList_append_copies(errors, cache[f]);
+        }
+        else
+        {
+            ErrorList_append_all(errors, jobs.errors[f]);
+        }
+    }
+    if (max_errors <= 0 || ErrorList_size(errors) < max_errors)
+    {
+        Analysis_postvisit_program(v, tree);
+    }
+    ErrorList_truncate(errors, max_errors);
+
+    /* clean up and return errors */
+    for (int w = 0; w < pool->num_workers; w++)
+    {
+        NodeVisitor_free(jobs.visitors[w]);
+    }
+    mtx_destroy(&jobs.lock);
+    Memory_free(jobs.complete);
+    Memory_free(jobs.finished);
+    Memory_free(jobs.visitors);
+    Memory_free(jobs.errors);
+    Memory_free(jobs.functions);
+    ThreadPool_free(pool);
     NodeVisitor_free(v);
     return errors;
 }
@@ -0,0 +1,244 @@
+#include "resolver.h"
+
+/**
+ * @brief Initial number of slots in the name map (must be a power of two)
+ */
+#define RESOLVER_INITIAL_NAMES 64
+
+/**
+ * @brief Initial length of the undo log and scope mark arrays
+ */
+#define RESOLVER_INITIAL_DEPTH 16
+
+Resolver* Resolver_new ()
+{
+    Resolver* resolver = (Resolver*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(Resolver));
+    CHECK_MALLOC_PTR(resolver)
+    resolver->names_capacity = RESOLVER_INITIAL_NAMES;
+    resolver->names = (ResolverName**)Memory_calloc(MEM_ANALYSIS,
+            resolver->names_capacity, sizeof(ResolverName*));
+    CHECK_MALLOC_PTR(resolver->names)
+    resolver->bindings_capacity = RESOLVER_INITIAL_DEPTH;
+    resolver->bindings = (ResolverBinding*)Memory_calloc(MEM_ANALYSIS,
+            resolver->bindings_capacity, sizeof(ResolverBinding));
+    CHECK_MALLOC_PTR(resolver->bindings)
+    resolver->scopes_capacity = RESOLVER_INITIAL_DEPTH;
+    resolver->scopes = (int*)Memory_calloc(MEM_ANALYSIS, resolver->scopes_capacity, sizeof(int));
+    CHECK_MALLOC_PTR(resolver->scopes)
+    return resolver;
+}
+
+/**
+ * @brief Find the name map slot for a name
+ *
+ * @returns Index of the slot holding the name, or of the empty slot where it
+ * would be interned
+ */
+int Resolver_find_slot (Resolver* resolver, const char* name, uint64_t hash)
+{
+    int mask = resolver->names_capacity - 1;
+    int slot = (int)(hash & (uint64_t)mask);
+    while (resolver->names[slot] != NULL) {
+        ResolverName* entry = resolver->names[slot];
+        if (entry->hash == hash && strncmp(entry->name, name, MAX_ID_LEN) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Double the size of the name map and reinsert all names
+ */
+void Resolver_grow_names (Resolver* resolver)
+{
+    ResolverName** old_names = resolver->names;
+    int old_capacity = resolver->names_capacity;
+    resolver->names_capacity *= 2;
+    resolver->names = (ResolverName**)Memory_calloc(MEM_ANALYSIS,
+            resolver->names_capacity, sizeof(ResolverName*));
+    CHECK_MALLOC_PTR(resolver->names)
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_names[i] != NULL) {
+            resolver->names[Resolver_find_slot(resolver, old_names[i]->name,
+                    old_names[i]->hash)] = old_names[i];
+        }
+    }
+    Memory_free(old_names);
+}
+
+/**
+ * @brief Return the entry for a name, creating it if necessary
+ *
+ * New entries point to @p name rather than copying it, so it must be a
+ * symbol's (arena-owned) name.
+ */
+ResolverName* Resolver_intern (Resolver* resolver, const char* name)
+{
+    uint64_t hash = hash_string(name);
+    int slot = Resolver_find_slot(resolver, name, hash);
+    if (resolver->names[slot] == NULL) {
+        /* keep the load factor at or below 1/2 */
+        if ((resolver->names_size + 1) * 2 > resolver->names_capacity) {
+            Resolver_grow_names(resolver);
+            slot = Resolver_find_slot(resolver, name, hash);
+        }
+        ResolverName* entry = (ResolverName*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ResolverName));
+        CHECK_MALLOC_PTR(entry)
+        entry->name = name;
+        entry->hash = hash;
+        entry->binding = -1;
+        resolver->names[slot] = entry;
+        resolver->names_size++;
+    }
+    return resolver->names[slot];
+}
+
+void Resolver_enter_scope (Resolver* resolver)
+{
+    if (resolver->scopes_size == resolver->scopes_capacity) {
+        resolver->scopes_capacity *= 2;
+        resolver->scopes = (int*)Memory_realloc(resolver->scopes,
+                resolver->scopes_capacity, sizeof(int));
+        CHECK_MALLOC_PTR(resolver->scopes)
+    }
+    resolver->scopes[resolver->scopes_size++] = resolver->bindings_size;
+}
+
+void Resolver_exit_scope (Resolver* resolver)
+{
+    /* undo this scope's bindings in reverse order, restoring the ones they shadowed */
+    int mark = resolver->scopes[--resolver->scopes_size];
+    while (resolver->bindings_size > mark) {
+        ResolverBinding* b = &resolver->bindings[--resolver->bindings_size];
+        b->name->binding = b->shadowed;
+    }
+}
+
+Symbol* Resolver_declare (Resolver* resolver, Symbol* symbol)
+{
+    ResolverName* name = Resolver_intern(resolver, symbol->name);
+
+    /* a binding at or after the scope mark belongs to the innermost scope */
+    if (name->binding >= resolver->scopes[resolver->scopes_size - 1]) {
+        return resolver->bindings[name->binding].symbol;
+    }
+
+    if (resolver->bindings_size == resolver->bindings_capacity) {
+        resolver->bindings_capacity *= 2;
+        resolver->bindings = (ResolverBinding*)Memory_realloc(resolver->bindings,
+                resolver->bindings_capacity, sizeof(ResolverBinding));
+        CHECK_MALLOC_PTR(resolver->bindings)
+    }
+    ResolverBinding* b = &resolver->bindings[resolver->bindings_size];
+    b->name = name;
+    b->symbol = symbol;
+    b->shadowed = name->binding;
+    name->binding = resolver->bindings_size++;
+    return NULL;
+}
+
+Symbol* Resolver_lookup (Resolver* resolver, const char* name)
+{
+    ResolverName* entry = resolver->names[Resolver_find_slot(resolver, name, hash_string(name))];
+    if (entry == NULL || entry->binding < 0) {
+        return NULL;
+    }
+    return resolver->bindings[entry->binding].symbol;
+}
+
+void Resolver_free (Resolver* resolver)
+{
+    for (int i = 0; i < resolver->names_capacity; i++) {
+        Memory_free(resolver->names[i]);
+    }
+    Memory_free(resolver->names);
+    Memory_free(resolver->bindings);
+    Memory_free(resolver->scopes);
+    Memory_free(resolver);
+}
+
+/*
+ * AST VISITOR: NAME RESOLUTION
+ */
+
+/**
+ * @brief State for the name resolution visitor
+ */
+typedef struct ResolveSymbolsData
+{
+    Resolver* resolver;         /**< @brief Bindings for the scopes currently open */
+    ErrorList* errors;          /**< @brief List for "undefined symbol" errors (owned by the caller) */
+} ResolveSymbolsData;
+
+#define DATA ((ResolveSymbolsData*)visitor->data)
+
+void ResolveSymbolsData_free (ResolveSymbolsData* data)
+{
+    Resolver_free(data->resolver);
+    Memory_free(data);
+}
+
+void ResolveSymbolsVisitor_previsit_scope (NodeVisitor* visitor, ASTNode* node)
+{
+    Resolver_enter_scope(DATA->resolver);
+    const SymbolTable* table = node->scope;
+    for (int i = 0; i < table->size; i++) {
+        Resolver_declare(DATA->resolver, table->symbols[i]);
+    }
+}
+
+void ResolveSymbolsVisitor_postvisit_scope (NodeVisitor* visitor, ASTNode* node)
+{
+    Resolver_exit_scope(DATA->resolver);
+}
+
+/**
+ * @brief Report an undefined name, stopping at the context's error limit
+ */
+void ResolveSymbolsVisitor_report_undefined (NodeVisitor* visitor, ASTNode* node)
+{
+    ErrorList_report(DATA->errors, ERR_UNDEFINED, node, NULL, UNKNOWN, UNKNOWN);
+    int limit = DecafContext_current()->max_errors;
+    if (limit > 0 && ErrorList_size(DATA->errors) >= limit) {
+        visitor->stop_traversal = true;
+    }
+}
+
+void ResolveSymbolsVisitor_visit_location (NodeVisitor* visitor, ASTNode* node)
+{
+    node->location.symbol = Resolver_lookup(DATA->resolver, node->location.name);
+    if (node->location.symbol == NULL) {
+        ResolveSymbolsVisitor_report_undefined(visitor, node);
+    }
+}
+
+void ResolveSymbolsVisitor_visit_funccall (NodeVisitor* visitor, ASTNode* node)
+{
+    node->funccall.symbol = Resolver_lookup(DATA->resolver, node->funccall.name);
+    if (node->funccall.symbol == NULL) {
+        ResolveSymbolsVisitor_report_undefined(visitor, node);
+    }
+}
+
+NodeVisitor* ResolveSymbolsVisitor_new (ErrorList* errors)
+{
+    ResolveSymbolsData* data = (ResolveSymbolsData*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ResolveSymbolsData));
+    CHECK_MALLOC_PTR(data)
+    data->resolver = Resolver_new();
+    data->errors = errors;
+
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = data;
+    v->dtor = (Destructor)ResolveSymbolsData_free;
+    v->previsit_program   = ResolveSymbolsVisitor_previsit_scope;
+    v->postvisit_program  = ResolveSymbolsVisitor_postvisit_scope;
+    v->previsit_funcdecl  = ResolveSymbolsVisitor_previsit_scope;
+    v->postvisit_funcdecl = ResolveSymbolsVisitor_postvisit_scope;
+    v->previsit_block     = ResolveSymbolsVisitor_previsit_scope;
+    v->postvisit_block    = ResolveSymbolsVisitor_postvisit_scope;
+    v->previsit_location  = ResolveSymbolsVisitor_visit_location;
+    v->previsit_funccall  = ResolveSymbolsVisitor_visit_funccall;
+    return v;
+}
@@ -0,0 +1,144 @@
+#include "server.h"
+
+/**
+ * @brief Read one line of any length (without its newline)
+ *
+ * @param input Stream to read from
+ * @param buffer Line buffer (grown as needed)
+ * @param capacity Allocated length of @p buffer
+ * @returns Length of the line, or -1 at the end of the input
+ */
+int server_read_line (FILE* input, char** buffer, size_t* capacity)
+{
+    size_t length = 0;
+    int c;
+    while ((c = fgetc(input)) != EOF && c != '\n') {
+        if (length + 1 >= *capacity) {
+            *capacity *= 2;
+            *buffer = (char*)Memory_realloc(*buffer, *capacity, sizeof(char));
+            CHECK_MALLOC_PTR(*buffer)
+        }
+        (*buffer)[length++] = (char)c;
+    }
+    (*buffer)[length] = '\0';
+    if (c == EOF && length == 0) {
+        return -1;
+    }
+    if (length > 0 && (*buffer)[length - 1] == '\r') {
+        (*buffer)[--length] = '\0';
+    }
+    return (int)length;
+}
+
+/**
+ * @brief Decode the escapes in inline source (in place)
+ *
+ * @returns Length of the decoded text
+ */
+size_t server_unescape (char* text)
+{
+    char* out = text;
+    for (char* in = text; *in != '\0'; in++) {
+        if (*in == '\\' && in[1] != '\0') {
+            in++;
+            switch (*in) {
+                case 'n':  *out++ = '\n'; break;
+                case 't':  *out++ = '\t'; break;
+                default:   *out++ = *in;  break;
+            }
+        } else {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+    return (size_t)(out - text);
+}
+
+/**
+ * @brief Write a response that consists of a single diagnostic
+ */
+void server_respond_invalid (FILE* output, const char* message, const char* detail)
+{
+    fprintf(output, "result invalid 1\n%s%s\nend\n", message, detail);
+}
+
+/**
+ * @brief Analyze one program and write the response
+ */
+void server_respond (DecafContext* context, const char* text, size_t length, bool symbols, FILE* output)
+{
+    DecafResult result;
+    DecafStatus status = decaf_analyze_buffer(context, text, length, &result);
+    const char* name = "invalid";
+    switch (status) {
+        case DECAF_OK:              name = "ok";            break;
+        case DECAF_ANALYSIS_ERRORS: name = "errors";        break;
+        case DECAF_SYNTAX_ERROR:    name = "syntax-error";  break;
+        case DECAF_INVALID_INPUT:   name = "invalid";       break;
+    }
+    fprintf(output, "result %s %d\n", name, ErrorList_size(result.errors));
+    ErrorList_print(result.errors, output);
+    if (symbols && status == DECAF_OK) {
+        NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new(output), result.tree);
+    }
+    fprintf(output, "end\n");
+    decaf_result_free(&result);
+}
+
+int decaf_serve (DecafContext* context, FILE* input, FILE* output)
+{
+    DecafContext* previous = DecafContext_set_current(context);
+    Regex_enable_cache(true);
+
+    size_t capacity = MAX_LINE_LEN;
+    char* line = (char*)Memory_calloc(MEM_TOKEN, capacity, sizeof(char));
+    CHECK_MALLOC_PTR(line)
+    char* text = (char*)Memory_calloc(MEM_TOKEN, MAX_FILE_SIZE + 1, sizeof(char));
+    CHECK_MALLOC_PTR(text)
+
+    int requests = 0;
+    while (server_read_line(input, &line, &capacity) >= 0) {
+        /* split into command, optional flag, and argument */
+        char* command = line;
+        char* argument = strchr(line, ' ');
+        if (argument != NULL) {
+            *argument++ = '\0';
+        } else {
+            argument = line + strlen(line);
+        }
+        bool symbols = false;
+        if (strncmp(argument, "--symbols", 9) == 0 && (argument[9] == ' ' || argument[9] == '\0')) {
+            symbols = true;
+            argument += (argument[9] == ' ' ? 10 : 9);
+        }
+
+        if (command[0] == '\0') {
+            continue;
+        } else if (strcmp(command, "quit") == 0) {
+            break;
+        } else if (strcmp(command, "file") == 0) {
+            ReadStatus read = read_file(argument, text);
+            if (read == READ_OK) {
+                server_respond(context, text, strlen(text), symbols, output);
+            } else if (read == READ_TOO_LARGE) {
+                server_respond_invalid(output, "File too large: ", argument);
+            } else {
+                server_respond_invalid(output, "Could not read file: ", argument);
+            }
+        } else if (strcmp(command, "source") == 0) {
+            size_t length = server_unescape(argument);
+            server_respond(context, argument, length, symbols, output);
+        } else {
+            server_respond_invalid(output, "Unknown request: ", command);
+        }
+        fflush(output);
+        requests++;
+    }
+
+    Memory_free(text);
+    Memory_free(line);
+    Regex_clear_cache();
+    Regex_enable_cache(false);
+    DecafContext_set_current(previous);
+    return requests;
+}
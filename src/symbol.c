@@ -26,52 +26,196 @@ void symtable_attr_print(void *value, FILE *output)
  * Symbol and SymbolTable definitions
  */
 
-Symbol *Symbol_new(const char *name, DecafType type)
+/**
+ * @brief Minimum size (in bytes) of an arena chunk
+ */
+#define SYMBOL_ARENA_CHUNK_SIZE 4096
+
+/**
+ * @brief Initial number of slots in an arena's intern set
+ */
+#define SYMBOL_ARENA_INITIAL_INTERNED 64
+
+SymbolArena *SymbolArena_new()
 {
-    Symbol *symbol = (Symbol *)calloc(1, sizeof(Symbol));
-    CHECK_MALLOC_PTR(symbol)
-    symbol->symbol_type = SCALAR_SYMBOL;
-    snprintf(symbol->name, MAX_ID_LEN, "%s", name);
+    SymbolArena *arena = (SymbolArena *)Memory_calloc(MEM_SYMBOL, 1, sizeof(SymbolArena));
+    CHECK_MALLOC_PTR(arena)
+    arena->chunks = NULL;
+    arena->interned_capacity = SYMBOL_ARENA_INITIAL_INTERNED;
+    arena->interned = (const void **)Memory_calloc(MEM_SYMBOL, arena->interned_capacity, sizeof(void *));
+    CHECK_MALLOC_PTR(arena->interned)
+    arena->interned_sizes = (size_t *)Memory_calloc(MEM_SYMBOL, arena->interned_capacity, sizeof(size_t));
+    CHECK_MALLOC_PTR(arena->interned_sizes)
+    arena->interned_size = 0;
+    arena->references = 1;
+    return arena;
+}
+
+void *SymbolArena_alloc(SymbolArena *arena, size_t size)
+{
+    /* round up so that every allocation stays aligned for any type */
+    size = (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+
+    SymbolArenaChunk *chunk = arena->chunks;
+    if (chunk == NULL || chunk->capacity - chunk->used < size)
+    {
+        size_t capacity = (size > SYMBOL_ARENA_CHUNK_SIZE ? size : SYMBOL_ARENA_CHUNK_SIZE);
+        chunk = (SymbolArenaChunk *)Memory_calloc(MEM_SYMBOL, 1, sizeof(SymbolArenaChunk) + capacity);
+        CHECK_MALLOC_PTR(chunk)
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    void *ptr = (char *)chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+/**
+ * @brief Find the intern set slot for a block of bytes
+ *
+ * @returns Index of the slot holding an equal block, or of the empty slot
+ * where it would be interned
+ */
+int SymbolArena_find_slot(SymbolArena *arena, const void *data, size_t size, uint64_t hash)
+{
+    int mask = arena->interned_capacity - 1;
+    int slot = (int)(hash & (uint64_t)mask);
+    while (arena->interned[slot] != NULL &&
+           (arena->interned_sizes[slot] != size || memcmp(arena->interned[slot], data, size) != 0))
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * @brief Double the size of an arena's intern set and reinsert all blocks
+ */
+void SymbolArena_grow_interned(SymbolArena *arena)
+{
+    const void **old_interned = arena->interned;
+    size_t *old_sizes = arena->interned_sizes;
+    int old_capacity = arena->interned_capacity;
+    arena->interned_capacity *= 2;
+    arena->interned = (const void **)Memory_calloc(MEM_SYMBOL, arena->interned_capacity, sizeof(void *));
+    CHECK_MALLOC_PTR(arena->interned)
+    arena->interned_sizes = (size_t *)Memory_calloc(MEM_SYMBOL, arena->interned_capacity, sizeof(size_t));
+    CHECK_MALLOC_PTR(arena->interned_sizes)
+    for (int i = 0; i < old_capacity; i++)
+    {
+        if (old_interned[i] != NULL)
+        {
+            int slot = SymbolArena_find_slot(arena, old_interned[i], old_sizes[i],
+                                             hash_bytes(old_interned[i], old_sizes[i]));
+            arena->interned[slot] = old_interned[i];
+            arena->interned_sizes[slot] = old_sizes[i];
+        }
+    }
+    Memory_free(old_interned);
+    Memory_free(old_sizes);
+}
+
+const void *SymbolArena_intern(SymbolArena *arena, const void *data, size_t size)
+{
+    uint64_t hash = hash_bytes(data, size);
+    int slot = SymbolArena_find_slot(arena, data, size, hash);
+    if (arena->interned[slot] == NULL)
+    {
+        /* keep the load factor at or below 1/2 */
+        if ((arena->interned_size + 1) * 2 > arena->interned_capacity)
+        {
+            SymbolArena_grow_interned(arena);
+            slot = SymbolArena_find_slot(arena, data, size, hash);
+        }
+        void *copy = SymbolArena_alloc(arena, size);
+        memcpy(copy, data, size);
+        arena->interned[slot] = copy;
+        arena->interned_sizes[slot] = size;
+        arena->interned_size++;
+    }
+    return arena->interned[slot];
+}
+
+const char *SymbolArena_intern_name(SymbolArena *arena, const char *name)
+{
+    return (const char *)SymbolArena_intern(arena, name, strlen(name) + 1);
+}
+
+void SymbolArena_retain(SymbolArena *arena)
+{
+    arena->references++;
+}
+
+void SymbolArena_release(SymbolArena *arena)
+{
+    if (--arena->references > 0)
+    {
+        return;
+    }
+    SymbolArenaChunk *next = arena->chunks;
+    while (next != NULL)
+    {
+        SymbolArenaChunk *cur = next;
+        next = cur->next;
+        Memory_free(cur);
+    }
+    Memory_free(arena->interned);
+    Memory_free(arena->interned_sizes);
+    Memory_free(arena);
+}
+
+/**
+ * @brief Allocate a symbol from an arena and initialize the common fields
+ */
+Symbol *Symbol_new_in_arena(SymbolArena *arena, const char *name, DecafType type)
+{
+    Symbol *symbol = (Symbol *)SymbolArena_alloc(arena, sizeof(Symbol));
+    symbol->name = SymbolArena_intern_name(arena, name);
     symbol->type = type;
     symbol->length = 1;
-    symbol->parameters = ParameterList_new();
+    symbol->parameters = NULL;
     symbol->location = UNKNOWN_LOC;
     symbol->offset = 0;
+    symbol->source_line = 0;
+    symbol->duplicate_of = NULL;
     symbol->next = NULL;
     return symbol;
 }
 
-Symbol *Symbol_new_array(const char *name, DecafType type, int length)
+Symbol *Symbol_new(SymbolArena *arena, const char *name, DecafType type)
+{
+    Symbol *symbol = Symbol_new_in_arena(arena, name, type);
+    symbol->symbol_type = SCALAR_SYMBOL;
+    return symbol;
+}
+
+Symbol *Symbol_new_array(SymbolArena *arena, const char *name, DecafType type, int length)
 {
-    Symbol *symbol = (Symbol *)calloc(1, sizeof(Symbol));
-    CHECK_MALLOC_PTR(symbol)
+    Symbol *symbol = Symbol_new_in_arena(arena, name, type);
     symbol->symbol_type = ARRAY_SYMBOL;
-    snprintf(symbol->name, MAX_ID_LEN, "%s", name);
-    symbol->type = type;
     symbol->length = length;
-    symbol->parameters = ParameterList_new();
-    symbol->location = UNKNOWN_LOC;
-    symbol->offset = 0;
-    symbol->next = NULL;
     return symbol;
 }
 
-Symbol *Symbol_new_function(const char *name, DecafType return_type, ParameterList *parameters)
+Symbol *Symbol_new_function(SymbolArena *arena, const char *name, DecafType return_type,
+                            ParameterList *parameters)
 {
-    Symbol *symbol = (Symbol *)calloc(1, sizeof(Symbol));
-    CHECK_MALLOC_PTR(symbol)
+    Symbol *symbol = Symbol_new_in_arena(arena, name, return_type);
     symbol->symbol_type = FUNCTION_SYMBOL;
-    snprintf(symbol->name, MAX_ID_LEN, "%s", name);
-    symbol->type = return_type;
-    symbol->length = 1;
-    symbol->parameters = ParameterList_new();
+
+    /* build the signature in scratch memory, then share the interned copy */
+    size_t size = sizeof(ParameterArray) + (size_t)parameters->size * sizeof(DecafType);
+    ParameterArray *signature = (ParameterArray *)Memory_calloc(MEM_SYMBOL, 1, size);
+    CHECK_MALLOC_PTR(signature)
+    signature->size = 0;
     FOR_EACH(Parameter *, p, parameters)
     {
-        ParameterList_add_new(symbol->parameters, p->name, p->type);
+        signature->types[signature->size++] = p->type;
     }
-    symbol->location = UNKNOWN_LOC;
-    symbol->offset = 0;
-    symbol->next = NULL;
+    symbol->parameters = (const ParameterArray *)SymbolArena_intern(arena, signature, size);
+    Memory_free(signature);
     return symbol;
 }
 
@@ -90,18 +234,13 @@ void Symbol_print(Symbol *symbol, FILE *output)
 
     case FUNCTION_SYMBOL:
         fprintf(output, "%s : (", symbol->name);
-        bool first = true;
-        FOR_EACH(Parameter *, p, symbol->parameters)
+        for (int i = 0; i < symbol->parameters->size; i++)
         {
-            if (first)
-            {
-                first = false;
-            }
-            else
+            if (i > 0)
             {
                 fprintf(output, ", ");
             }
-            fprintf(output, "%s", DecafType_to_string(p->type));
+            fprintf(output, "%s", DecafType_to_string(symbol->parameters->types[i]));
         }
         fprintf(output, ") -> %s", DecafType_to_string(symbol->type));
         break;
@@ -121,47 +260,209 @@ void Symbol_print(Symbol *symbol, FILE *output)
     }
 }
 
-void Symbol_free(Symbol *symbol)
-{
-    ParameterList_free(symbol->parameters);
-    free(symbol);
-}
+/* symbols are owned by their arena, so lists do not free them */
+DEF_LIST_IMPL(Symbol, Symbol *, dummy_free, MEM_SYMBOL)
 
-DEF_LIST_IMPL(Symbol, Symbol *, Symbol_free)
+/**
+ * @brief Initial number of slots in a symbol table's hash index
+ */
+#define SYMBOL_INDEX_INITIAL_CAPACITY 8
 
-SymbolTable *SymbolTable_new()
+/**
+ * @brief Allocate an empty table that uses the given arena
+ */
+SymbolTable *SymbolTable_new_in_arena(SymbolArena *arena, SymbolTable *parent)
 {
-    SymbolTable *table = (SymbolTable *)calloc(1, sizeof(SymbolTable));
+    SymbolTable *table = (SymbolTable *)Memory_calloc(MEM_SYMBOL, 1, sizeof(SymbolTable));
     CHECK_MALLOC_PTR(table)
     table->local_symbols = SymbolList_new();
-    table->parent = NULL;
+    table->index = NULL;
+    table->index_capacity = 0;
+    table->symbols = NULL;
+    table->size = 0;
+    table->frozen = false;
+    table->arena = arena;
+    table->parent = parent;
     return table;
 }
 
+SymbolTable *SymbolTable_new()
+{
+    return SymbolTable_new_in_arena(SymbolArena_new(), NULL);
+}
+
 SymbolTable *SymbolTable_new_child(SymbolTable *parent)
 {
-    SymbolTable *table = SymbolTable_new();
-    table->parent = parent;
-    return table;
+    SymbolArena_retain(parent->arena);
+    return SymbolTable_new_in_arena(parent->arena, parent);
+}
+
+/**
+ * @brief Find the index slot for a name in a single table
+ *
+ * @returns Index of the slot holding the symbol with the given name, or of the
+ * empty slot where it would be inserted
+ */
+int SymbolTable_find_slot(const SymbolTable *table, const char *name, uint64_t hash)
+{
+    int mask = table->index_capacity - 1;
+    int slot = (int)(hash & (uint64_t)mask);
+    while (table->index[slot] != NULL &&
+           strncmp(name, table->index[slot]->name, MAX_ID_LEN) != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
 }
 
-void SymbolTable_insert(SymbolTable *table, Symbol *symbol)
+/**
+ * @brief Allocate a larger hash index and re-insert all symbols
+ */
+void SymbolTable_grow_index(SymbolTable *table)
 {
+    Symbol **old_index = table->index;
+    int old_capacity = table->index_capacity;
+
+    table->index_capacity = (old_capacity == 0 ? SYMBOL_INDEX_INITIAL_CAPACITY : old_capacity * 2);
+    table->index = (Symbol **)Memory_calloc(MEM_SYMBOL, table->index_capacity, sizeof(Symbol *));
+    CHECK_MALLOC_PTR(table->index)
+    for (int i = 0; i < old_capacity; i++)
+    {
+        if (old_index[i] != NULL)
+        {
+            int slot = SymbolTable_find_slot(table, old_index[i]->name, hash_string(old_index[i]->name));
+            table->index[slot] = old_index[i];
+        }
+    }
+    Memory_free(old_index);
+}
+
+Symbol *SymbolTable_insert(SymbolTable *table, Symbol *symbol)
+{
+    if (table->frozen)
+    {
+        fprintf(stderr, "Cannot insert '%s' into a frozen symbol table\n", symbol->name);
+        exit(EXIT_FAILURE);
+    }
     SymbolList_add(table->local_symbols, symbol);
+    table->size++;
+
+    /* keep the load factor at or below 1/2 */
+    if (table->local_symbols->size * 2 > table->index_capacity)
+    {
+        SymbolTable_grow_index(table);
+    }
+    int slot = SymbolTable_find_slot(table, symbol->name, hash_string(symbol->name));
+    if (table->index[slot] != NULL)
+    {
+        symbol->duplicate_of = table->index[slot];
+        return symbol->duplicate_of;
+    }
+    table->index[slot] = symbol;
+    return NULL;
 }
 
-Symbol *SymbolTable_lookup(SymbolTable *table, const char *name)
+void SymbolTable_freeze(SymbolTable *table)
 {
+    if (table->frozen)
+    {
+        return;
+    }
+    Symbol **symbols = (Symbol **)SymbolArena_alloc(table->arena, (size_t)table->size * sizeof(Symbol *));
+    int i = 0;
     FOR_EACH(Symbol *, sym, table->local_symbols)
     {
-        if (strncmp(name, sym->name, MAX_ID_LEN) == 0)
+        symbols[i++] = sym;
+    }
+    table->symbols = symbols;
+    table->frozen = true;
+}
+
+void SymbolTable_remove_all(SymbolTable *table, Symbol **removed, int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    PointerMap doomed;
+    PointerMap_init(&doomed, count, MEM_SYMBOL);
+    for (int i = 0; i < count; i++)
+    {
+        PointerMap_insert(&doomed, removed[i], i);
+    }
+
+    /* thaw: the old frozen copy is left as it was (other references to it
+     * see the table as it was), and a new one is made at the end */
+    bool was_frozen = table->frozen;
+    table->frozen = false;
+    table->symbols = NULL;
+
+    /* compact the declaration-order list */
+    SymbolList *list = table->local_symbols;
+    Symbol *prev = NULL;
+    Symbol *sym = list->head;
+    while (sym != NULL)
+    {
+        Symbol *next = sym->next;
+        if (PointerMap_find(&doomed, sym) >= 0)
+        {
+            if (prev == NULL)
+            {
+                list->head = next;
+            }
+            else
+            {
+                prev->next = next;
+            }
+            sym->next = NULL;
+            list->size--;
+            table->size--;
+        }
+        else
+        {
+            prev = sym;
+        }
+        sym = next;
+    }
+    list->tail = prev;
+
+    /* rebuild the hash index once (a slot cannot simply be cleared under
+     * linear probing) */
+    memset(table->index, 0, (size_t)table->index_capacity * sizeof(Symbol *));
+    FOR_EACH(Symbol *, other, list)
+    {
+        if (other->duplicate_of != NULL && PointerMap_find(&doomed, other->duplicate_of) >= 0)
         {
-            return sym;
+            other->duplicate_of = NULL;
+        }
+        int slot = SymbolTable_find_slot(table, other->name, hash_string(other->name));
+        if (table->index[slot] == NULL)
+        {
+            table->index[slot] = other;
         }
     }
-    if (table->parent != NULL)
+    PointerMap_free(&doomed);
+
+    if (was_frozen)
     {
-        return SymbolTable_lookup(table->parent, name);
+        SymbolTable_freeze(table);
+    }
+}
+
+Symbol *SymbolTable_lookup(const SymbolTable *table, const char *name)
+{
+    /* hash once, then probe each table up the parent chain */
+    uint64_t hash = hash_string(name);
+    for (; table != NULL; table = table->parent)
+    {
+        if (table->index != NULL)
+        {
+            Symbol *sym = table->index[SymbolTable_find_slot(table, name, hash)];
+            if (sym != NULL)
+            {
+                return sym;
+            }
+        }
     }
     return NULL;
 }
@@ -169,12 +470,20 @@ Symbol *SymbolTable_lookup(SymbolTable *table, const char *name)
 void SymbolTable_free(SymbolTable *table)
 {
     SymbolList_free(table->local_symbols);
-    free(table);
+    Memory_free(table->index);
+    SymbolArena_release(table->arena);
+    Memory_free(table);
 }
 
 Symbol *lookup_symbol(ASTNode *node, const char *name)
 {
-    /* phase 1: traverse up the tree until we find a symbol table or reach the root */
+    /* phase 1 (fast path): the symbol table builder recorded the scope directly */
+    if (node != NULL && node->scope != NULL)
+    {
+        return SymbolTable_lookup(node->scope, name);
+    }
+
+    /* phase 1 (slow path): traverse up the tree until we find a symbol table or reach the root */
     while (node != NULL && !ASTNode_has_attribute(node, "symbolTable"))
     {
         node = (ASTNode *)ASTNode_get_attribute(node, "parent");
@@ -193,11 +502,11 @@ Symbol *lookup_symbol(ASTNode *node, const char *name)
  * SymbolTable construction (AST visitor)
  */
 
-Symbol *create_print_symbol(const char *name, DecafType type)
+Symbol *create_print_symbol(SymbolArena *arena, const char *name, DecafType type)
 {
     ParameterList *params = ParameterList_new();
     ParameterList_add_new(params, "value", type);
-    Symbol *symbol = Symbol_new_function(name, VOID, params);
+    Symbol *symbol = Symbol_new_function(arena, name, VOID, params);
     ParameterList_free(params);
     return symbol;
 }
@@ -209,20 +518,22 @@ void BuildSymbolTablesVisitor_previsit_program(NodeVisitor *visitor, ASTNode *no
 
     /* add to AST as an attribute */
     ASTNode_set_printable_attribute(node, "symbolTable", table, symtable_attr_print, (Destructor)SymbolTable_free);
+    node->scope = table;
 
     /* initialize stack */
     visitor->data = table;
 
     /* add symbols for built-in functions */
-    SymbolTable_insert(table, create_print_symbol("print_int", INT));
-    SymbolTable_insert(table, create_print_symbol("print_bool", BOOL));
-    SymbolTable_insert(table, create_print_symbol("print_str", STR));
+    SymbolTable_insert(table, create_print_symbol(table->arena, "print_int", INT));
+    SymbolTable_insert(table, create_print_symbol(table->arena, "print_bool", BOOL));
+    SymbolTable_insert(table, create_print_symbol(table->arena, "print_str", STR));
 
     /* add symbols for user-defined functions (global variables will be handled in vardecl visitor) */
     FOR_EACH(ASTNode *, func, node->program.functions)
     {
-        Symbol *new_symbol = Symbol_new_function(func->funcdecl.name, func->funcdecl.return_type,
+        Symbol *new_symbol = Symbol_new_function(table->arena, func->funcdecl.name, func->funcdecl.return_type,
                                                  func->funcdecl.parameters);
+        new_symbol->source_line = func->source_line;
         SymbolTable_insert(table, new_symbol);
     }
 }
@@ -232,12 +543,15 @@ void BuildSymbolTablesVisitor_previsit_funcdecl(NodeVisitor *visitor, ASTNode *n
     /* new child table w/ a parent pointer to the table on top of the stack */
     SymbolTable *table = SymbolTable_new_child((SymbolTable *)visitor->data);
     ASTNode_set_printable_attribute(node, "symbolTable", table, symtable_attr_print, (Destructor)SymbolTable_free);
+    node->scope = table;
     visitor->data = table; /* push onto stack (parent pointer acts as 'next') */
 
     /* add symbols for parameters (local variables will be handled in vardecl visitor) */
     FOR_EACH(Parameter *, p, node->funcdecl.parameters)
     {
-        SymbolTable_insert(table, Symbol_new(p->name, p->type));
+        Symbol *new_symbol = Symbol_new(table->arena, p->name, p->type);
+        new_symbol->source_line = node->source_line;
+        SymbolTable_insert(table, new_symbol);
     }
 }
 
@@ -248,6 +562,7 @@ void BuildSymbolTablesVisitor_previsit_block(NodeVisitor *visitor, ASTNode *node
 
     /* add to AST as an attribute */
     ASTNode_set_printable_attribute(node, "symbolTable", table, symtable_attr_print, (Destructor)SymbolTable_free);
+    node->scope = table;
 
     /* push onto stack (parent pointer acts as 'next') */
     visitor->data = table;
@@ -257,22 +572,32 @@ void BuildSymbolTablesVisitor_visit_vardecl(NodeVisitor *visitor, ASTNode *node)
 {
     /* create and add new symbol to the current/top symbol table */
     SymbolTable *current_table = (SymbolTable *)visitor->data;
+    node->scope = current_table;
     Symbol *new_symbol = NULL;
     if (node->vardecl.is_array)
     {
-        new_symbol = Symbol_new_array(node->vardecl.name, node->vardecl.type,
+        new_symbol = Symbol_new_array(current_table->arena, node->vardecl.name, node->vardecl.type,
                                       node->vardecl.array_length);
     }
     else
     {
-        new_symbol = Symbol_new(node->vardecl.name, node->vardecl.type);
+        new_symbol = Symbol_new(current_table->arena, node->vardecl.name, node->vardecl.type);
     }
+    new_symbol->source_line = node->source_line;
     SymbolTable_insert(current_table, new_symbol);
 }
 
+void BuildSymbolTablesVisitor_visit_default(NodeVisitor *visitor, ASTNode *node)
+{
+    /* every other node is in the scope on top of the stack */
+    node->scope = (SymbolTable *)visitor->data;
+}
+
 void BuildSymbolTablesVisitor_postvisit(NodeVisitor *visitor, ASTNode *node)
 {
-    visitor->data = ((SymbolTable *)visitor->data)->parent; /* pop stack */
+    SymbolTable *table = (SymbolTable *)visitor->data;
+    SymbolTable_freeze(table); /* complete now that its scope has been traversed */
+    visitor->data = table->parent; /* pop stack */
 }
 
 NodeVisitor *BuildSymbolTablesVisitor_new()
@@ -290,6 +615,7 @@ NodeVisitor *BuildSymbolTablesVisitor_new()
     v->previsit_block = BuildSymbolTablesVisitor_previsit_block;
     v->postvisit_block = BuildSymbolTablesVisitor_postvisit;
     v->previsit_vardecl = BuildSymbolTablesVisitor_visit_vardecl;
+    v->previsit_default = BuildSymbolTablesVisitor_visit_default;
     return v;
 }
 
@@ -325,6 +651,17 @@ void print_symbol_table(NodeVisitor *visitor, ASTNode *node)
             fprintf(OUTFILE, "\n");
         }
     }
+    /* if storage has been allocated, print the sizes too */
+    if (ASTNode_has_attribute(node, "staticSize"))
+    {
+        PRINT_INDENT
+        fprintf(OUTFILE, " {static size=%d}\n", ASTNode_get_int_attribute(node, "staticSize"));
+    }
+    if (ASTNode_has_attribute(node, "localSize"))
+    {
+        PRINT_INDENT
+        fprintf(OUTFILE, " {frame size=%d}\n", ASTNode_get_int_attribute(node, "localSize"));
+    }
     fprintf(OUTFILE, "\n");
 }
 
@@ -367,15 +704,208 @@ NodeVisitor *PrintSymbolsVisitor_new(FILE *output)
  * static analysis definitions
  */
 
-DEF_LIST_IMPL(Error, AnalysisError *, free)
+void AnalysisError_free(AnalysisError *error)
+{
+    if (error->text != NULL)
+    {
+        Memory_free(error->text);
+    }
+    Memory_free(error);
+}
 
-void ErrorList_printf(ErrorList *list, const char *format, ...)
+DEF_LIST_IMPL(Error, AnalysisError *, AnalysisError_free, MEM_ERROR)
+
+/**
+ * @brief Allocate a blank error record and add it to a list
+ */
+AnalysisError *ErrorList_add_new(ErrorList *list, ErrorCode code)
 {
-    AnalysisError *err = (AnalysisError *)calloc(1, sizeof(AnalysisError));
+    AnalysisError *err = (AnalysisError *)Memory_calloc(MEM_ERROR, 1, sizeof(AnalysisError));
     CHECK_MALLOC_PTR(err);
+    err->code = code;
+    err->types[0] = UNKNOWN;
+    err->types[1] = UNKNOWN;
+    ErrorList_add(list, err);
+    return err;
+}
+
+void ErrorList_printf(ErrorList *list, const char *format, ...)
+{
+    AnalysisError *err = ErrorList_add_new(list, ERR_MESSAGE);
+    err->text = (char *)Memory_calloc(MEM_ERROR, MAX_ERROR_LEN, sizeof(char));
+    CHECK_MALLOC_PTR(err->text);
     va_list args;
     va_start(args, format);
-    vsnprintf(err->message, MAX_ERROR_LEN, format, args);
+    vsnprintf(err->text, MAX_ERROR_LEN, format, args);
     va_end(args);
-    ErrorList_add(list, err);
+}
+
+void ErrorList_report(ErrorList *list, ErrorCode code, ASTNode *node, const Symbol *symbol,
+                      DecafType type0, DecafType type1)
+{
+    AnalysisError *err = ErrorList_add_new(list, code);
+    err->node = node;
+    err->symbol = symbol;
+    err->types[0] = type0;
+    err->types[1] = type1;
+}
+
+char *AnalysisError_format(const AnalysisError *error, char *buffer, size_t size)
+{
+    const char *t0 = DecafType_to_string(error->types[0]);
+    const char *t1 = DecafType_to_string(error->types[1]);
+    ASTNode *node = error->node;
+    const Symbol *sym = error->symbol;
+    switch (error->code)
+    {
+    case ERR_MESSAGE:
+        snprintf(buffer, size, "%s", error->text);
+        break;
+    case ERR_NULL_TREE:
+        snprintf(buffer, size, "Null Tree not allowed.");
+        break;
+    case ERR_NO_MAIN:
+        snprintf(buffer, size, "Program does not contain a 'main' function");
+        break;
+    case ERR_MAIN_PARAMETERS:
+        snprintf(buffer, size, "'main' must take no parameters");
+        break;
+    case ERR_MAIN_RETURN_TYPE:
+        snprintf(buffer, size, "Program 'main' function must return an int");
+        break;
+    case ERR_DUPLICATE:
+        snprintf(buffer, size, "Duplicate declaration of '%s' on line %d (previously declared on line %d)",
+                 sym->name, sym->source_line, sym->duplicate_of->source_line);
+        break;
+    case ERR_DUPLICATE_BUILTIN:
+        snprintf(buffer, size, "Duplicate declaration of '%s' on line %d (conflicts with built-in function)",
+                 sym->name, sym->source_line);
+        break;
+    case ERR_UNDEFINED:
+        snprintf(buffer, size, "Symbol '%s' undefined on line %d",
+                 (node->type == FUNCCALL ? node->funccall.name : node->location.name), node->source_line);
+        break;
+    case ERR_VOID_VARIABLE:
+        snprintf(buffer, size, "Void variable '%s' on line %d", node->vardecl.name, node->source_line);
+        break;
+    case ERR_LOCAL_ARRAY:
+        snprintf(buffer, size, "Local variable '%s' on line %d cannot be an array", node->vardecl.name, node->source_line);
+        break;
+    case ERR_ARRAY_LENGTH:
+        snprintf(buffer, size, "Array length must be greater than 0");
+        break;
+    case ERR_ASSIGNMENT_TYPE:
+        snprintf(buffer, size, "Expected %s type but type was %s", t0, t1);
+        break;
+    case ERR_CONDITION_TYPE:
+        snprintf(buffer, size, "Conditional type was %s, expected bool on line %d", t0, node->source_line);
+        break;
+    case ERR_RETURN_TYPE:
+        snprintf(buffer, size, "Invalid return type, Expected %s was %s on line %d", t0, t1, node->source_line);
+        break;
+    case ERR_BREAK_OUTSIDE_LOOP:
+        snprintf(buffer, size, "Break statement should be inside a while loop.");
+        break;
+    case ERR_CONTINUE_OUTSIDE_LOOP:
+        snprintf(buffer, size, "Continue statement should be inside a while loop.");
+        break;
+    case ERR_BINARY_OPERANDS:
+        snprintf(buffer, size, "Cannot use operator %s on type %s and %s on line %d",
+                 BinaryOpToString(node->binaryop.operator), t0, t1, node->source_line);
+        break;
+    case ERR_UNARY_OPERAND:
+        snprintf(buffer, size, "Type mismatch expected %s was %s on line %d", t0, t1, node->source_line);
+        break;
+    case ERR_MISSING_INDEX:
+        snprintf(buffer, size, "Expected array index on line %d", node->source_line);
+        break;
+    case ERR_INDEX_TYPE:
+        snprintf(buffer, size, "Array index must be an integer on line %d", node->source_line);
+        break;
+    case ERR_ARGUMENT_COUNT:
+        snprintf(buffer, size, "Incorrect number of arguments, expected %d, but got %d on line %d",
+                 (sym->parameters != NULL ? sym->parameters->size : 0),
+                 node->funccall.arguments->size, node->source_line);
+        break;
+    case ERR_ARGUMENT_TYPE:
+        snprintf(buffer, size, "Expected type %s but got type %s on line %d", t0, t1, node->source_line);
+        break;
+    case ERR_DIVISION_BY_ZERO:
+        snprintf(buffer, size, "%s by zero on line %d",
+                 (node->binaryop.operator == MODOP ? "Modulo" : "Division"), node->source_line);
+        break;
+    case ERR_UNINITIALIZED:
+        snprintf(buffer, size, "Variable '%s' may be used before it is assigned on line %d",
+                 node->location.name, node->source_line);
+        break;
+    default:
+        snprintf(buffer, size, "Unknown error");
+        break;
+    }
+    return buffer;
+}
+
+void ErrorList_print(ErrorList *list, FILE *output)
+{
+    char message[MAX_ERROR_LEN];
+    FOR_EACH(AnalysisError *, err, list)
+    {
+        fprintf(output, "%s\n", AnalysisError_format(err, message, MAX_ERROR_LEN));
+    }
+}
+
+void ErrorList_truncate(ErrorList *list, int size)
+{
+    if (size <= 0 || list->size <= size)
+    {
+        return;
+    }
+    AnalysisError *last = list->head;
+    for (int i = 1; i < size; i++)
+    {
+        last = last->next;
+    }
+    AnalysisError *err = last->next;
+    while (err != NULL)
+    {
+        AnalysisError *next = err->next;
+        AnalysisError_free(err);
+        err = next;
+    }
+    last->next = NULL;
+    list->tail = last;
+    list->size = size;
+}
+
+void ErrorList_append_all(ErrorList *list, ErrorList *other)
+{
+    if (other->head != NULL)
+    {
+        if (list->head == NULL)
+        {
+            list->head = other->head;
+        }
+        else
+        {
+            list->tail->next = other->head;
+        }
+        list->tail = other->tail;
+        list->size += other->size;
+    }
+    Memory_free(other);
+}
+
+void ErrorList_append_copies(ErrorList *list, ErrorList *other)
+{
+    FOR_EACH(AnalysisError *, err, other)
+    {
+        if (err->code == ERR_MESSAGE)
+        {
+            ErrorList_printf(list, "%s", err->text);
+        }
+        else
+        {
+            ErrorList_report(list, err->code, err->node, err->symbol, err->types[0], err->types[1]);
+        }
+    }
 }
@@ -0,0 +1,123 @@
+#include "threadpool.h"
+
+/**
+ * @brief Arguments for a worker thread's main loop
+ */
+typedef struct ThreadPoolWorker
+{
+    ThreadPool* pool;               /**< @brief Pool the worker belongs to */
+    int index;                      /**< @brief Index of the worker in the pool */
+} ThreadPoolWorker;
+
+/**
+ * @brief Claim and run jobs until the pool shuts down
+ */
+int ThreadPool_worker_main (void* arg)
+{
+    ThreadPoolWorker* worker = (ThreadPoolWorker*)arg;
+    ThreadPool* pool = worker->pool;
+    int index = worker->index;
+    Memory_free(worker);
+
+    mtx_lock(&pool->lock);
+    while (true) {
+        while (!pool->shutdown && pool->next_job >= pool->num_jobs) {
+            cnd_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        int job = pool->next_job++;
+        mtx_unlock(&pool->lock);
+
+        DecafContext* previous = DecafContext_set_current(pool->caller);
+        pool->job(pool->context, job, index);
+        DecafContext_set_current(previous);
+
+        mtx_lock(&pool->lock);
+        if (++pool->finished_jobs == pool->num_jobs) {
+            cnd_signal(&pool->work_done);
+        }
+    }
+    mtx_unlock(&pool->lock);
+    return 0;
+}
+
+ThreadPool* ThreadPool_new (int num_workers)
+{
+    ThreadPool* pool = (ThreadPool*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ThreadPool));
+    CHECK_MALLOC_PTR(pool)
+    pool->num_workers = (num_workers > 1 ? num_workers : 1);
+    pool->threads = NULL;
+    pool->num_jobs = 0;
+    pool->next_job = 0;
+    pool->finished_jobs = 0;
+    pool->shutdown = false;
+    if (pool->num_workers == 1) {
+        return pool;
+    }
+
+    if (mtx_init(&pool->lock, mtx_plain) != thrd_success ||
+            cnd_init(&pool->work_ready) != thrd_success ||
+            cnd_init(&pool->work_done) != thrd_success) {
+        fprintf(stderr, "ERROR: could not initialize thread pool\n");
+        exit(EXIT_FAILURE);
+    }
+    pool->threads = (thrd_t*)Memory_calloc(MEM_ANALYSIS, pool->num_workers, sizeof(thrd_t));
+    CHECK_MALLOC_PTR(pool->threads)
+    for (int i = 0; i < pool->num_workers; i++) {
+        ThreadPoolWorker* worker = (ThreadPoolWorker*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(ThreadPoolWorker));
+        CHECK_MALLOC_PTR(worker)
+        worker->pool = pool;
+        worker->index = i;
+        if (thrd_create(&pool->threads[i], ThreadPool_worker_main, worker) != thrd_success) {
+            fprintf(stderr, "ERROR: could not start worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+void ThreadPool_run (ThreadPool* pool, int num_jobs, ThreadPoolJob job, void* context)
+{
+    if (pool->threads == NULL) {
+        for (int i = 0; i < num_jobs; i++) {
+            job(context, i, 0);
+        }
+        return;
+    }
+    if (num_jobs <= 0) {
+        return;
+    }
+
+    mtx_lock(&pool->lock);
+    pool->job = job;
+    pool->context = context;
+    pool->caller = DecafContext_current();
+    pool->num_jobs = num_jobs;
+    pool->next_job = 0;
+    pool->finished_jobs = 0;
+    cnd_broadcast(&pool->work_ready);
+    while (pool->finished_jobs < pool->num_jobs) {
+        cnd_wait(&pool->work_done, &pool->lock);
+    }
+    mtx_unlock(&pool->lock);
+}
+
+void ThreadPool_free (ThreadPool* pool)
+{
+    if (pool->threads != NULL) {
+        mtx_lock(&pool->lock);
+        pool->shutdown = true;
+        cnd_broadcast(&pool->work_ready);
+        mtx_unlock(&pool->lock);
+        for (int i = 0; i < pool->num_workers; i++) {
+            thrd_join(pool->threads[i], NULL);
+        }
+        Memory_free(pool->threads);
+        cnd_destroy(&pool->work_done);
+        cnd_destroy(&pool->work_ready);
+        mtx_destroy(&pool->lock);
+    }
+    Memory_free(pool);
+}
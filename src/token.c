@@ -1,8 +1,100 @@
 #include "token.h"
 
+#include <threads.h>
+
+/**
+ * @brief Compiled pattern kept by the calling thread's regex cache
+ */
+typedef struct RegexCacheEntry
+{
+    char pattern[MAX_LINE_LEN];     /**< @brief Source of the pattern */
+    Regex regex;                    /**< @brief Compiled pattern */
+    struct RegexCacheEntry* next;   /**< @brief Next cached pattern */
+} RegexCacheEntry;
+
+/**
+ * @brief Whether @ref Regex_new uses the cache (process-wide setting)
+ */
+static bool regex_cache_enabled = false;
+
+/**
+ * @brief Patterns compiled on this thread (each thread matches with its own
+ * copies, so lexers on different threads never contend)
+ */
+static _Thread_local RegexCacheEntry* regex_cache = NULL;
+
+/**
+ * @brief Thread-specific key whose destructor clears a thread's cache when
+ * the thread exits (its value is only a non-@c NULL marker)
+ */
+static tss_t regex_cache_owner;
+
+/**
+ * @brief Guards the one-time creation of @ref regex_cache_owner
+ */
+static once_flag regex_cache_once = ONCE_FLAG_INIT;
+
+void Regex_clear_cache_at_exit (void* marker)
+{
+    Regex_clear_cache();
+}
+
+void Regex_create_cache_owner ()
+{
+    if (tss_create(&regex_cache_owner, Regex_clear_cache_at_exit) != thrd_success) {
+        fprintf(stderr, "ERROR: could not create regex cache key\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void Regex_enable_cache (bool enable)
+{
+    call_once(&regex_cache_once, Regex_create_cache_owner);
+    regex_cache_enabled = enable;
+}
+
+void Regex_clear_cache ()
+{
+    while (regex_cache != NULL) {
+        RegexCacheEntry* next = regex_cache->next;
+        regfree(&regex_cache->regex);
+        free(regex_cache);
+        regex_cache = next;
+    }
+}
+
+/**
+ * @brief Find the cache entry holding a compiled regex (or @c NULL)
+ */
+RegexCacheEntry* Regex_find_cached (Regex* regex)
+{
+    for (RegexCacheEntry* e = regex_cache; e != NULL; e = e->next) {
+        if (&e->regex == regex) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
 Regex* Regex_new (const char* regex)
 {
-    Regex* r = (Regex*)calloc(1, sizeof(Regex));
+    if (regex_cache_enabled && strlen(regex) < MAX_LINE_LEN) {
+        for (RegexCacheEntry* e = regex_cache; e != NULL; e = e->next) {
+            if (strcmp(e->pattern, regex) == 0) {
+                return &e->regex;
+            }
+        }
+        /* not charged to any compilation: the entry outlives them all */
+        RegexCacheEntry* e = (RegexCacheEntry*)calloc(1, sizeof(RegexCacheEntry));
+        CHECK_MALLOC_PTR(e)
+        snprintf(e->pattern, MAX_LINE_LEN, "%s", regex);
+        regcomp(&e->regex, regex, REG_EXTENDED);
+        e->next = regex_cache;
+        regex_cache = e;
+        tss_set(regex_cache_owner, e);
+        return &e->regex;
+    }
+    Regex* r = (Regex*)Memory_calloc(MEM_TOKEN, 1, sizeof(Regex));
     CHECK_MALLOC_PTR(r)
     /* regcomp initializes a regex_t, for which Regex is just a typedef */
     regcomp(r, regex, REG_EXTENDED);
@@ -24,8 +116,11 @@ bool Regex_match (Regex *regex, const char *text, char *match)
 
 void Regex_free (Regex* regex)
 {
+    if (Regex_find_cached(regex) != NULL) {
+        return;     /* owned by the cache */
+    }
     regfree(regex); /* clean up regex_t structure */
-    free(regex);
+    Memory_free(regex);
 }
 
 const char* TokenType_to_string (TokenType type)
@@ -48,7 +143,7 @@ bool token_str_eq (const char* str1, const char* str2)
 
 Token* Token_new (TokenType type, const char* text, int line)
 {
-    Token* token = (Token*)calloc(1, sizeof(Token));
+    Token* token = (Token*)Memory_calloc(MEM_TOKEN, 1, sizeof(Token));
     CHECK_MALLOC_PTR(token)
     token->type = type;
     snprintf(token->text, MAX_TOKEN_LEN, "%s", text);
@@ -59,12 +154,12 @@ Token* Token_new (TokenType type, const char* text, int line)
 
 void Token_free (Token* token)
 {
-    free(token);
+    Memory_free(token);
 }
 
 TokenQueue* TokenQueue_new ()
 {
-    TokenQueue* queue = calloc(1, sizeof(TokenQueue));
+    TokenQueue* queue = Memory_calloc(MEM_TOKEN, 1, sizeof(TokenQueue));
     CHECK_MALLOC_PTR(queue)
     return queue;
 }
@@ -132,5 +227,5 @@ void TokenQueue_free (TokenQueue* queue)
     while (!TokenQueue_is_empty(queue)) {
         Token_free(TokenQueue_remove(queue));
     }
-    free(queue);
+    Memory_free(queue);
 }
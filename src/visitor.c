@@ -1,4 +1,5 @@
 #include "visitor.h"
+#include "context.h"
 
 
 /*
@@ -12,10 +13,12 @@ void do_nothing (NodeVisitor* visitor, ASTNode* node)
 
 NodeVisitor* NodeVisitor_new()
 {
-    NodeVisitor* v = (NodeVisitor*)calloc(1, sizeof(NodeVisitor));
+    NodeVisitor* v = (NodeVisitor*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(NodeVisitor));
     CHECK_MALLOC_PTR(v)
     v->data = NULL;
     v->dtor = NULL;
+    v->skip_subtree = false;
+    v->stop_traversal = false;
     v->previsit_default      = do_nothing;
     v->postvisit_default     = do_nothing;
     v->previsit_program      = NULL;
@@ -53,12 +56,17 @@ NodeVisitor* NodeVisitor_new()
 }
 
 #define PREVISIT(TYPE)  if (visitor->previsit_ ## TYPE != NULL)  { visitor->previsit_ ## TYPE (visitor, node); } \
-                                                           else  { visitor->previsit_default  (visitor, node); }
-#define POSTVISIT(TYPE) if (visitor->postvisit_ ## TYPE != NULL) { visitor->postvisit_ ## TYPE(visitor, node); } \
+                                                           else  { visitor->previsit_default  (visitor, node); } \
+                        if (visitor->skip_subtree) { visitor->skip_subtree = false; break; }
+#define POSTVISIT(TYPE) if (visitor->stop_traversal) { break; } \
+                        if (visitor->postvisit_ ## TYPE != NULL) { visitor->postvisit_ ## TYPE(visitor, node); } \
                                                            else  { visitor->postvisit_default (visitor, node); }
 
 void NodeVisitor_traverse (NodeVisitor* visitor, ASTNode* node)
 {
+    if (visitor->stop_traversal) {
+        return;
+    }
     switch (node->type)
     {
         case PROGRAM:
@@ -139,7 +147,7 @@ void NodeVisitor_traverse (NodeVisitor* visitor, ASTNode* node)
         case BINARYOP:
             PREVISIT(binaryop)
             NodeVisitor_traverse(visitor, node->binaryop.left);
-            if (visitor->invisit_binaryop != NULL) {
+            if (visitor->invisit_binaryop != NULL && !visitor->stop_traversal) {
                 visitor->invisit_binaryop(visitor, node);
             }
             NodeVisitor_traverse(visitor, node->binaryop.right);
@@ -191,7 +199,7 @@ void NodeVisitor_free (NodeVisitor* visitor)
     if (visitor->dtor != NULL) {
         visitor->dtor(visitor->data);
     }
-    free(visitor);
+    Memory_free(visitor);
 }
 
 
@@ -356,9 +364,9 @@ NodeVisitor* PrintVisitor_new (FILE* output)
 
 void GenerateASTGraph_assign_dotid (NodeVisitor* visitor, ASTNode* node)
 {
-    static int next_id = 0;
-    ASTNode_set_attribute(node, "dotid", (void*)(long)next_id, dummy_free);
-    next_id++;
+    /* ids are unique within a compilation (not just within one graph) */
+    int id = DecafContext_current()->next_dot_id++;
+    ASTNode_set_attribute(node, "dotid", (void*)(long)id, dummy_free);
 }
 
 #define GET_ID(NODE) ((int)(long)ASTNode_get_attribute(NODE, "dotid"))
@@ -0,0 +1,167 @@
+#include "xref.h"
+
+/**
+ * @brief Initial number of entries in an index
+ */
+#define XREF_INITIAL_CAPACITY 64
+
+/**
+ * @brief Use recorded during the traversal, before grouping by symbol
+ */
+typedef struct XrefPendingUse
+{
+    int entry;                  /**< @brief Index of the used symbol's entry */
+    ASTNode* node;              /**< @brief Using node */
+} XrefPendingUse;
+
+/**
+ * @brief State for the cross-reference visitor
+ */
+typedef struct XrefData
+{
+    XrefIndex* index;           /**< @brief Index being built */
+    int entry_capacity;         /**< @brief Allocated length of @c index->entries */
+    XrefPendingUse* pending;    /**< @brief Uses in traversal order */
+    int pending_size;           /**< @brief Number of pending uses */
+    int pending_capacity;       /**< @brief Allocated length of @c pending */
+} XrefData;
+
+#define DATA ((XrefData*)visitor->data)
+
+void XrefVisitor_previsit_scope (NodeVisitor* visitor, ASTNode* node)
+{
+    /* add an entry for every symbol declared in this scope */
+    XrefIndex* index = DATA->index;
+    const SymbolTable* table = node->scope;
+    for (int i = 0; i < table->size; i++) {
+        if (index->size == DATA->entry_capacity) {
+            DATA->entry_capacity *= 2;
+            index->entries = (XrefEntry*)Memory_realloc(index->entries,
+                    DATA->entry_capacity, sizeof(XrefEntry));
+            CHECK_MALLOC_PTR(index->entries)
+        }
+        index->entries[index->size].symbol = table->symbols[i];
+        index->entries[index->size].first = 0;
+        index->entries[index->size].count = 0;
+        PointerMap_insert(&index->entry_map, table->symbols[i], index->size);
+        index->size++;
+    }
+}
+
+void XrefVisitor_visit_use (NodeVisitor* visitor, ASTNode* node)
+{
+    Symbol* symbol = Xref_definition(node);
+    if (symbol == NULL) {
+        return;
+    }
+    XrefIndex* index = DATA->index;
+    int entry = PointerMap_find(&index->entry_map, symbol);
+    if (entry < 0) {
+        return;     /* bound to a symbol outside this tree */
+    }
+    if (DATA->pending_size == DATA->pending_capacity) {
+        DATA->pending_capacity *= 2;
+        DATA->pending = (XrefPendingUse*)Memory_realloc(DATA->pending,
+                DATA->pending_capacity, sizeof(XrefPendingUse));
+        CHECK_MALLOC_PTR(DATA->pending)
+    }
+    DATA->pending[DATA->pending_size].entry = entry;
+    DATA->pending[DATA->pending_size].node = node;
+    DATA->pending_size++;
+    index->entries[entry].count++;
+}
+
+XrefIndex* XrefIndex_build (ASTNode* tree)
+{
+    XrefIndex* index = (XrefIndex*)Memory_calloc(MEM_ANALYSIS, 1, sizeof(XrefIndex));
+    CHECK_MALLOC_PTR(index)
+    index->entries = (XrefEntry*)Memory_calloc(MEM_ANALYSIS, XREF_INITIAL_CAPACITY, sizeof(XrefEntry));
+    CHECK_MALLOC_PTR(index->entries)
+    PointerMap_init(&index->entry_map, XREF_INITIAL_CAPACITY, MEM_ANALYSIS);
+
+    XrefData data;
+    data.index = index;
+    data.entry_capacity = XREF_INITIAL_CAPACITY;
+    data.pending_capacity = XREF_INITIAL_CAPACITY;
+    data.pending_size = 0;
+    data.pending = (XrefPendingUse*)Memory_calloc(MEM_ANALYSIS, data.pending_capacity, sizeof(XrefPendingUse));
+    CHECK_MALLOC_PTR(data.pending)
+
+    /* single traversal: declarations at scope entry, uses as they occur */
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = &data;
+    v->previsit_program  = XrefVisitor_previsit_scope;
+    v->previsit_funcdecl = XrefVisitor_previsit_scope;
+    v->previsit_block    = XrefVisitor_previsit_scope;
+    v->previsit_location = XrefVisitor_visit_use;
+    v->previsit_funccall = XrefVisitor_visit_use;
+    NodeVisitor_traverse_and_free(v, tree);
+
+    /* group the uses by symbol (a stable counting sort keeps source order) */
+    int first = 0;
+    for (int e = 0; e < index->size; e++) {
+        index->entries[e].first = first;
+        first += index->entries[e].count;
+        index->entries[e].count = 0;
+    }
+    index->use_count = data.pending_size;
+    index->uses = (ASTNode**)Memory_calloc(MEM_ANALYSIS, (size_t)index->use_count + 1, sizeof(ASTNode*));
+    CHECK_MALLOC_PTR(index->uses)
+    for (int i = 0; i < data.pending_size; i++) {
+        XrefEntry* entry = &index->entries[data.pending[i].entry];
+        index->uses[entry->first + entry->count++] = data.pending[i].node;
+    }
+    Memory_free(data.pending);
+    return index;
+}
+
+ASTNode* const* XrefIndex_uses (XrefIndex* index, const Symbol* symbol, int* count)
+{
+    int entry = PointerMap_find(&index->entry_map, symbol);
+    if (entry < 0) {
+        *count = 0;
+        return index->uses;
+    }
+    *count = index->entries[entry].count;
+    return &index->uses[index->entries[entry].first];
+}
+
+Symbol* Xref_definition (ASTNode* use)
+{
+    switch (use->type) {
+        case LOCATION: return use->location.symbol;
+        case FUNCCALL: return use->funccall.symbol;
+        default:       return NULL;
+    }
+}
+
+void XrefIndex_print (XrefIndex* index, FILE* output)
+{
+    fprintf(output, "XREF:\n");
+    for (int e = 0; e < index->size; e++) {
+        XrefEntry* entry = &index->entries[e];
+        if (entry->symbol->source_line == 0) {
+            fprintf(output, " %s (built-in):", entry->symbol->name);
+        } else {
+            fprintf(output, " %s (line %d):", entry->symbol->name, entry->symbol->source_line);
+        }
+        if (entry->count == 0) {
+            fprintf(output, " no uses\n");
+            continue;
+        }
+        fprintf(output, " %d use%s on line%s", entry->count,
+                (entry->count == 1 ? "" : "s"), (entry->count == 1 ? "" : "s"));
+        for (int i = 0; i < entry->count; i++) {
+            fprintf(output, "%s %d", (i == 0 ? "" : ","), index->uses[entry->first + i]->source_line);
+        }
+        fprintf(output, "\n");
+    }
+}
+
+void XrefIndex_free (XrefIndex* index)
+{
+    Memory_free(index->entries);
+    Memory_free(index->uses);
+    PointerMap_free(&index->entry_map);
+    Memory_free(index);
+}
@@ -17,6 +17,7 @@ function run_test {
     # parameters
     TAG=$1
     ARGS=$2
+    INPUT=${3:-/dev/null}   # standard input (optional)
     PTAG=$(printf '%-30s' "$TAG")
 
     # file paths
@@ -26,7 +27,7 @@ function run_test {
     VALGRND=valgrind/$TAG.txt
 
     # run test with timeout
-    $TIMEOUT $TIMEOUT_INTERVAL $EXE $ARGS 2>/dev/null >"$OUTPUT"
+    $TIMEOUT $TIMEOUT_INTERVAL $EXE $ARGS 2>/dev/null >"$OUTPUT" <"$INPUT"
     if [ "$?" -lt 124 ]; then
 
         # no timeout; compare output to the expected version
@@ -54,12 +55,50 @@ function run_test {
         fi
 
         # run valgrind
-        valgrind $EXE $ARGS &>$VALGRND
+        valgrind $EXE $ARGS &>$VALGRND <"$INPUT"
     else
         echo "$PTAG FAIL (timeout)"
     fi
 }
 
+function run_cache_test {
+
+    # parameters
+    TAG=$1
+    ARGS=$2
+    PTAG=$(printf '%-30s' "$TAG")
+
+    # run without a cache, then twice with a fresh one (a miss, then a hit)
+    # and check that the runs cannot be told apart
+    OUTPUT=outputs/$TAG.txt
+    DIFF=outputs/$TAG.diff
+    CACHE=$(mktemp -d)
+    : >"$DIFF"
+    for RUN in plain miss hit; do
+        if [ "$RUN" == "plain" ]; then
+            CARGS="$ARGS"
+        else
+            CARGS="--cache=$CACHE $ARGS"
+        fi
+        rm -f ast.dot
+        $TIMEOUT $TIMEOUT_INTERVAL $EXE $CARGS >"outputs/$TAG.$RUN.out" 2>"outputs/$TAG.$RUN.err" </dev/null
+        echo "exit status $?" >>"outputs/$TAG.$RUN.out"
+        cp ast.dot "outputs/$TAG.$RUN.dot" 2>/dev/null || : >"outputs/$TAG.$RUN.dot"
+        if [ "$RUN" != "plain" ]; then
+            for PART in out err dot; do
+                diff -u "outputs/$TAG.plain.$PART" "outputs/$TAG.$RUN.$PART" >>"$DIFF"
+            done
+        fi
+    done
+    rm -rf "$CACHE"
+    cp "outputs/$TAG.plain.out" "$OUTPUT"
+    if [ -s "$DIFF" ]; then
+        echo "$PTAG FAIL (see $DIFF for details)"
+    else
+        echo "$PTAG pass"
+    fi
+}
+
 # initialize output folders
 mkdir -p outputs
 mkdir -p valgrind
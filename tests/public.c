@@ -5,8 +5,14 @@
  * This file provides a few basic sanity test cases and a location to add new tests.
  */
 
+/* for mkdtemp, rmdir, and directory listings */
+#define _POSIX_C_SOURCE 200809L
+
 #include "testsuite.h"
 
+#include <dirent.h>
+#include <unistd.h>
+
 #ifndef SKIP_IN_DOXYGEN
 
 /*
@@ -16,6 +22,8 @@
 
 TEST_VALID_MAIN(D_trivial, "return 0;")
 TEST_VALID_MAIN(C_assign,  "int i; i = 3; return 0;")
+TEST_VALID(B_shadowed_global, "bool a; def int main() { int a; a = 3; "
+                              "if (a > 1) { bool a; a = true; } return a; }")
 
 /*
  * Test a variety of invalid programs to make sure the analysis reports an
@@ -29,11 +37,437 @@ TEST_INVALID_MAIN(C_invalid_break,    "break; return 0;")
 TEST_INVALID(C_var_type_mismatch,     "int x; def int main() { x=false; return 0; }")
 TEST_INVALID(C_invalid_conditional,   "def int main() { if (1) { return 0; } }")
 TEST_INVALID_MAIN(B_invalid_dup_var_global, "int a; bool b; int a; return 0;")
+TEST_INVALID(B_invalid_dup_param,     "def int foo(int a, bool a) { return 0; } "
+                                      "def int main() { return 0; }")
 TEST_INVALID(B_expr_type_mismatch,    "def int main() { int i; i = true+4; return 0; }")
 TEST_INVALID(B_mismatched_parameters, "def int main() { foo(true, true); return 0; } "
                                       "def void foo(int i, bool b) { return; } ")
 TEST_INVALID(A_invalid_main_var,      "int main; def int foo(int a) { return 0; }")
 
+/*
+ * Test the in-memory library interface (decaf.h)
+ */
+
+START_TEST (B_library_buffer)
+{
+    /* only the first length characters are analyzed */
+    const char text[] = "def int main() { return 0; } garbage";
+    DecafContext* context = DecafContext_new();
+    DecafResult result;
+    ck_assert (decaf_analyze_buffer(context, text, strlen(text) - 8, &result) == DECAF_OK);
+    ck_assert (result.tree != NULL && ErrorList_is_empty(result.errors));
+    ck_assert (SymbolTable_lookup(result.globals, "main") != NULL);
+    DecafContext_free(context);
+    decaf_result_free(&result);
+}
+END_TEST
+
+START_TEST (B_library_syntax_error)
+{
+    const char text[] = "def int main() { return 0 }";
+    DecafContext* context = DecafContext_new();
+    DecafResult result;
+    ck_assert (decaf_analyze_buffer(context, text, strlen(text), &result) == DECAF_SYNTAX_ERROR);
+    ck_assert (result.tree == NULL && ErrorList_size(result.errors) == 1);
+    decaf_result_free(&result);
+    DecafContext_free(context);
+}
+END_TEST
+
+/**
+ * @brief Check that a session reports exactly what a full analysis would
+ */
+bool same_as_full (DecafSession* session, const char* text)
+{
+    DecafContext* context = DecafContext_new();
+    DecafResult full;
+    decaf_analyze_buffer(context, text, strlen(text), &full);
+    bool same = (ErrorList_size(session->result.errors) == ErrorList_size(full.errors));
+    char expected[MAX_ERROR_LEN], actual[MAX_ERROR_LEN];
+    AnalysisError* err = session->result.errors->head;
+    FOR_EACH(AnalysisError*, full_err, full.errors) {
+        if (!same || strcmp(AnalysisError_format(err, actual, MAX_ERROR_LEN),
+                            AnalysisError_format(full_err, expected, MAX_ERROR_LEN)) != 0) {
+            same = false;
+            break;
+        }
+        err = err->next;
+    }
+    decaf_result_free(&full);
+    DecafContext_free(context);
+    return same;
+}
+
+START_TEST (B_incremental_reuse)
+{
+    const char* versions[] = {
+        "def int f(int a) { return true; }\n"
+        "def int g() { return f(1); }\n"
+        "def int h() { int x; x = false; return 0; }\n"
+        "def int main() { return 0; }\n",
+
+        /* a new line shifts every function and g's body changes */
+        "int unused;\n"
+        "def int f(int a) { return true; }\n"
+        "def int g() { return f(2) + 1; }\n"
+        "def int h() { int x; x = false; return 0; }\n"
+        "def int main() { return 0; }\n",
+
+        /* f's signature changes, so its caller g must be checked again */
+        "int unused;\n"
+        "def int f(bool a) { return true; }\n"
+        "def int g() { return f(2) + 1; }\n"
+        "def int h() { int x; x = false; return 0; }\n"
+        "def int main() { return 0; }\n",
+    };
+    int expected_checked[] = { 4, 1, 2 };
+    DecafContext* context = DecafContext_new();
+    DecafSession* session = DecafSession_new(context, 2);
+    for (int v = 0; v < 3; v++) {
+        ck_assert (DecafSession_update(session, versions[v], strlen(versions[v])) == DECAF_ANALYSIS_ERRORS);
+        ck_assert_int_eq (session->checked_functions, expected_checked[v]);
+        ck_assert_int_eq (session->reused_functions, 4 - expected_checked[v]);
+        ck_assert (same_as_full(session, versions[v]));
+    }
+
+    /* a syntax error keeps the last good version as the base */
+    ck_assert (DecafSession_update(session, "def int main() { return 0 }", 27) == DECAF_SYNTAX_ERROR);
+    ck_assert (DecafSession_update(session, versions[2], strlen(versions[2])) == DECAF_ANALYSIS_ERRORS);
+    ck_assert_int_eq (session->checked_functions, 0);
+    ck_assert (same_as_full(session, versions[2]));
+
+    DecafSession_free(session);
+    DecafContext_free(context);
+}
+END_TEST
+
+/**
+ * @brief Store one output in a result cache
+ */
+void cache_store_text (ResultCache* cache, uint64_t key, const char* text, bool failed)
+{
+    FILE* output = tmpfile();
+    fputs(text, output);
+    ResultCache_store(cache, key, output, failed);
+    fclose(output);
+}
+
+/**
+ * @brief Remove a scratch cache directory and everything in it
+ */
+void remove_cache_directory (const char* directory)
+{
+    DIR* listing = opendir(directory);
+    if (listing != NULL) {
+        struct dirent* entry;
+        while ((entry = readdir(listing)) != NULL) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+                char path[2 * MAX_LINE_LEN];
+                snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+                remove(path);
+            }
+        }
+        closedir(listing);
+    }
+    rmdir(directory);
+}
+
+/**
+ * @brief Count the output files in a cache directory
+ */
+int count_cache_outputs (const char* directory)
+{
+    int count = 0;
+    DIR* listing = opendir(directory);
+    if (listing != NULL) {
+        struct dirent* entry;
+        while ((entry = readdir(listing)) != NULL) {
+            size_t length = strlen(entry->d_name);
+            count += (length > 4 && strcmp(entry->d_name + length - 4, ".out") == 0 ? 1 : 0);
+        }
+        closedir(listing);
+    }
+    return count;
+}
+
+/**
+ * @brief Replay a cached output and check that it matches
+ */
+bool cache_replays (ResultCache* cache, uint64_t key, const char* text, bool failed)
+{
+    FILE* output = tmpfile();
+    bool cached_failed = !failed;
+    bool hit = ResultCache_replay(cache, key, output, &cached_failed);
+    char buffer[64] = { 0 };
+    rewind(output);
+    size_t length = fread(buffer, 1, sizeof(buffer) - 1, output);
+    fclose(output);
+    return hit && cached_failed == failed && length == strlen(text) && strcmp(buffer, text) == 0;
+}
+
+START_TEST (B_constant_folding)
+{
+    /* x is propagated into both expressions, and the addition wraps around */
+    char text[] = "def int main() { int x; x = 2147483647; x = x + 1; return x * 1; }";
+    ASTNode* tree = analyze_program(text);
+    ck_assert (tree != NULL);
+    ErrorList* errors = ErrorList_new();
+    FoldStats stats = fold_constants(tree, errors);
+    ck_assert (ErrorList_is_empty(errors));
+    ErrorList_free(errors);
+    ck_assert_int_eq (stats.propagated, 2);
+    ck_assert_int_eq (stats.folded, 2);
+    ck_assert_int_eq (stats.nodes_before - stats.nodes_after, 4);
+    ASTNode* body = tree->program.functions->head->funcdecl.body;
+    ASTNode* value = body->block.statements->tail->funcreturn.value;
+    ck_assert (value->type == LITERAL && value->literal.integer == INT32_MIN);
+    ASTNode_free(tree);
+}
+END_TEST
+
+START_TEST (B_control_flow_graph)
+{
+    char text[] = "def int main() { int i; i = 0; while (i < 3) { i = i + 1; } return i; i = 1; }";
+    ASTNode* tree = analyze_program(text);
+    ck_assert (tree != NULL);
+    ControlFlowGraph* cfg = ControlFlowGraph_build(tree->program.functions->head);
+
+    /* entry, loop header, body, after-loop, unreachable tail, exit */
+    ck_assert_int_eq (cfg->num_blocks, 6);
+    ck_assert_int_eq (cfg->num_reachable, 5);
+    ck_assert_int_eq (cfg->num_items, 5);
+    ck_assert (cfg->blocks[1].branch != NULL && cfg->blocks[1].num_pred == 2);
+    ck_assert (cfg->blocks[4].rpo == -1 && cfg->blocks[4].num_pred == 0);
+
+    /* every edge except the loop's back edge goes forward in reverse postorder */
+    int backward = 0;
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        FOR_EACH_SUCC(s, cfg, b) {
+            if (cfg->blocks[b].rpo >= 0 && cfg->blocks[s].rpo <= cfg->blocks[b].rpo) {
+                backward++;
+            }
+        }
+    }
+    ck_assert_int_eq (backward, 1);
+
+    ControlFlowGraph_free(cfg);
+    ASTNode_free(tree);
+}
+END_TEST
+
+START_TEST (B_dataflow)
+{
+    char text[] = "def int main() { int a; int b; a = 1; b = a; "
+                        "while (b < 3) { b = b + a; } return b; }";
+    ASTNode* tree = analyze_program(text);
+    ck_assert (tree != NULL);
+    ControlFlowGraph* cfg = ControlFlowGraph_build(tree->program.functions->head);
+    VariableIndex* vars = VariableIndex_build(cfg);
+    ck_assert_int_eq (vars->size, 2);
+
+    /* both variables are live around the loop, but neither is on entry */
+    DataflowAnalysis* live = Liveness_solve(cfg, vars);
+    ck_assert (BitSet_test(DataflowAnalysis_set(live, live->in, 1), 0));
+    ck_assert (BitSet_test(DataflowAnalysis_set(live, live->in, 1), 1));
+    ck_assert (live->in[0] == 0);
+    DataflowAnalysis_free(live);
+
+    /* all three assignments reach the loop header and the return */
+    ReachingDefinitions* defs = ReachingDefinitions_solve(cfg, vars);
+    ck_assert_int_eq (defs->num_sites, 3);
+    ck_assert (*DataflowAnalysis_set(defs->analysis, defs->analysis->in, 1) == 7);
+    ck_assert (*DataflowAnalysis_set(defs->analysis, defs->analysis->in, 3) == 7);
+    ReachingDefinitions_free(defs);
+
+    ErrorList* errors = ErrorList_new();
+    ck_assert_int_eq (DefiniteAssignment_check(cfg, vars, errors), 0);
+    ErrorList_free(errors);
+
+    VariableIndex_free(vars);
+    ControlFlowGraph_free(cfg);
+    ASTNode_free(tree);
+}
+END_TEST
+
+START_TEST (B_dead_code_elimination)
+{
+    /* f is only called from dead code, and y is only ever written */
+    char text[] = "def void f() { } "
+                        "def int main() { int x; int y; x = 1; y = x; if (false) { f(); } return x; x = 2; }";
+    ASTNode* tree = analyze_program(text);
+    ck_assert (tree != NULL);
+    SymbolTable* locals = tree->program.functions->tail->funcdecl.body->scope;
+    Symbol* const* frozen = locals->symbols;
+    DeadCodeStats stats = eliminate_dead_code(tree);
+    ck_assert_int_eq (stats.statements, 1);
+    ck_assert_int_eq (stats.branches, 1);
+    ck_assert_int_eq (stats.functions, 1);
+    ck_assert_int_eq (stats.locals, 1);
+    ck_assert_int_eq (stats.assignments, 1);
+    ck_assert_int_eq (tree->program.functions->size, 1);
+    ASTNode* body = tree->program.functions->head->funcdecl.body;
+    ck_assert_int_eq (body->block.variables->size, 1);
+    ck_assert_int_eq (body->block.statements->size, 2);
+    ck_assert (body->block.statements->tail->type == RETURNSTMT);
+
+    /* the removed declarations are gone from their symbol tables too */
+    ck_assert (SymbolTable_lookup(tree->scope, "f") == NULL);
+    ck_assert (SymbolTable_lookup(body->scope, "y") == NULL);
+    ck_assert_int_eq (body->scope->size, 1);
+
+    /* the table is frozen again with a new array; the old one is untouched */
+    ck_assert (locals->frozen && locals->symbols != frozen);
+    ck_assert (strcmp(locals->symbols[0]->name, "x") == 0);
+    ck_assert (strcmp(frozen[1]->name, "y") == 0);
+    ASTNode_free(tree);
+}
+END_TEST
+
+START_TEST (B_call_graph)
+{
+    /* g and h call each other, so they form one recursive SCC between f and main */
+    char text[] = "def int f() { return 1; } "
+                        "def int g(int n) { if (n > 0) { return h(n - 1); } return f(); } "
+                        "def int h(int n) { return g(n) + f(); } "
+                        "def int main() { return g(3) + f(); }";
+    ASTNode* tree = analyze_program(text);
+    ck_assert (tree != NULL);
+    CallGraph* graph = CallGraph_build(tree);
+    ck_assert_int_eq (graph->num_nodes, 4);
+    ck_assert_int_eq (graph->num_edges, 6);
+    ck_assert_int_eq (graph->num_sccs, 3);
+    ck_assert_int_eq (graph->num_levels, 3);
+    ck_assert_int_eq (graph->nodes[1].scc, graph->nodes[2].scc);
+
+    /* bottom-up: every call goes to the same or an earlier SCC */
+    for (int v = 0; v < graph->num_nodes; v++) {
+        FOR_EACH_CALL(call, graph, v) {
+            ck_assert (graph->nodes[call->callee].scc <= graph->nodes[v].scc);
+        }
+    }
+    CallGraphSCC* cycle = &graph->sccs[graph->nodes[1].scc];
+    ck_assert (cycle->recursive && cycle->num_members == 2 && cycle->level == 1);
+    ck_assert_int_eq (graph->sccs[graph->nodes[3].scc].level, 2);
+    CallGraph_free(graph);
+    ASTNode_free(tree);
+}
+END_TEST
+
+START_TEST (B_result_cache)
+{
+    /* keys cover the options as well as the source */
+    const char text[] = "def int main() { return 0; }";
+    uint64_t a = ResultCache_key(text, strlen(text), "max_errors=0");
+    uint64_t b = ResultCache_key(text, strlen(text), "max_errors=1");
+    uint64_t c = ResultCache_key(text, strlen(text) - 1, "max_errors=0");
+    ck_assert (a != b && a != c && b != c);
+
+    /* room for two 20-byte outputs, in a directory no earlier run has used */
+    char directory[] = "/tmp/decaf-cache-XXXXXX";
+    ck_assert (mkdtemp(directory) != NULL);
+    ResultCache* cache = ResultCache_open(directory, 40);
+    ck_assert (cache != NULL);
+    cache_store_text(cache, a, "aaaaaaaaaaaaaaaaaaa\n", false);
+    cache_store_text(cache, b, "bbbbbbbbbbbbbbbbbbb\n", true);
+    ck_assert (cache_replays(cache, a, "aaaaaaaaaaaaaaaaaaa\n", false));
+
+    /* b is now the least recently used, so storing c evicts it */
+    cache_store_text(cache, c, "ccccccccccccccccccc\n", false);
+    ck_assert (cache->total_size <= 40);
+    ck_assert (!cache_replays(cache, b, "bbbbbbbbbbbbbbbbbbb\n", true));
+    ck_assert (cache_replays(cache, c, "ccccccccccccccccccc\n", false));
+    ck_assert (cache_replays(cache, a, "aaaaaaaaaaaaaaaaaaa\n", false));
+    ck_assert_int_eq (cache->run.hits, 3);
+    ck_assert_int_eq (cache->run.misses, 1);
+    ck_assert_int_eq (cache->run.stores, 3);
+    ck_assert (cache->run.evictions >= 1);
+    ResultCache_close(cache);
+
+    /* the index survives, so a new run still hits */
+    cache = ResultCache_open(directory, 40);
+    ck_assert (cache_replays(cache, c, "ccccccccccccccccccc\n", false));
+    ResultCache_close(cache);
+    remove_cache_directory(directory);
+}
+END_TEST
+
+START_TEST (B_result_cache_shared)
+{
+    const char text[] = "def int main() { return 0; }";
+    uint64_t keys[100];
+    for (int i = 0; i < 100; i++) {
+        char options[32];
+        snprintf(options, sizeof(options), "max_errors=%d", i);
+        keys[i] = ResultCache_key(text, strlen(text), options);
+    }
+
+    /* many entries: only the most recent ones fit, and lookups find them */
+    char directory[] = "/tmp/decaf-cache-XXXXXX";
+    ck_assert (mkdtemp(directory) != NULL);
+    ResultCache* cache = ResultCache_open(directory, 20 * 30);
+    for (int i = 0; i < 100; i++) {
+        cache_store_text(cache, keys[i], "xxxxxxxxxxxxxxxxxxx\n", false);
+    }
+    ck_assert_int_eq (cache->size, 30);
+    ck_assert (!cache_replays(cache, keys[69], "xxxxxxxxxxxxxxxxxxx\n", false));
+    for (int i = 70; i < 100; i++) {
+        ck_assert (cache_replays(cache, keys[i], "xxxxxxxxxxxxxxxxxxx\n", false));
+    }
+    ResultCache_close(cache);
+    remove_cache_directory(directory);
+
+    /* two processes sharing a directory (room for three outputs) keep each
+     * other's entries, and every output file stays within the limit */
+    strcpy(directory, "/tmp/decaf-cache-XXXXXX");
+    ck_assert (mkdtemp(directory) != NULL);
+    ResultCache* first = ResultCache_open(directory, 60);
+    ResultCache* second = ResultCache_open(directory, 60);
+    cache_store_text(first, keys[0], "aaaaaaaaaaaaaaaaaaa\n", false);
+    cache_store_text(first, keys[1], "bbbbbbbbbbbbbbbbbbb\n", false);
+    cache_store_text(second, keys[2], "ccccccccccccccccccc\n", false);
+    cache_store_text(second, keys[3], "ddddddddddddddddddd\n", false);
+    ResultCache_close(first);
+    ResultCache_close(second);
+    cache = ResultCache_open(directory, 60);
+    ck_assert_int_eq (cache->size, 3);
+    ck_assert (cache->total_size <= 60);
+    ck_assert_int_eq (count_cache_outputs(directory), 3);
+    ck_assert_int_eq (cache->total.stores, 4);
+    ck_assert (cache_replays(cache, keys[1], "bbbbbbbbbbbbbbbbbbb\n", false));
+    ck_assert (cache_replays(cache, keys[3], "ddddddddddddddddddd\n", false));
+    ResultCache_close(cache);
+    remove_cache_directory(directory);
+}
+END_TEST
+
+/**
+ * @brief Write a file of the given size and read it back
+ */
+ReadStatus read_file_of_size (size_t size, char* text)
+{
+    char name[] = "/tmp/decaf-read-XXXXXX";
+    FILE* file = fdopen(mkstemp(name), "w");
+    for (size_t i = 0; i < size; i++) {
+        fputc(i % 64 == 63 ? '\n' : ' ', file);
+    }
+    fclose(file);
+    ReadStatus status = read_file(name, text);
+    remove(name);
+    return status;
+}
+
+START_TEST (B_read_file_limit)
+{
+    /* the terminator goes one past the largest file that fits */
+    char* text = (char*)malloc(MAX_FILE_SIZE + 1);
+    ck_assert (read_file_of_size(MAX_FILE_SIZE, text) == READ_OK);
+    ck_assert (strlen(text) == MAX_FILE_SIZE);
+    ck_assert (read_file_of_size(MAX_FILE_SIZE + 1, text) == READ_TOO_LARGE);
+    ck_assert (read_file("inputs/missing.decaf", text) == READ_FAILED);
+    free(text);
+}
+END_TEST
+
 #endif
 
 /**
@@ -55,10 +489,24 @@ void public_tests (Suite *s)
     TEST(C_var_type_mismatch);
     TEST(C_invalid_conditional);
 
+    TEST(B_shadowed_global);
     TEST(B_invalid_dup_var_global);
+    TEST(B_invalid_dup_param);
     TEST(B_expr_type_mismatch);
     TEST(B_mismatched_parameters);
 
+    TEST(B_library_buffer);
+    TEST(B_library_syntax_error);
+    TEST(B_incremental_reuse);
+    TEST(B_result_cache);
+    TEST(B_result_cache_shared);
+    TEST(B_read_file_limit);
+    TEST(B_constant_folding);
+    TEST(B_control_flow_graph);
+    TEST(B_dataflow);
+    TEST(B_dead_code_elimination);
+    TEST(B_call_graph);
+
     TEST(A_invalid_main_var);
 
     suite_add_tcase (s, tc);
@@ -1,26 +1,45 @@
 #include "testsuite.h"
 
-jmp_buf decaf_error;
-
-void Error_throw_printf (const char* format, ...)
-{
-    longjmp(decaf_error, 1);
-}
-
-ErrorList* run_analysis (char* text)
+ASTNode* build_program (char* text)
 {
+    DecafContext* context = DecafContext_current();
     ASTNode* tree = NULL;
-    if (setjmp(decaf_error) == 0) {
+    DecafContext_arm(context);
+    if (setjmp(context->error_jump) == 0) {
         /* no error */
         tree = parse(lex(text));
     } else {
         /* error; return NULL */
+        DecafContext_disarm(context);
         return NULL;
     }
+    DecafContext_disarm(context);
     NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
     NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
     NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
-    return analyze(tree);
+    return tree;
+}
+
+ErrorList* run_analysis (char* text)
+{
+    ASTNode* tree = build_program(text);
+    return (tree == NULL ? NULL : analyze(tree));
+}
+
+ASTNode* analyze_program (char* text)
+{
+    ASTNode* tree = build_program(text);
+    if (tree == NULL) {
+        return NULL;
+    }
+    ErrorList* errors = analyze(tree);
+    bool valid = ErrorList_is_empty(errors);
+    ErrorList_free(errors);
+    if (!valid) {
+        ASTNode_free(tree);
+        return NULL;
+    }
+    return tree;
 }
 
 bool valid_program (char* text)
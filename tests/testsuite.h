@@ -15,6 +15,12 @@
 #include "p1-lexer.h"
 #include "p2-parser.h"
 #include "p3-analysis.h"
+#include "incremental.h"
+#include "cache.h"
+#include "fold.h"
+#include "dce.h"
+#include "callgraph.h"
+#include "dataflow.h"
 
 /**
  * @brief Define a test case with a valid program
@@ -49,14 +55,31 @@ END_TEST
  */
 #define TEST(NAME) tcase_add_test (tc, NAME)
 
+/**
+ * @brief Run lexer and parser on given text and build its symbol tables
+ *
+ * @param text Code to lex and parse
+ * @returns AST or @c NULL if there was a syntax error
+ */
+ASTNode* build_program (char* text);
+
 /**
  * @brief Run lexer, parser, and analysis on given text
  *
  * @param text Code to lex, parse, and analyze
- * @returns AST or @c NULL if there was an error
+ * @returns Analysis errors or @c NULL if there was a syntax error
  */
 ErrorList* run_analysis (char* text);
 
+/**
+ * @brief Run lexer, parser, and analysis on a program that should be valid
+ *
+ * @param text Code to lex, parse, and analyze
+ * @returns Analyzed AST (to be freed by the caller) or @c NULL if there was
+ * any error
+ */
+ASTNode* analyze_program (char* text);
+
 /**
  * @brief Run lexer and parser on given text and verify that it throws an exception.
  *